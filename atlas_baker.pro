@@ -0,0 +1,14 @@
+# Offline atlas baker, see src/tools/atlas_baker.cpp. Shares the sources and settings of the app.
+TARGET = atlas_baker
+
+include(freetype_text.pro)
+
+SOURCES -= \
+    src/main.cpp \
+    src/window.cpp
+
+HEADERS -= \
+    src/window.h
+
+SOURCES += \
+    src/tools/atlas_baker.cpp
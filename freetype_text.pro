@@ -33,28 +33,53 @@ win32:{
 unix:{
     INCLUDEPATH += /usr/include/freetype2/
     LIBS += -lglfw -lfreetype -lGL -lGLEW
-    LIBS += -lboost_json -lz
+    LIBS += -lboost_json -lz -lpthread
+}
+
+# optional HarfBuzz text shaping: qmake CONFIG+=harfbuzz
+harfbuzz {
+    DEFINES += USE_HARFBUZZ
+    unix:INCLUDEPATH += /usr/include/harfbuzz
+    LIBS += -lharfbuzz
+}
+
+# optional zstd (zip method 93) entries in packed archives: qmake CONFIG+=zstd
+zstd {
+    DEFINES += USE_ZSTD
+    LIBS += -lzstd
 }
 
 SOURCES +=  \
     src/fs/file.cpp \
+    src/fs/file_cache.cpp \
+    src/fs/file_stream.cpp \
     src/fs/file_system.cpp \
+    src/fs/file_watcher.cpp \
+    src/fs/mapped_file.cpp \
+    src/fs/thread_pool.cpp \
     src/fs/memory_stream.cpp \
+    src/fs/zip_archive.cpp \
+    src/fs/zip_codec.cpp \
+    src/fs/zip_writer.cpp \
     src/gui/basic_types.cpp \
     src/gui/button.cpp \
     src/gui/imagebox.cpp \
     src/gui/packer.cpp \
+    src/gui/scroll_view.cpp \
     src/gui/text_box.cpp \
     src/gui/text_fitter.cpp \
     src/gui/ui.cpp \
     src/gui/uiconfigloader.cpp \
     src/gui/uiimagemanager.cpp \
     src/gui/uiwindow.cpp \
+    src/gui/utils/arena.cpp \
     src/gui/utils/atlastex.cpp \
     src/gui/utils/chain.cpp \
     src/gui/utils/fontmanager.cpp \
+    src/gui/utils/rect_packer.cpp \
     src/gui/utils/rect2d.cpp \
     src/gui/utils/texfont.cpp \
+    src/gui/utils/textshaper.cpp \
     src/gui/utils/utf8_utils.cpp \
     src/gui/widget.cpp \
     src/input/input.cpp \
@@ -64,28 +89,42 @@ SOURCES +=  \
     src/render/texture.cpp \
     src/render/vertex_buffer.cpp \
     src/res/imagedata.cpp \
+    src/res/pixel_ops.cpp \
     src/window.cpp
 
 HEADERS +=  \
     src/fs/file.h \
+    src/fs/file_cache.h \
+    src/fs/file_stream.h \
     src/fs/file_system.h \
+    src/fs/file_watcher.h \
+    src/fs/mapped_file.h \
+    src/fs/shared_buffer.h \
+    src/fs/thread_pool.h \
     src/fs/memory_stream.h \
     src/fs/zip.h \
+    src/fs/zip_archive.h \
+    src/fs/zip_codec.h \
+    src/fs/zip_writer.h \
     src/gui/basic_types.h \
     src/gui/button.h \
     src/gui/imagebox.h \
     src/gui/packer.h \
+    src/gui/scroll_view.h \
     src/gui/text_box.h \
     src/gui/text_fitter.h \
     src/gui/ui.h \
     src/gui/uiconfigloader.h \
     src/gui/uiimagemanager.h \
     src/gui/uiwindow.h \
+    src/gui/utils/arena.h \
     src/gui/utils/atlastex.h \
     src/gui/utils/chain.h \
     src/gui/utils/fontmanager.h \
+    src/gui/utils/rect_packer.h \
     src/gui/utils/rect2d.h \
     src/gui/utils/texfont.h \
+    src/gui/utils/textshaper.h \
     src/gui/utils/utf8_utils.h \
     src/gui/widget.h \
     src/input/input.h \
@@ -97,6 +136,7 @@ HEADERS +=  \
     src/render/texture.h \
     src/render/vertex_buffer.h \
     src/res/imagedata.h \
+    src/res/pixel_ops.h \
     src/scene_data.h \
     src/window.h
 
@@ -10,6 +10,11 @@ public:
     BaseFile()          = default;
     virtual ~BaseFile() = default;
 
+    BaseFile(BaseFile const &)             = default;
+    BaseFile & operator=(BaseFile const &) = default;
+    BaseFile(BaseFile &&)                  = default;
+    BaseFile & operator=(BaseFile &&)      = default;
+
     virtual int8_t const * getData() const     = 0;
     virtual size_t         getFileSize() const = 0;
 
@@ -34,6 +39,11 @@ public:
     explicit OutFile(InFile const & infile);
     ~OutFile() override = default;
 
+    OutFile(OutFile const &)             = default;
+    OutFile & operator=(OutFile const &) = default;
+    OutFile(OutFile &&)                  = default;
+    OutFile & operator=(OutFile &&)      = default;
+
     int8_t const * getData() const override { return m_data.getBufferPtr(); }
     size_t         getFileSize() const override { return m_data.getLength(); }
 
@@ -60,6 +70,12 @@ public:
         std::swap(m_name, name);
         m_last_write_time = timestamp;
     }
+    InFile(std::string name, std::chrono::system_clock::time_point timestamp, SharedBuffer data)
+        : m_data(std::move(data))
+    {
+        std::swap(m_name, name);
+        m_last_write_time = timestamp;
+    }
 
     explicit InFile(OutFile const & outfile)
     {
@@ -67,9 +83,21 @@ public:
         m_last_write_time = outfile.timeStamp();
         m_data            = InputMemoryStream(outfile.getStream());
     }
+    explicit InFile(OutFile && outfile)   // takes over the written bytes
+    {
+        m_name            = outfile.getName();
+        m_last_write_time = outfile.timeStamp();
+        m_data            = InputMemoryStream(outfile.getStream().release());
+    }
 
     ~InFile() override = default;
 
+    // copies share the file data
+    InFile(InFile const &)             = default;
+    InFile & operator=(InFile const &) = default;
+    InFile(InFile &&)                  = default;
+    InFile & operator=(InFile &&)      = default;
+
     int8_t const * getData() const override { return m_data.getPtr(); }
     size_t         getFileSize() const override { return m_data.getCapacity(); }
 
@@ -0,0 +1,105 @@
+#include "file_cache.h"
+
+size_t FileCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_budget;
+}
+
+void FileCache::setBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_budget = budget;
+    evict();
+}
+
+std::optional<InFile> FileCache::find(std::string const & fname, uint64_t stamp)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(fname);
+    if(it == m_index.end())
+    {
+        ++m_stats.misses;
+        return {};
+    }
+
+    if(it->second->stamp != stamp)
+    {
+        // the file was changed
+        eraseEntry(it->second);
+        ++m_stats.misses;
+        return {};
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    ++m_stats.hits;
+
+    InFile result = m_entries.front().file;
+    result.getStream().resetHead();
+    return result;
+}
+
+void FileCache::insert(std::string const & fname, uint64_t stamp, InFile const & file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(file.getFileSize() > m_budget)
+        return;
+
+    if(auto it = m_index.find(fname); it != m_index.end())
+        eraseEntry(it->second);
+
+    m_entries.push_front({fname, stamp, file});
+    m_entries.front().file.getStream().resetHead();
+    m_index[fname] = m_entries.begin();
+
+    m_stats.bytes += file.getFileSize();
+    ++m_stats.entries;
+
+    evict();
+}
+
+void FileCache::erase(std::string const & fname)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if(auto it = m_index.find(fname); it != m_index.end())
+        eraseEntry(it->second);
+}
+
+void FileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_index.clear();
+    m_stats.bytes   = 0;
+    m_stats.entries = 0;
+}
+
+FileCache::Stats FileCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void FileCache::eraseEntry(std::list<Entry>::iterator it)
+{
+    m_stats.bytes -= it->file.getFileSize();
+    --m_stats.entries;
+
+    m_index.erase(it->fname);
+    m_entries.erase(it);
+}
+
+void FileCache::evict()
+{
+    while(!m_entries.empty() && m_stats.bytes > m_budget)
+    {
+        eraseEntry(std::prev(m_entries.end()));
+        ++m_stats.evictions;
+    }
+}
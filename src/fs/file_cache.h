@@ -0,0 +1,61 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include "file.h"
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// LRU cache of loaded files with a byte budget. Entries are keyed by the path and a modification stamp
+// (file time of regular files, DOS time and header offset of zip entries), a changed file is a miss.
+// The file data is shared with the callers, a hit costs no copy. Thread safe.
+class FileCache
+{
+public:
+    struct Stats
+    {
+        size_t hits      = 0;
+        size_t misses    = 0;
+        size_t evictions = 0;
+        size_t entries   = 0;
+        size_t bytes     = 0;   // total size of the cached files
+    };
+
+    FileCache(size_t budget = 0) : m_budget(budget) {}
+
+    FileCache(FileCache const &)             = delete;
+    FileCache & operator=(FileCache const &) = delete;
+
+    bool   isEnabled() const { return getBudget() != 0; }
+    size_t getBudget() const;
+    void   setBudget(size_t budget);   // 0 disables the cache and releases the entries
+
+    std::optional<InFile> find(std::string const & fname, uint64_t stamp);
+    // files larger than the budget are not cached
+    void                  insert(std::string const & fname, uint64_t stamp, InFile const & file);
+    void                  erase(std::string const & fname);
+    void                  clear();
+
+    Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        std::string fname;
+        uint64_t    stamp = 0;
+        InFile      file;
+    };
+
+    void eraseEntry(std::list<Entry>::iterator it);
+    void evict();   // least recently used entries while over the budget
+
+    mutable std::mutex                                           m_mutex;
+    size_t                                                       m_budget = 0;
+    std::list<Entry>                                             m_entries;   // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+    Stats                                                        m_stats;
+};
+
+#endif   // FILECACHE_H
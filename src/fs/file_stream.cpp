@@ -0,0 +1,210 @@
+#include "file_stream.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+InputFileStream::InputFileStream(std::string name, std::string const & path)
+    : m_name(std::move(name)),
+      m_file(path, std::ios::binary)
+{
+    if(!m_file.is_open())
+        return;
+
+    m_file.seekg(0, std::ios_base::end);
+    m_source_size = static_cast<size_t>(m_file.tellg());
+    m_size        = m_source_size;
+    m_file.seekg(0, std::ios_base::beg);
+}
+
+InputFileStream::InputFileStream(std::string name, ZipArchive const & archive, uint64_t data_offset,
+                                 size_t source_size, size_t size, uint16_t method)
+    : m_name(std::move(name)),
+      m_archive(&archive),
+      m_data_offset(data_offset),
+      m_source_size(source_size),
+      m_size(method == ZipCodec::MethodStored ? source_size : size)
+{
+    if(method != ZipCodec::MethodStored)
+    {
+        m_decoder = ZipCodec::CreateDecoder(method);
+        if(!m_decoder)
+        {
+            std::stringstream ss;
+            ss << "InputFileStream File: " << m_name << " - unsupported compression method " << method;
+            std::cout << ss.str() << std::endl;
+            throw std::runtime_error("Unable to load file");
+        }
+    }
+}
+
+bool InputFileStream::isOpen() const
+{
+    return m_archive != nullptr || m_file.is_open();
+}
+
+bool InputFileStream::read(void * out_data, size_t byte_count)
+{
+    if(readSome(out_data, byte_count) != byte_count)
+    {
+        m_eof = true;
+        return false;
+    }
+
+    return true;
+}
+
+size_t InputFileStream::readSome(void * out_data, size_t max_count)
+{
+    int8_t * dst   = static_cast<int8_t *>(out_data);
+    size_t   count = 0;
+
+    while(count < max_count)
+    {
+        if(m_out_pos == m_out_size)
+        {
+            size_t const left = max_count - count;
+            if(left >= std::min(ChunkSize, m_size - m_produced))
+            {
+                // large reads and reads of the whole rest bypass the chunk buffer
+                size_t const read = readChunk(dst + count, left);
+                if(read == 0)
+                    break;
+
+                count += read;
+                continue;
+            }
+
+            if(!m_out_chunk)
+                m_out_chunk = std::make_unique<int8_t[]>(std::min(ChunkSize, m_size));
+
+            m_out_pos  = 0;
+            m_out_size = readChunk(m_out_chunk.get(), std::min(ChunkSize, m_size));
+            if(m_out_size == 0)
+                break;
+        }
+
+        size_t const part = std::min(max_count - count, m_out_size - m_out_pos);
+        std::memcpy(dst + count, m_out_chunk.get() + m_out_pos, part);
+        m_out_pos += part;
+        count += part;
+    }
+
+    m_head += count;
+    return count;
+}
+
+bool InputFileStream::skip(size_t byte_count)
+{
+    int8_t scratch[4096];
+
+    while(byte_count > 0)
+    {
+        size_t const part = std::min(byte_count, sizeof(scratch));
+        if(!read(scratch, part))
+            return false;
+
+        byte_count -= part;
+    }
+
+    return true;
+}
+
+void InputFileStream::resetHead()
+{
+    m_source_pos = 0;
+    m_produced   = 0;
+    m_head       = 0;
+    m_out_pos    = 0;
+    m_out_size   = 0;
+    m_in_size    = 0;
+    m_finished   = false;
+    m_eof        = false;
+
+    if(m_decoder)
+        m_decoder->reset();
+
+    if(m_file.is_open())
+    {
+        m_file.clear();
+        m_file.seekg(0, std::ios_base::beg);
+    }
+}
+
+size_t InputFileStream::readChunk(int8_t * buffer, size_t length)
+{
+    length = std::min(length, m_size - m_produced);
+    if(length == 0)
+        return 0;
+
+    if(!m_decoder)
+    {
+        readSource(buffer, length);
+        m_produced += length;
+        return length;
+    }
+
+    if(!m_in_chunk)
+        m_in_chunk = std::make_unique<unsigned char[]>(std::min(ChunkSize, m_source_size));
+
+    auto * out      = reinterpret_cast<unsigned char *>(buffer);
+    size_t out_size = length;
+
+    while(out_size > 0 && !m_finished)
+    {
+        if(m_in_size == 0)
+        {
+            size_t const in_size = std::min(ChunkSize, m_source_size - m_source_pos);
+            if(in_size == 0)
+                break;
+
+            readSource(m_in_chunk.get(), in_size);
+            m_in_ptr  = m_in_chunk.get();
+            m_in_size = in_size;
+        }
+
+        if(!m_decoder->decode(m_in_ptr, m_in_size, out, out_size, m_finished))
+            throw std::runtime_error("Decompression error while reading zip file");
+    }
+
+    size_t const produced = length - out_size;
+    m_produced += produced;
+
+    return produced;
+}
+
+void InputFileStream::readSource(void * buffer, size_t length)
+{
+    bool success = false;
+
+    if(m_archive != nullptr)
+    {
+        success = m_archive->read(buffer, length, m_data_offset + m_source_pos);
+    }
+    else
+    {
+        m_file.read(static_cast<char *>(buffer), static_cast<std::streamsize>(length));
+        success = !m_file.fail();
+    }
+
+    if(!success)
+    {
+        std::stringstream ss;
+        ss << "InputFileStream::ReadSource File: " << m_name << " - read error";
+        std::cout << ss.str() << std::endl;
+        throw std::runtime_error("Unable to load file");
+    }
+
+    m_source_pos += length;
+}
+
+InputFileStream & GetLine(InputFileStream & input_stream, std::string & out_str)
+{
+    char ch;
+    out_str.clear();
+    while(input_stream.read(ch) && ch != '\n')
+        out_str.push_back(ch);
+    return input_stream;
+}
@@ -0,0 +1,76 @@
+#ifndef FILESTREAM_H
+#define FILESTREAM_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "zip_codec.h"
+
+class ZipArchive;
+
+// Sequential reader over a regular file or a zip entry of the FileSystem. The data is read and inflated
+// in fixed size chunks on demand, so memory use is bounded by two chunks whatever the file size.
+// Reads larger than a chunk are inflated directly into the destination buffer.
+class InputFileStream
+{
+public:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    InputFileStream(std::string name, std::string const & path);   // regular file
+    // zip entry, source_size is the stored size, method one of ZipCodec::Method...
+    InputFileStream(std::string name, ZipArchive const & archive, uint64_t data_offset, size_t source_size,
+                    size_t size, uint16_t method);
+    ~InputFileStream() = default;
+
+    InputFileStream(InputFileStream &&)             = default;
+    InputFileStream & operator=(InputFileStream &&) = default;
+
+    bool   read(void * out_data, size_t byte_count);      // false if fewer bytes are left
+    size_t readSome(void * out_data, size_t max_count);   // returns the read byte count, 0 at the end
+    bool   skip(size_t byte_count);
+
+    template<typename T>
+    bool read(T & out_data)
+    {
+        static_assert(std::is_standard_layout_v<T>, "Generic Read only supports primitive data types");
+        return read(reinterpret_cast<void *>(&out_data), sizeof(out_data));
+    }
+
+    bool                isOpen() const;
+    std::string const & getName() const { return m_name; }
+    size_t              getSize() const { return m_size; }   // uncompressed size
+    size_t              getRemainingDataSize() const { return m_size - m_head; }
+    explicit            operator bool() const { return !m_eof; }
+
+    void resetHead();   // restarts reading (and inflating) from the beginning
+
+private:
+    size_t readChunk(int8_t * buffer, size_t length);   // produces the next bytes of the file
+    void   readSource(void * buffer, size_t length);    // raw (compressed) bytes
+
+    std::string                        m_name;
+    ZipArchive const *                 m_archive     = nullptr;   // zip entry source
+    uint64_t                           m_data_offset = 0;
+    std::ifstream                      m_file;   // regular file source
+    size_t                             m_source_size = 0;
+    size_t                             m_source_pos  = 0;
+    size_t                             m_size        = 0;
+    size_t                             m_produced    = 0;   // bytes produced from the source
+    size_t                             m_head        = 0;   // bytes returned to the caller
+    std::unique_ptr<ZipCodec::Decoder> m_decoder;           // nullptr for not compressed data
+    bool                               m_finished = false;   // end of the compressed stream
+    std::unique_ptr<unsigned char[]>   m_in_chunk;           // compressed input
+    unsigned char const *              m_in_ptr  = nullptr;
+    size_t                             m_in_size = 0;
+    std::unique_ptr<int8_t[]>          m_out_chunk;   // buffered output for small reads
+    size_t                             m_out_pos  = 0;
+    size_t                             m_out_size = 0;
+    bool                               m_eof      = false;
+};
+
+InputFileStream & GetLine(InputFileStream & input_stream, std::string & out_str);
+
+#endif   // FILESTREAM_H
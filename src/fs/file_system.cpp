@@ -5,36 +5,15 @@
 #include <ctime>
 #include <filesystem>
 #include <fstream>
-#include <zlib.h>
 #include <iostream>
 #include <sstream>
 
 #include "zip.h"
+#include "zip_codec.h"
 
 // https://medium.com/@sshambir/%D0%BF%D1%80%D0%B8%D0%B2%D0%B5%D1%82-std-filesystem-4c7ed50d5634
 namespace fs = std::filesystem;
 
-// https://stackoverflow.com/questions/61030383/how-to-convert-stdfilesystemfile-time-type-to-time-t
-template<typename TP>
-std::time_t To_time_t(TP tp)
-{
-    using namespace std::chrono;
-    auto sctp = time_point_cast<system_clock::duration>(tp - TP::clock::now() + system_clock::now());
-    return system_clock::to_time_t(sctp);
-}
-
-void GetDosTime(std::time_t rawtime, uint16_t & time, uint16_t & date)
-{
-    // http://stackoverflow.com/questions/15763259/unix-timestamp-to-fat-timestamp
-    struct tm * timeinfo;
-    timeinfo = localtime(&rawtime);
-
-    time =
-        static_cast<uint16_t>((timeinfo->tm_hour << 11) | (timeinfo->tm_min << 5) | (timeinfo->tm_sec >> 1));
-    date = static_cast<uint16_t>(((timeinfo->tm_year - 80) << 9) | ((timeinfo->tm_mon + 1) << 5)
-                                 | (timeinfo->tm_mday));
-}
-
 std::chrono::system_clock::time_point
 file_time_to_time_point(std::filesystem::file_time_type const & file_time)
 {
@@ -106,6 +85,8 @@ FileSystem::FileSystem(std::string root_dir)
     assert(!root_dir.empty());
 
     std::swap(m_data_dir, root_dir);
+    m_pool = std::make_unique<ThreadPool>();
+
     std::list<std::string> zip_file_list;
 
     fs::path p(m_data_dir);
@@ -126,10 +107,7 @@ FileSystem::FileSystem(std::string root_dir)
                     std::string tmp_fname = lp.generic_string();
                     tmp_fname.erase(0, m_data_dir.length() + 1);
 
-                    FileData fd;
-                    fd.fname = tmp_fname;
-
-                    m_files.emplace_back(std::move(fd));
+                    addFileData(std::move(tmp_fname), FileData{});
                 }
             }
         }
@@ -140,40 +118,183 @@ FileSystem::FileSystem(std::string root_dir)
                       [this](std::string const & fname) { this->addZippedDir(fname); });
 }
 
+std::string FileSystem::NormalizePath(std::string path)
+{
+    std::replace(path.begin(), path.end(), '\\', '/');
+
+    std::string result;
+    result.reserve(path.size());
+
+    for(size_t i = 0; i < path.size(); ++i)
+    {
+        if(path[i] == '/' && (result.empty() || result.back() == '/'))
+            continue;   // leading or repeated separator
+
+        if(path[i] == '.' && (result.empty() || result.back() == '/')
+           && (i + 1 == path.size() || path[i + 1] == '/'))
+        {
+            ++i;   // "./" component
+            continue;
+        }
+
+        result.push_back(path[i]);
+    }
+
+    if(!result.empty() && result.back() == '/')
+        result.pop_back();
+
+    return result;
+}
+
+void FileSystem::addFileData(std::string fname, FileData fd)
+{
+    std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+
+    auto const position = static_cast<std::uint32_t>(m_files.size());
+    auto [it, inserted] = m_index.emplace(NormalizePath(std::move(fname)), position);
+
+    if(inserted)
+    {
+        fd.fname = &it->first;
+        m_files.push_back(fd);
+    }
+}
+
+void FileSystem::watchChanges(bool enable)
+{
+    if(!enable)
+        m_watcher.reset();
+    else if(!m_watcher)
+        m_watcher = std::make_unique<FileWatcher>(m_data_dir);
+}
+
+std::vector<std::string> FileSystem::pollChanges()
+{
+    if(!m_watcher)
+        return {};
+
+    std::vector<std::string> changed = m_watcher->poll();
+    for(auto & fname : changed)
+    {
+        fname = NormalizePath(std::move(fname));
+        m_cache.erase(fname);
+
+        std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+
+        auto it = m_index.find(fname);
+        if(it == m_index.end())
+        {
+            lock.unlock();
+            addFileData(fname, FileData{});
+        }
+        else if(m_files[it->second].archive != -1)
+        {
+            // a new regular file takes the place of the zip entry, pending loads have their own copy
+            m_files[it->second]       = FileData{};
+            m_files[it->second].fname = &it->first;
+        }
+    }
+
+    return changed;
+}
+
+size_t FileSystem::getNumFiles() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+
+    return m_files.size();
+}
+
+std::optional<FileSystem::FileData> FileSystem::findFile(std::string const & fname) const
+{
+    // the entry is copied, m_files may grow or be changed by the main thread after the lock is released;
+    // the interned names are never erased, so the fname pointer stays valid
+    std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+
+    auto it = m_index.find(fname);
+    if(it == m_index.end())
+        it = m_index.find(NormalizePath(fname));
+
+    if(it == m_index.end())
+        return {};
+
+    std::lock_guard<std::mutex> offset_lock(m_offset_mutex);
+    return m_files[it->second];
+}
+
+std::vector<std::string> FileSystem::getFilesInDir(std::string const & dir) const
+{
+    std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+
+    if(m_sorted.size() != m_files.size())
+    {
+        m_sorted.resize(m_files.size());
+        for(std::uint32_t i = 0; i < m_sorted.size(); ++i)
+            m_sorted[i] = i;
+
+        std::sort(m_sorted.begin(), m_sorted.end(), [this](std::uint32_t left, std::uint32_t right) {
+            return *m_files[left].fname < *m_files[right].fname;
+        });
+    }
+
+    std::string prefix = NormalizePath(dir);
+    if(!prefix.empty())
+        prefix.push_back('/');
+
+    auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), prefix,
+                               [this](std::uint32_t pos, std::string const & value) {
+                                   return *m_files[pos].fname < value;
+                               });
+
+    std::vector<std::string> result;
+    for(; it != m_sorted.end() && m_files[*it].fname->compare(0, prefix.size(), prefix) == 0; ++it)
+        result.push_back(*m_files[*it].fname);
+
+    return result;
+}
+
 void FileSystem::addZippedDir(std::string const & fname)
 {
-    std::ifstream ifs;
-    ifs.open(fname, std::ifstream::in | std::ifstream::binary);
-    if(!ifs.is_open())
+    auto archive_ptr = std::make_unique<ZipArchive>(fname);
+    if(!archive_ptr->isOpen())
+        return;
+
+    ZipArchive const & archive   = *archive_ptr;
+    uint64_t const     file_size = archive.getSize();
+
+    if(file_size < sizeof(uint32_t) + sizeof(EOCD))
     {
         std::stringstream ss;
-        ss << "FileSystem::AddZippedDir File: " << fname << " - not found";
+        ss << "FileSystem::AddZippedDir File: " << fname << " - too small for zip file";
         std::cout << ss.str() << std::endl;
         return;
     }
 
-    // get length of file:
-    ifs.seekg(0, std::ifstream::end);
-    size_t const file_size   = static_cast<size_t>(ifs.tellg());
-    size_t       EOCD_offset = 0;
+    // EOCD is in the tail: the record itself and a comment of at most 64 KB
+    size_t const      tail_size   = static_cast<size_t>(std::min<uint64_t>(file_size, 0xFFFF + 22 + 20));
+    uint64_t const    tail_offset = file_size - tail_size;
+    std::vector<char> tail(tail_size);
 
-    assert(file_size > sizeof(EOCD));
+    if(!archive.read(tail.data(), tail_size, tail_offset))
+        return;
+
+    size_t EOCD_pos = 0;   // position of the EOCD signature in the tail
+    bool   found    = false;
 
-    for(size_t offset = file_size - sizeof(EOCD); offset != 0; --offset)
+    for(size_t pos = tail_size - sizeof(uint32_t) - sizeof(EOCD) + 1; pos-- > 0;)
     {
         uint32_t signature = 0;
-
-        ifs.seekg(offset, std::ifstream::beg);
-        ifs.read(reinterpret_cast<char *>(&signature), sizeof(signature));
+        std::memcpy(&signature, tail.data() + pos, sizeof(signature));
 
         if(0x06054b50 == signature)
         {
-            EOCD_offset = static_cast<size_t>(ifs.tellg());
+            EOCD_pos = pos;
+            found    = true;
             break;
         }
     }
 
-    if(EOCD_offset == 0)
+    if(!found)
     {
         std::stringstream ss;
         ss << "FileSystem::AddZippedDir File: " << fname << " - not found EOCD_offset signature";
@@ -182,18 +303,63 @@ void FileSystem::addZippedDir(std::string const & fname)
     }
 
     EOCD eocd{};
-    ifs.seekg(EOCD_offset, std::ifstream::beg);
-    ifs.read(reinterpret_cast<char *>(&eocd), sizeof(eocd));
+    std::memcpy(&eocd, tail.data() + EOCD_pos + sizeof(uint32_t), sizeof(eocd));
 
-    ifs.seekg(eocd.central_directory_offset, std::ifstream::beg);
-    CentralDirectoryFileHeader cdfh{};
+    uint64_t num_entries = eocd.number_central_directory_record;
+    uint64_t cd_size     = eocd.size_of_central_directory;
+    uint64_t cd_offset   = eocd.central_directory_offset;
 
-    for(uint16_t i = 0; i < eocd.number_central_directory_record; ++i)
+    // Zip64: the locator is right before the EOCD record, the real values are in the zip64 EOCD record
+    if((num_entries == 0xFFFF || cd_size == 0xFFFFFFFF || cd_offset == 0xFFFFFFFF)
+       && EOCD_pos >= sizeof(Zip64EOCDLocator))
     {
-        FileData zfile;
-        zfile.is_zip = true;
+        Zip64EOCDLocator locator{};
+        std::memcpy(&locator, tail.data() + EOCD_pos - sizeof(locator), sizeof(locator));
 
-        ifs.read(reinterpret_cast<char *>(&cdfh), sizeof(cdfh));
+        Zip64EOCD eocd64{};
+        if(0x07064b50 == locator.signature
+           && archive.read(&eocd64, sizeof(eocd64), locator.zip64_eocd_offset)
+           && 0x06064b50 == eocd64.signature)
+        {
+            num_entries = eocd64.number_central_directory_record;
+            cd_size     = eocd64.size_of_central_directory;
+            cd_offset   = eocd64.central_directory_offset;
+        }
+    }
+
+    if(cd_size > file_size || cd_offset > file_size - cd_size)
+    {
+        std::stringstream ss;
+        ss << "FileSystem::AddZippedDir File: " << fname << " - broken central directory";
+        std::cout << ss.str() << std::endl;
+        return;
+    }
+
+    // the count of a crafted zip64 record could be anything, only this many headers fit the directory
+    num_entries = std::min<uint64_t>(num_entries, cd_size / sizeof(CentralDirectoryFileHeader));
+
+    // whole central directory with one read
+    std::vector<char> cd(static_cast<size_t>(cd_size));
+    if(!archive.read(cd.data(), cd.size(), cd_offset))
+        return;
+
+    int32_t const archive_index = static_cast<int32_t>(m_archives.size());
+    m_archives.push_back(std::move(archive_ptr));
+
+    {
+        std::unique_lock<std::shared_mutex> lock(m_index_mutex);
+        m_files.reserve(m_files.size() + static_cast<size_t>(num_entries));
+        m_index.reserve(m_index.size() + static_cast<size_t>(num_entries));
+    }
+
+    size_t pos = 0;
+    for(uint64_t i = 0; i < num_entries; ++i)
+    {
+        CentralDirectoryFileHeader cdfh{};
+
+        if(pos + sizeof(cdfh) > cd.size())
+            break;
+        std::memcpy(&cdfh, cd.data() + pos, sizeof(cdfh));
 
         if(0x02014b50 != cdfh.signature)
         {
@@ -204,6 +370,13 @@ void FileSystem::addZippedDir(std::string const & fname)
             return;
         }
 
+        char const * const name_ptr  = cd.data() + pos + sizeof(cdfh);
+        char const * const extra_ptr = name_ptr + cdfh.filename_length;
+        pos += sizeof(cdfh) + cdfh.filename_length + cdfh.extra_field_length + cdfh.file_comment_length;
+
+        if(pos > cd.size())
+            break;
+
         if(cdfh.general_purpose_bit_flag & 0x1)   // encrypted
         {
             std::stringstream ss;
@@ -219,39 +392,60 @@ void FileSystem::addZippedDir(std::string const & fname)
             return;
         }
 
-        if(cdfh.filename_length)
+        if(!ZipCodec::IsSupported(cdfh.compression_method))
         {
-            std::unique_ptr<char[]> filename = std::make_unique<char[]>(cdfh.filename_length + 1);
-            ifs.read(reinterpret_cast<char *>(filename.get()), cdfh.filename_length);
-
-            filename[cdfh.filename_length] = 0;
-
-            zfile.zip_data.fname = std::string(filename.get());
+            std::stringstream ss;
+            ss << "FileSystem::AddZippedDir File: " << fname << " - unsupported compression method "
+               << cdfh.compression_method << " of " << std::string(name_ptr, cdfh.filename_length);
+            std::cout << ss.str() << std::endl;
+            continue;
         }
 
-        if(cdfh.compression_method != 0 && cdfh.compression_method != Z_DEFLATED)
+        FileData zfile;
+        zfile.archive           = archive_index;
+        zfile.method            = cdfh.compression_method;
+        zfile.compressed_size   = cdfh.compressed_size;
+        zfile.uncompressed_size = cdfh.uncompressed_size;
+        zfile.lfh_offset        = cdfh.local_file_header_offset;
+        zfile.modification_time = cdfh.modification_time;
+        zfile.modification_date = cdfh.modification_date;
+
+        // Zip64 extended information: 64-bit values of the fields set to 0xFFFFFFFF, in this order
+        for(char const * extra = extra_ptr; extra + 4 <= extra_ptr + cdfh.extra_field_length;)
         {
-            continue;
-        }
+            uint16_t header_id = 0, data_size = 0;
+            std::memcpy(&header_id, extra, sizeof(header_id));
+            std::memcpy(&data_size, extra + 2, sizeof(data_size));
+
+            char const * value     = extra + 4;
+            char const * value_end = std::min(value + data_size, extra_ptr + cdfh.extra_field_length);
+            auto         read_u64  = [&value, value_end](size_t & field) {
+                if(value + sizeof(uint64_t) <= value_end)
+                {
+                    uint64_t v = 0;
+                    std::memcpy(&v, value, sizeof(v));
+                    field = static_cast<size_t>(v);
+                    value += sizeof(uint64_t);
+                }
+            };
 
-        zfile.zip_data.compressed        = (Z_DEFLATED == cdfh.compression_method);
-        zfile.zip_data.compressed_size   = cdfh.compressed_size;
-        zfile.zip_data.uncompressed_size = cdfh.uncompressed_size;
-        zfile.zip_data.lfh_offset        = cdfh.local_file_header_offset;
+            if(header_id == 0x0001)
+            {
+                if(cdfh.uncompressed_size == 0xFFFFFFFF)
+                    read_u64(zfile.uncompressed_size);
+                if(cdfh.compressed_size == 0xFFFFFFFF)
+                    read_u64(zfile.compressed_size);
+                if(cdfh.local_file_header_offset == 0xFFFFFFFF)
+                    read_u64(zfile.lfh_offset);
+                break;
+            }
 
-        if(zfile.zip_data.uncompressed_size != 0 || zfile.zip_data.compressed != 0)
-        {
-            zfile.fname = fname;
-            m_files.emplace_back(std::move(zfile));
+            extra += 4 + data_size;
         }
 
-        if(cdfh.extra_field_length)
+        if(zfile.uncompressed_size != 0 || zfile.method != ZipCodec::MethodStored)
         {
-            ifs.seekg(cdfh.extra_field_length, std::ifstream::cur);
-        }
-        if(cdfh.file_comment_length)
-        {
-            ifs.seekg(cdfh.file_comment_length, std::ifstream::cur);
+            addFileData(std::string(name_ptr, cdfh.filename_length), zfile);
         }
     }
 }
@@ -260,48 +454,25 @@ bool FileSystem::isExist(std::string const & fname) const
 {
     assert(!fname.empty());
 
-    for(auto & fl : m_files)
-    {
-        if(fl.is_zip)
-        {
-            if(fname == fl.zip_data.fname)
-                return true;
-        }
-        else
-        {
-            if(fname == fl.fname)
-                return true;
-        }
-    }
-
-    return false;
+    return findFile(fname).has_value();
 }
 
 std::optional<InFile> FileSystem::getFile(std::string const & fname) const
 {
     assert(!fname.empty());
 
-    auto res = std::find_if(m_files.begin(), m_files.end(), [&fname](FileData const & f) -> bool {
-        if(f.is_zip)
-        {
-            if(fname == f.zip_data.fname)
-                return true;
-        }
-        else
-        {
-            if(fname == f.fname)
-                return true;
-        }
+    if(auto res = findFile(fname); res)
+    {
+        if(!m_cache.isEnabled())
+            return res->archive >= 0 ? loadZipFile(*res) : loadRegularFile(*res);
 
-        return false;
-    });
+        uint64_t const stamp = getModificationStamp(*res);
+        if(auto cached = m_cache.find(*res->fname, stamp); cached)
+            return cached;
 
-    if(res != m_files.end())
-    {
-        if((*res).is_zip)
-            return loadZipFile(*res);
-        else
-            return loadRegularFile(*res);
+        InFile file = res->archive >= 0 ? loadZipFile(*res) : loadRegularFile(*res);
+        m_cache.insert(*res->fname, stamp, file);
+        return file;
     }
     else
     {
@@ -312,386 +483,167 @@ std::optional<InFile> FileSystem::getFile(std::string const & fname) const
     }
 }
 
-bool FileSystem::writeFile(BaseFile const & file, std::string path)
+std::optional<InputFileStream> FileSystem::openStream(std::string const & fname) const
 {
-    std::string filename = file.getName();
-
-    if(!path.empty())
-        filename = path + '/' + filename;
+    assert(!fname.empty());
 
-    std::ofstream ofs(std::string(m_data_dir + '/' + filename), std::ios::binary);
-    if(!ofs.is_open())
+    auto res = findFile(fname);
+    if(!res)
     {
         std::stringstream ss;
-        ss << "FileSystem::WriteFile File: " << filename << " - not writed";
+        ss << "FileSystem::OpenStream File: " << fname << " - not found";
         std::cout << ss.str() << std::endl;
-        return false;
+        return {};
     }
-    ofs.write(reinterpret_cast<char *>(const_cast<int8_t *>(file.getData())),
-              static_cast<std::streamsize>(file.getFileSize()));
-    ofs.close();
 
-    if(!isExist(filename))
+    if(res->archive < 0)
     {
-        FileData fd;
-        fd.fname = filename;
+        InputFileStream stream(*res->fname, m_data_dir + '/' + *res->fname);
+        if(!stream.isOpen())
+            return {};
 
-        m_files.emplace_back(std::move(fd));
+        return stream;
     }
 
-    return true;
+    if(!resolveDataOffset(*res))
+        return {};
+
+    return InputFileStream(*res->fname, *m_archives[res->archive], res->data_offset, res->compressed_size,
+                           res->uncompressed_size, res->method);
 }
 
-// http://blog2k.ru/archives/3397
-bool FileSystem::createZIP(std::vector<BaseFile const *> filelist, std::string const & zipname)
+std::future<std::optional<InFile>> FileSystem::getFileAsync(std::string const & fname) const
 {
-    // http://stackoverflow.com/questions/922360/why-cant-i-make-a-vector-of-references
-    assert(!filelist.empty());
-    assert(!zipname.empty());
-
-    struct FileInfo
-    {
-        uint32_t compressed_size;
-        uint32_t uncompressed_size;
-        uint16_t compression_method;
-        uint32_t crc32;
-        uint32_t offset;
-    };
-
-    // Buffer for compressed data
-    std::vector<uint8_t> data_buffer;
-    // Information for creation Central directory file header
-    std::vector<FileInfo> file_info_list;
-
-    std::ofstream ofs(std::string(m_data_dir + '/' + zipname), std::ofstream::binary | std::ofstream::trunc);
-    if(!ofs.is_open())
-    {
-        return false;
-    }
-
-    uint16_t time = 0;
-    uint16_t date = 0;
-
-    for(size_t i = 0; i < filelist.size(); i++)
-    {
-        assert(filelist[i] != nullptr);
-
-        std::string       fname = filelist[i]->getName();
-        std::vector<char> buf;
-        buf.resize(filelist[i]->getFileSize());
-        buf.assign(filelist[i]->getData(), filelist[i]->getData() + filelist[i]->getFileSize());
-
-        LocalFileHeader lfh{};
-        memset(&lfh, 0, sizeof(lfh));
-
-        lfh.uncompressed_size = static_cast<uint32_t>(buf.size());
-
-        lfh.crc32 = static_cast<uint32_t>(
-            crc32(0, reinterpret_cast<unsigned char const *>(buf.data()), lfh.uncompressed_size));
-
-        // Let's allocate memory for compressed data
-        data_buffer.resize(lfh.uncompressed_size);
-
-        // Structure for data compression
-        z_stream zStream;
-        memset(&zStream, 0, sizeof(zStream));
-        deflateInit2(&zStream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
-
-        // Compressing data
-        zStream.avail_in  = lfh.uncompressed_size;
-        zStream.next_in   = reinterpret_cast<unsigned char *>(buf.data());
-        zStream.avail_out = lfh.uncompressed_size;
-        zStream.next_out  = data_buffer.data();
-        deflate(&zStream, Z_FINISH);
+    return m_pool->enqueue([this, fname]() { return getFile(fname); });
+}
 
-        // Compressed data size
-        char *   data_ptr = nullptr;
-        uint32_t size     = 0;
-        if(zStream.total_out >= lfh.uncompressed_size)
+void FileSystem::getFileAsync(std::string const & fname, LoadCallback on_loaded) const
+{
+    m_pool->enqueue([this, fname, on_loaded = std::move(on_loaded)]() {
+        auto result = std::make_shared<std::optional<InFile>>();
+        try
         {
-            lfh.compressed_size    = lfh.uncompressed_size;
-            lfh.compression_method = 0;
-
-            data_ptr = buf.data();
-            size     = lfh.uncompressed_size;
+            *result = getFile(fname);
         }
-        else
+        catch(std::exception const & e)
         {
-            lfh.compressed_size    = static_cast<uint32_t>(zStream.total_out);
-            lfh.compression_method = Z_DEFLATED;
-
-            data_ptr = reinterpret_cast<char *>(data_buffer.data());
-            size     = lfh.compressed_size;
+            std::stringstream ss;
+            ss << "FileSystem::GetFileAsync File: " << fname << " - " << e.what();
+            std::cerr << ss.str() << std::endl;
         }
 
-        deflateEnd(&zStream);
-
-        lfh.filename_length = static_cast<uint16_t>(fname.size());
-
-        // Save the offset to the record Local File Header внутри архива
-        uint32_t const lfh_offset = static_cast<uint32_t>(ofs.tellp());
-
-        GetDosTime(To_time_t(filelist[i]->timeStamp()), time, date);
-
-        // Write down the signature Local File Header
-        lfh.signature         = 0x04034b50;
-        lfh.modification_date = date;
-        lfh.modification_time = time;
-        // Write down Local File Header
-        ofs.write(reinterpret_cast<char *>(&lfh), sizeof(lfh));
-        // Write down filename
-        ofs.write(fname.c_str(), static_cast<std::streamsize>(fname.size()));
-        // Write down data
-        ofs.write(data_ptr, static_cast<std::streamsize>(size));
-
-        // Let's save all the data for Central directory file header
-        FileInfo file_info{};
-        file_info.compressed_size    = lfh.compressed_size;
-        file_info.uncompressed_size  = lfh.uncompressed_size;
-        file_info.compression_method = lfh.compression_method;
-        file_info.crc32              = lfh.crc32;
-        file_info.offset             = lfh_offset;
-        file_info_list.push_back(file_info);
-    }
+        postToMainThread([on_loaded, result]() { on_loaded(std::move(*result)); });
+    });
+}
 
-    // Offset of the first record for EOCD
-    uint32_t const first_offset_CDFH = static_cast<uint32_t>(ofs.tellp());
+void FileSystem::postToMainThread(std::function<void()> task) const
+{
+    std::lock_guard<std::mutex> lock(m_completed_mutex);
+    m_completed.push_back(std::move(task));
+}
 
-    for(uint32_t i = 0; i < filelist.size(); ++i)
+size_t FileSystem::processCompleted() const
+{
+    std::vector<std::function<void()>> completed;
     {
-        std::string const &        filename  = filelist[i]->getName();
-        FileInfo const &           file_info = file_info_list[i];
-        CentralDirectoryFileHeader cdfh{};
-        memset(&cdfh, 0, sizeof(cdfh));
-
-        GetDosTime(To_time_t(filelist[i]->timeStamp()), time, date);
-
-        cdfh.compressed_size          = file_info.compressed_size;
-        cdfh.uncompressed_size        = file_info.uncompressed_size;
-        cdfh.compression_method       = file_info.compression_method;
-        cdfh.crc32                    = file_info.crc32;
-        cdfh.local_file_header_offset = file_info.offset;
-        cdfh.filename_length          = static_cast<uint16_t>(filename.size());
-        cdfh.signature                = 0x02014b50;
-        cdfh.modification_date        = date;
-        cdfh.modification_time        = time;
-
-        ofs.write(reinterpret_cast<char *>(&cdfh), sizeof(cdfh));
-
-        ofs.write(filename.c_str(), cdfh.filename_length);
+        std::lock_guard<std::mutex> lock(m_completed_mutex);
+        completed.swap(m_completed);
     }
 
-    // Let's calculate the data size for the next step
-    uint32_t const last_offset_CDFH = static_cast<uint32_t>(ofs.tellp());
-
-    EOCD eocd{};
-    memset(&eocd, 0, sizeof(eocd));
-    eocd.central_directory_offset        = first_offset_CDFH;
-    eocd.number_central_directory_record = static_cast<uint16_t>(filelist.size());
-    eocd.total_central_directory_record  = static_cast<uint16_t>(filelist.size());
-    eocd.size_of_central_directory       = last_offset_CDFH - first_offset_CDFH;
-
-    // Write a signature
-    uint32_t signature = 0x06054b50;
-    ofs.write(reinterpret_cast<char *>(&signature), sizeof(signature));
-
-    // Write EOCD
-    ofs.write(reinterpret_cast<char *>(&eocd), sizeof(eocd));
+    // completions may queue new loads
+    for(auto & task : completed)
+        task();
 
-    ofs.close();
-    return true;
+    return completed.size();
 }
 
-bool FileSystem::addFileToZIP(BaseFile const * file, std::string const & zipname)
+std::shared_ptr<MappedFile> FileSystem::mapFile(std::string const & fname) const
 {
-    assert(!zipname.empty());
-    assert(file != nullptr);
-
-    std::fstream ofs(m_data_dir + '/' + zipname,
-                     std::fstream::binary | std::fstream::ate | std::fstream::out | std::fstream::in);
-    if(!ofs.is_open())
-    {
-        return false;
-    }
-
-    size_t const file_size   = static_cast<size_t>(ofs.tellg());
-    size_t       EOCD_offset = 0;
+    assert(!fname.empty());
 
-    for(size_t offset = file_size - sizeof(EOCD); offset != 0; --offset)
-    {
-        uint32_t signature = 0;
+    auto res = findFile(fname);
+    if(!res)
+        return nullptr;
 
-        ofs.seekg(offset, std::fstream::beg);
-        ofs.read(reinterpret_cast<char *>(&signature), sizeof(signature));
+    if(res->archive < 0)
+        return MappedFile::Map(m_data_dir + '/' + *res->fname);
 
-        if(0x06054b50 == signature)
-        {
-            EOCD_offset = static_cast<size_t>(ofs.tellg());
-            break;
-        }
-    }
+    if(res->method != ZipCodec::MethodStored)
+        return nullptr;
 
-    if(EOCD_offset == 0)
-        return false;
+    if(!resolveDataOffset(*res))
+        return nullptr;
 
-    EOCD eocd{};
-    ofs.seekg(EOCD_offset, std::fstream::beg);
-    ofs.read(reinterpret_cast<char *>(&eocd), sizeof(eocd));
+    return MappedFile::Map(m_archives[res->archive]->getName(), res->data_offset, res->uncompressed_size);
+}
 
-    auto central_directory_data = std::make_unique<char[]>(eocd.size_of_central_directory);
-    ofs.seekg(eocd.central_directory_offset, std::fstream::beg);
-    ofs.read(central_directory_data.get(), static_cast<std::streamsize>(eocd.size_of_central_directory));
-    ofs.seekg(eocd.central_directory_offset, std::fstream::beg);
+bool FileSystem::writeFile(BaseFile const & file, std::string path)
+{
+    std::string filename = file.getName();
 
-    std::vector<std::string> zip_fnames;
+    if(!path.empty())
+        filename = path + '/' + filename;
 
-    for(uint16_t i = 0; i < eocd.number_central_directory_record; ++i)
+    std::ofstream ofs(std::string(m_data_dir + '/' + filename), std::ios::binary);
+    if(!ofs.is_open())
     {
-        CentralDirectoryFileHeader cdfh{};
-
-        ofs.read(reinterpret_cast<char *>(&cdfh), sizeof(cdfh));
-
-        if(0x02014b50 != cdfh.signature)
-        {
-            return false;
-        }
-
-        if(cdfh.filename_length)
-        {
-            auto filename = std::make_unique<char[]>(cdfh.filename_length + 1);
-            ofs.read(static_cast<char *>(filename.get()), cdfh.filename_length);
-
-            filename[cdfh.filename_length] = 0;
-
-            zip_fnames.push_back(std::string(filename.get()));
-        }
+        std::stringstream ss;
+        ss << "FileSystem::WriteFile File: " << filename << " - not writed";
+        std::cout << ss.str() << std::endl;
+        return false;
     }
+    ofs.write(reinterpret_cast<char *>(const_cast<int8_t *>(file.getData())),
+              static_cast<std::streamsize>(file.getFileSize()));
+    ofs.close();
 
-    ofs.seekg(eocd.central_directory_offset, std::fstream::beg);
-
-    auto file_it = std::find_if(zip_fnames.begin(), zip_fnames.end(),
-                                [&file](std::string const & zn) -> bool { return file->getName() == zn; });
-
-    if(file_it != zip_fnames.end())
-        return false;   // If there is a file with this name
-
-    uint16_t time = 0;
-    uint16_t date = 0;
-    GetDosTime(To_time_t(file->timeStamp()), time, date);
-
-    LocalFileHeader lfh{};
-    memset(&lfh, 0, sizeof(lfh));
-    // Buffer for compressed data
-    std::vector<uint8_t> data_buffer;
-
-    lfh.uncompressed_size = static_cast<uint32_t>(file->getFileSize());
-
-    lfh.crc32 = static_cast<uint32_t>(
-        crc32(0, reinterpret_cast<unsigned char const *>(file->getData()), lfh.uncompressed_size));
-
-    // Let's allocate memory for compressed data
-    data_buffer.resize(lfh.uncompressed_size);
-
-    // Structure for data compression
-    z_stream z_stream;
-    memset(&z_stream, 0, sizeof(z_stream));
-    deflateInit2(&z_stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    addFileData(filename, FileData{});
 
-    // Compressing data
-    z_stream.avail_in  = lfh.uncompressed_size;
-    z_stream.next_in   = reinterpret_cast<unsigned char *>(const_cast<int8_t *>(file->getData()));
-    z_stream.avail_out = lfh.uncompressed_size;
-    z_stream.next_out  = data_buffer.data();
-    auto res           = deflate(&z_stream, Z_FINISH);
+    return true;
+}
 
-    if(res != Z_STREAM_END)
-        throw std::runtime_error("Deflate error while writing zip file");
+// http://blog2k.ru/archives/3397
+bool FileSystem::createZIP(std::vector<BaseFile const *> filelist, std::string const & zipname)
+{
+    // http://stackoverflow.com/questions/922360/why-cant-i-make-a-vector-of-references
+    assert(!filelist.empty());
+    assert(!zipname.empty());
 
-    // Compressed data size
-    char *   data_ptr = nullptr;
-    uint32_t size     = 0;
-    if(z_stream.total_out >= lfh.uncompressed_size)
+    auto writer = openZipWriter(zipname, ZipWriter::Mode::CREATE);
+    for(auto const * file : filelist)
     {
-        lfh.compressed_size    = lfh.uncompressed_size;
-        lfh.compression_method = 0;
-
-        data_ptr = reinterpret_cast<char *>(const_cast<int8_t *>(file->getData()));
-        size     = lfh.uncompressed_size;
+        assert(file != nullptr);
+        writer->addFile(*file);
     }
-    else
-    {
-        lfh.compressed_size    = static_cast<uint32_t>(z_stream.total_out);
-        lfh.compression_method = Z_DEFLATED;
 
-        data_ptr = reinterpret_cast<char *>(data_buffer.data());
-        size     = lfh.compressed_size;
-    }
-
-    // Cleaning
-    deflateEnd(&z_stream);
-
-    lfh.filename_length = static_cast<uint16_t>(file->getName().size());
-
-    // Save the offset to the record to Local File Header
-    uint32_t const lfh_offset = static_cast<uint32_t>(ofs.tellp());
-
-    // Write a signature Local File Header
-    lfh.signature         = 0x04034b50;
-    lfh.modification_date = date;
-    lfh.modification_time = time;
-    // Write Local File Header
-    ofs.write(reinterpret_cast<char *>(&lfh), sizeof(lfh));
-    // Write filename
-    ofs.write(file->getName().c_str(), static_cast<std::streamsize>(file->getName().size()));
-    // Write data
-    ofs.write(data_ptr, static_cast<std::streamsize>(size));
-
-    uint32_t const first_offset_CDFH = static_cast<uint32_t>(ofs.tellp());
-
-    ofs.write(central_directory_data.get(), static_cast<std::streamsize>(eocd.size_of_central_directory));
-
-    CentralDirectoryFileHeader cdfh{};
-    memset(&cdfh, 0, sizeof(cdfh));
-
-    cdfh.compressed_size          = lfh.compressed_size;
-    cdfh.uncompressed_size        = lfh.uncompressed_size;
-    cdfh.compression_method       = lfh.compression_method;
-    cdfh.crc32                    = lfh.crc32;
-    cdfh.local_file_header_offset = lfh_offset;
-    cdfh.filename_length          = lfh.filename_length;
-    cdfh.signature                = 0x02014b50;
-    cdfh.modification_date        = date;
-    cdfh.modification_time        = time;
-
-    ofs.write(reinterpret_cast<char *>(&cdfh), sizeof(cdfh));
-
-    ofs.write(file->getName().c_str(), cdfh.filename_length);
+    return writer->finalize();
+}
 
-    uint32_t const last_offset_CDFH = static_cast<uint32_t>(ofs.tellp());
+bool FileSystem::addFileToZIP(BaseFile const * file, std::string const & zipname)
+{
+    assert(!zipname.empty());
+    assert(file != nullptr);
 
-    eocd.central_directory_offset        = first_offset_CDFH;
-    eocd.number_central_directory_record = static_cast<uint16_t>(eocd.number_central_directory_record + 1);
-    eocd.total_central_directory_record  = static_cast<uint16_t>(eocd.total_central_directory_record + 1);
-    eocd.size_of_central_directory       = last_offset_CDFH - first_offset_CDFH;
+    auto writer = openZipWriter(zipname, ZipWriter::Mode::APPEND);
+    if(!writer->addFile(*file))
+        return false;
 
-    // Write a signature
-    uint32_t const signature = 0x06054b50;
-    ofs.write(reinterpret_cast<char const *>(&signature), sizeof(signature));
+    return writer->finalize();
+}
 
-    // Write a EOCD
-    ofs.write(reinterpret_cast<char *>(&eocd), sizeof(eocd));
+std::unique_ptr<ZipWriter> FileSystem::openZipWriter(std::string const & zipname, ZipWriter::Mode mode) const
+{
+    assert(!zipname.empty());
 
-    ofs.close();
-    return true;
+    return std::make_unique<ZipWriter>(m_data_dir + '/' + zipname, mode, m_pool.get());
 }
 
 InFile FileSystem::loadRegularFile(FileData const & f) const
 {
-    std::ifstream ifs(m_data_dir + '/' + f.fname, std::ios::binary);
+    std::ifstream ifs(m_data_dir + '/' + *f.fname, std::ios::binary);
     if(!ifs.is_open())
     {
         std::stringstream ss;
-        ss << "FileSystem::LoadRegularFile File: " << f.fname << " - not found";
+        ss << "FileSystem::LoadRegularFile File: " << *f.fname << " - not found";
         std::cout << ss.str() << std::endl;
         throw std::runtime_error("Unable to load file");
     }
@@ -708,7 +660,7 @@ InFile FileSystem::loadRegularFile(FileData const & f) const
     if(!success)
     {
         std::stringstream ss;
-        ss << "FileSystem::LoadRegularFile File: " << f.fname << " - not found";
+        ss << "FileSystem::LoadRegularFile File: " << *f.fname << " - not found";
         std::cout << ss.str() << std::endl;
         throw std::runtime_error("Unable to load file");
     }
@@ -716,81 +668,119 @@ InFile FileSystem::loadRegularFile(FileData const & f) const
     ifs.close();
 
     std::chrono::system_clock::time_point ftime =
-        file_time_to_time_point(fs::last_write_time(m_data_dir + '/' + f.fname));
+        file_time_to_time_point(fs::last_write_time(m_data_dir + '/' + *f.fname));
 
-    return {f.fname, ftime, file_size, std::move(data)};
+    return {*f.fname, ftime, file_size, std::move(data)};
 }
 
-// http://blog2k.ru/archives/3392
-InFile FileSystem::loadZipFile(FileData const & zf) const
+bool FileSystem::getFileStamp(std::string const & fname, uint64_t & size, uint64_t & stamp) const
 {
-    std::unique_ptr<int8_t[]> data;
+    auto res = findFile(fname);
+    if(!res)
+        return false;
 
-    std::ifstream ifs(zf.fname, std::ifstream::binary);
-    if(!ifs.is_open())
+    if(res->archive >= 0)
     {
-        std::stringstream ss;
-        ss << "FileSystem::LoadZipFile File: " << zf.fname << " - not found";
-        std::cout << ss.str() << std::endl;
-        throw std::runtime_error("Unable to load file");
+        size  = res->uncompressed_size;
+        stamp = getModificationStamp(*res);
+        return true;
     }
 
-    ifs.seekg(zf.zip_data.lfh_offset, std::ifstream::beg);
-    LocalFileHeader lfh{};
-    ifs.read(reinterpret_cast<char *>(&lfh), sizeof(lfh));
+    std::error_code   ec;
+    std::string const path = m_data_dir + '/' + *res->fname;
+
+    size = fs::file_size(path, ec);
+    if(ec)
+        return false;
+
+    auto const time = fs::last_write_time(path, ec);
+    if(ec)
+        return false;
+
+    auto const since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+    stamp                  = static_cast<uint64_t>(since_epoch.count());
+    return true;
+}
 
-    if(0x04034b50 != lfh.signature)
+uint64_t FileSystem::getModificationStamp(FileData const & f) const
+{
+    if(f.archive >= 0)
     {
-        std::stringstream ss;
-        ss << "FileSystem::LoadZipFile File: " << zf.fname << " - doesn't have zip file signature";
-        std::cout << ss.str() << std::endl;
-        throw std::runtime_error("Unable to load file");
+        uint64_t const dos_time = (static_cast<uint64_t>(f.modification_date) << 16) | f.modification_time;
+        return (static_cast<uint64_t>(f.lfh_offset) << 32) | dos_time;
     }
 
-    ifs.seekg(lfh.filename_length, std::ifstream::cur);
-    ifs.seekg(lfh.extra_field_length, std::ifstream::cur);
+    std::error_code ec;
+    auto const      time = fs::last_write_time(m_data_dir + '/' + *f.fname, ec);
+    return ec ? 0 : static_cast<uint64_t>(time.time_since_epoch().count());
+}
+
+bool FileSystem::resolveDataOffset(FileData & zf) const
+{
+    if(zf.data_offset != 0)
+        return true;
+
+    // the archives are only added by the constructor
+    uint64_t data_offset = 0;
+    if(!m_archives[zf.archive]->getDataOffset(zf.lfh_offset, data_offset))
+        return false;
 
-    auto read_buffer = std::make_unique<int8_t[]>(lfh.compressed_size);
-    ifs.read(reinterpret_cast<char *>(read_buffer.get()), static_cast<std::streamsize>(lfh.compressed_size));
+    zf.data_offset = static_cast<size_t>(data_offset);
 
-    if(!zf.zip_data.compressed)
+    // the next lookups get the resolved offset, unless the entry was replaced meanwhile
+    std::shared_lock<std::shared_mutex> lock(m_index_mutex);
+    if(auto it = m_index.find(*zf.fname); it != m_index.end())
     {
-        data = std::move(read_buffer);
+        FileData const & entry = m_files[it->second];
+        if(entry.archive == zf.archive && entry.lfh_offset == zf.lfh_offset)
+        {
+            std::lock_guard<std::mutex> offset_lock(m_offset_mutex);
+            entry.data_offset = zf.data_offset;
+        }
     }
-    else
-    {
-        data = std::make_unique<int8_t[]>(lfh.uncompressed_size);
 
-        z_stream zs;
-        std::memset(&zs, 0, sizeof(zs));
-        inflateInit2(&zs, -MAX_WBITS);
+    return true;
+}
 
-        zs.avail_in  = lfh.compressed_size;
-        zs.next_in   = reinterpret_cast<unsigned char *>(read_buffer.get());
-        zs.avail_out = lfh.uncompressed_size;
-        zs.next_out  = reinterpret_cast<unsigned char *>(data.get());
+// http://blog2k.ru/archives/3392
+InFile FileSystem::loadZipFile(FileData zf) const
+{
+    if(!resolveDataOffset(zf))
+        throw std::runtime_error("Unable to load file");
 
-        auto res = inflate(&zs, Z_FINISH);
+    SharedBuffer data;
+    if(zf.method == ZipCodec::MethodStored && zf.uncompressed_size >= MapThreshold)
+    {
+        // large stored entries are a view of the mapped archive, nothing is copied
+        data = SharedBuffer(MappedFile::Map(m_archives[zf.archive]->getName(), zf.data_offset,
+                                            zf.uncompressed_size));
+    }
+
+    if(data.empty())
+    {
+        // compressed data is read in chunks and decoded straight into the file buffer
+        InputFileStream stream(*zf.fname, *m_archives[zf.archive], zf.data_offset, zf.compressed_size,
+                               zf.uncompressed_size, zf.method);
 
-        if(res != Z_STREAM_END)
+        size_t unc_size = stream.getSize();
+        auto   buffer   = std::make_unique<int8_t[]>(unc_size);
+        if(!stream.read(buffer.get(), unc_size))
             throw std::runtime_error("Inflate error while reading zip file");
 
-        inflateEnd(&zs);
+        data = SharedBuffer(std::move(buffer), unc_size);
     }
-    ifs.close();
 
     struct tm timeinfo;
     std::memset(&timeinfo, 0, sizeof(timeinfo));
-    timeinfo.tm_year = ((lfh.modification_date & 0xFE00) >> 9) + 80;
-    timeinfo.tm_mon  = ((lfh.modification_date & 0x01E0) >> 5) - 1;
-    timeinfo.tm_mday = lfh.modification_date & 0x001F;
+    timeinfo.tm_year = ((zf.modification_date & 0xFE00) >> 9) + 80;
+    timeinfo.tm_mon  = ((zf.modification_date & 0x01E0) >> 5) - 1;
+    timeinfo.tm_mday = zf.modification_date & 0x001F;
 
-    timeinfo.tm_hour = (lfh.modification_time & 0xF800) >> 11;
-    timeinfo.tm_min  = (lfh.modification_time & 0x07E0) >> 5;
-    timeinfo.tm_sec  = (lfh.modification_time & 0x001f) * 2;
+    timeinfo.tm_hour = (zf.modification_time & 0xF800) >> 11;
+    timeinfo.tm_min  = (zf.modification_time & 0x07E0) >> 5;
+    timeinfo.tm_sec  = (zf.modification_time & 0x001f) * 2;
 
-    auto   t        = tm_to_time_point(timeinfo);
-    size_t unc_size = zf.zip_data.compressed ? lfh.uncompressed_size : lfh.compressed_size;
+    auto t = tm_to_time_point(timeinfo);
 
-    return {zf.zip_data.fname, t, unc_size, std::move(data)};
+    return {*zf.fname, t, std::move(data)};
 }
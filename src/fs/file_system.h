@@ -2,8 +2,22 @@
 #define FILESYSTEM_H
 
 #include "file.h"
+#include "file_cache.h"
+#include "file_stream.h"
+#include "file_watcher.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "zip_archive.h"
+#include "zip_writer.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <list>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 class FileSystem
 {
@@ -13,40 +27,95 @@ public:
 
     bool                  isExist(std::string const & fname) const;
     std::optional<InFile> getFile(std::string const & fname) const;   // ex. file name: "fonts/times.ttf"
-    size_t                getNumFiles() const { return m_files.size(); }
+    // chunked reader, zip entries are inflated on demand with bounded memory
+    std::optional<InputFileStream> openStream(std::string const & fname) const;
+    // zero-copy read-only view for regular files and stored (not compressed) zip entries, nullptr otherwise
+    std::shared_ptr<MappedFile> mapFile(std::string const & fname) const;
+    size_t                getNumFiles() const;
+    // size and modification stamp without reading the file: nanoseconds of the file time of regular files,
+    // DOS time and header offset of zip entries. false if the file is missing
+    bool getFileStamp(std::string const & fname, uint64_t & size, uint64_t & stamp) const;
+
+    // Async loading: files are read and inflated on the worker pool. The workers look up a copy of the
+    // index entry under a shared lock, so the index may be changed (writeFile, pollChanges) meanwhile.
+    using LoadCallback = std::function<void(std::optional<InFile>)>;
+    std::future<std::optional<InFile>> getFileAsync(std::string const & fname) const;
+    // on_loaded is called from processCompleted(), on the main thread
+    void getFileAsync(std::string const & fname, LoadCallback on_loaded) const;
+
+    // runs any job (image decoding, parsing) on the worker pool of the file system
+    template<typename F>
+    auto runAsync(F && task) const
+    {
+        return m_pool->enqueue(std::forward<F>(task));
+    }
+    void   postToMainThread(std::function<void()> task) const;
+    size_t processCompleted() const;   // runs the completions queued by the workers, returns their count
+
+    // Optional cache of loaded files for getFile(), budget in bytes, 0 (default) disables it. Cached files
+    // share their data with the callers.
+    void             setCacheBudget(size_t bytes) { m_cache.setBudget(bytes); }
+    FileCache::Stats getCacheStats() const { return m_cache.getStats(); }
+    void             clearCache() { m_cache.clear(); }
+
+    // Hot reload: files of the data directory written since the last poll, new files are added to the
+    // index. Call on the main thread.
+    void                     watchChanges(bool enable);
+    bool                     isWatching() const { return m_watcher != nullptr; }
+    std::vector<std::string> pollChanges();
+
+    // all files under the directory, ex. "ui/def" -> "ui/def/background.tga", ...
+    std::vector<std::string> getFilesInDir(std::string const & dir) const;
 
     bool writeFile(BaseFile const & file, std::string path = {});   // Memory file
     bool createZIP(std::vector<BaseFile const *> filelist,
                    std::string const &           zipname);   // all zip files saves in root directory
     bool addFileToZIP(BaseFile const * file, std::string const & zipname);
+    // batched writing: add many entries, compressed on the worker pool, then finalize() once
+    std::unique_ptr<ZipWriter> openZipWriter(std::string const & zipname, ZipWriter::Mode mode) const;
 
     static std::string GetTempDir();
     static std::string GetCurrentDir();
     static std::string GetTempFileName();
+    static std::string NormalizePath(std::string path);   // '/' separators, no "./" and repeated '/'
 
 private:
+    static constexpr size_t MapThreshold = 64 * 1024;   // stored zip entries from this size are mapped
+
     struct FileData
     {
-        struct ZFileData
-        {
-            bool        compressed        = false;
-            size_t      compressed_size   = 0;
-            size_t      uncompressed_size = 0;
-            size_t      lfh_offset        = 0;
-            std::string fname;
-        };
-
-        bool        is_zip = false;
-        ZFileData   zip_data;
-        std::string fname;
+        std::string const * fname             = nullptr;   // interned normalized path, key of m_index
+        int32_t             archive           = -1;        // m_archives index, -1 for regular files
+        uint16_t            method            = 0;   // ZipCodec::Method...
+        size_t              compressed_size   = 0;
+        size_t              uncompressed_size = 0;
+        size_t              lfh_offset        = 0;
+        uint16_t            modification_time = 0;
+        uint16_t            modification_date = 0;
+        mutable size_t      data_offset       = 0;   // resolved from the local header on the first read
     };
 
-    void   addZippedDir(std::string const & fname);
-    InFile loadRegularFile(FileData const & f) const;
-    InFile loadZipFile(FileData const & zf) const;
+    void                    addZippedDir(std::string const & fname);
+    void                    addFileData(std::string fname, FileData fd);   // the first added path wins
+    std::optional<FileData> findFile(std::string const & fname) const;   // a copy, thread safe
+    InFile                  loadRegularFile(FileData const & f) const;
+    InFile                  loadZipFile(FileData zf) const;
+    bool                    resolveDataOffset(FileData & zf) const;   // thread safe, cached in the index
+    uint64_t                getModificationStamp(FileData const & f) const;   // key of the file cache
+
+    std::vector<FileData>                          m_files;
+    std::unordered_map<std::string, std::uint32_t> m_index;      // normalized path -> m_files position
+    std::vector<std::unique_ptr<ZipArchive>>       m_archives;   // opened zip files
+    mutable std::vector<std::uint32_t>             m_sorted;     // m_files positions ordered by path
+    std::string                                    m_data_dir;
+    std::unique_ptr<FileWatcher>                   m_watcher;
+    mutable FileCache                              m_cache;
 
-    std::list<FileData> m_files;
-    std::string         m_data_dir;
+    mutable std::shared_mutex                      m_index_mutex;    // guards m_files, m_index, m_sorted
+    mutable std::mutex                             m_offset_mutex;   // guards FileData::data_offset
+    mutable std::mutex                             m_completed_mutex;
+    mutable std::vector<std::function<void()>>     m_completed;   // completions for the main thread
+    std::unique_ptr<ThreadPool>                    m_pool;        // last member: workers are joined first
 };
 
 #endif   // FILESYSTEM_H
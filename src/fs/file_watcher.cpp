@@ -0,0 +1,184 @@
+#include "file_watcher.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#ifdef __linux__
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static bool IsWatchedFile(fs::path const & path)
+{
+    return !(path.has_extension() && path.extension() == fs::path(".zip"));
+}
+
+FileWatcher::FileWatcher(std::string root_dir) : m_root_dir(std::move(root_dir))
+{
+    std::error_code ec;
+
+#ifdef __linux__
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(m_fd >= 0)
+    {
+        addWatch({});
+        for(auto it = fs::recursive_directory_iterator(m_root_dir, ec);
+            !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if(it->is_directory(ec))
+                addWatch(fs::relative(it->path(), m_root_dir, ec).generic_string());
+        }
+        return;
+    }
+
+    std::stringstream ss;
+    ss << "FileWatcher: inotify is not available, polling " << m_root_dir;
+    std::cout << ss.str() << std::endl;
+#endif
+
+    // modification times for the polling
+    for(auto it = fs::recursive_directory_iterator(m_root_dir, ec);
+        !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if(it->is_regular_file(ec) && IsWatchedFile(it->path()))
+        {
+            std::string rel_path = fs::relative(it->path(), m_root_dir, ec).generic_string();
+            m_times[rel_path]    = fs::last_write_time(it->path(), ec);
+        }
+    }
+
+    m_last_scan = std::chrono::steady_clock::now();
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if(m_fd >= 0)
+        close(m_fd);
+#endif
+}
+
+bool FileWatcher::isNative() const
+{
+#ifdef __linux__
+    return m_fd >= 0;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+void FileWatcher::addWatch(std::string const & rel_dir)
+{
+    std::string const path = rel_dir.empty() ? m_root_dir : m_root_dir + '/' + rel_dir;
+
+    int const wd = inotify_add_watch(m_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if(wd >= 0)
+        m_dirs[wd] = rel_dir;
+}
+
+void FileWatcher::addDirectory(std::string const & rel_dir, std::vector<std::string> & changed)
+{
+    addWatch(rel_dir);
+
+    // files may have been written before the watch was added
+    std::error_code ec;
+    for(auto it = fs::recursive_directory_iterator(m_root_dir + '/' + rel_dir, ec);
+        !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::string rel_path = fs::relative(it->path(), m_root_dir, ec).generic_string();
+        if(it->is_directory(ec))
+            addWatch(rel_path);
+        else if(it->is_regular_file(ec) && IsWatchedFile(it->path()))
+            changed.push_back(std::move(rel_path));
+    }
+}
+#endif
+
+bool FileWatcher::isChanged(std::string const & rel_path)
+{
+    std::error_code ec;
+    auto const      time = fs::last_write_time(m_root_dir + '/' + rel_path, ec);
+    if(ec)
+        return false;   // removed again
+
+    auto it = m_times.find(rel_path);
+    if(it != m_times.end() && it->second == time)
+        return false;
+
+    m_times[rel_path] = time;
+    return true;
+}
+
+void FileWatcher::scan(std::vector<std::string> & changed)
+{
+    std::error_code ec;
+    for(auto it = fs::recursive_directory_iterator(m_root_dir, ec);
+        !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if(it->is_regular_file(ec) && IsWatchedFile(it->path()))
+        {
+            std::string rel_path = fs::relative(it->path(), m_root_dir, ec).generic_string();
+            if(isChanged(rel_path))
+                changed.push_back(std::move(rel_path));
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+    std::vector<std::string> changed;
+
+#ifdef __linux__
+    if(m_fd >= 0)
+    {
+        alignas(inotify_event) char buffer[4096];
+
+        for(;;)
+        {
+            ssize_t const length = read(m_fd, buffer, sizeof(buffer));
+            if(length <= 0)
+                break;   // EAGAIN: no more events
+
+            for(char const * ptr = buffer; ptr < buffer + length;)
+            {
+                auto const * event = reinterpret_cast<inotify_event const *>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto dir_it = m_dirs.find(event->wd);
+                if(dir_it == m_dirs.end() || event->len == 0)
+                    continue;
+
+                std::string const & dir      = dir_it->second;
+                std::string         rel_path = dir.empty() ? event->name : dir + '/' + event->name;
+
+                if(event->mask & IN_ISDIR)
+                {
+                    if(event->mask & (IN_CREATE | IN_MOVED_TO))
+                        addDirectory(rel_path, changed);
+                }
+                else if((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) && IsWatchedFile(rel_path))
+                {
+                    changed.push_back(std::move(rel_path));
+                }
+            }
+        }
+
+        // a file saved several times since the last poll is reported once
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+        return changed;
+    }
+#endif
+
+    auto const now = std::chrono::steady_clock::now();
+    if(now - m_last_scan >= ScanInterval)
+    {
+        m_last_scan = now;
+        scan(changed);
+    }
+
+    return changed;
+}
@@ -0,0 +1,46 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports regular files of a directory tree that were written since the last poll. On Linux the tree is
+// watched with inotify, elsewhere the modification times are rescanned at most every ScanInterval.
+// Zip archives are not reported, their entries are indexed once at startup.
+class FileWatcher
+{
+public:
+    static constexpr std::chrono::milliseconds ScanInterval{500};
+
+    FileWatcher(std::string root_dir);
+    ~FileWatcher();
+
+    FileWatcher(FileWatcher const &)             = delete;
+    FileWatcher & operator=(FileWatcher const &) = delete;
+
+    bool isNative() const;   // inotify is used
+
+    // paths relative to the root with '/' separators, each changed file once; never blocks
+    std::vector<std::string> poll();
+
+private:
+    // polling: the modification time differs from the last one seen
+    bool isChanged(std::string const & rel_path);
+    void scan(std::vector<std::string> & changed);
+
+    std::string                                                      m_root_dir;
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_times;   // last seen modification
+    std::chrono::steady_clock::time_point                            m_last_scan;
+#ifdef __linux__
+    void addWatch(std::string const & rel_dir);
+    void addDirectory(std::string const & rel_dir, std::vector<std::string> & changed);   // new directory
+
+    int                                  m_fd = -1;
+    std::unordered_map<int, std::string> m_dirs;   // watch descriptor -> relative directory
+#endif
+};
+
+#endif   // FILEWATCHER_H
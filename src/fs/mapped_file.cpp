@@ -0,0 +1,104 @@
+#include "mapped_file.h"
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    if(m_base == nullptr)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+#else
+    munmap(m_base, m_map_size);
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::Map(std::string const & path, size_t offset, size_t length)
+{
+    std::shared_ptr<MappedFile> view(new MappedFile);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size_t const total_size = static_cast<size_t>(file_size.QuadPart);
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t const granularity = info.dwAllocationGranularity;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if(file < 0)
+        return nullptr;
+
+    struct stat st;
+    fstat(file, &st);
+    size_t const total_size  = static_cast<size_t>(st.st_size);
+    size_t const granularity = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+
+    if(length == 0 && offset < total_size)
+        length = total_size - offset;
+
+    if(length == 0 || offset + length > total_size)
+    {
+        std::stringstream ss;
+        ss << "MappedFile::Map File: " << path << " - region is out of file bounds";
+        std::cout << ss.str() << std::endl;
+#ifdef _WIN32
+        CloseHandle(file);
+#else
+        close(file);
+#endif
+        return nullptr;
+    }
+
+    // the mapping offset must be aligned, the requested region starts inside the mapping
+    size_t const map_offset = offset - offset % granularity;
+    view->m_map_size        = length + (offset - map_offset);
+
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping != nullptr)
+    {
+        view->m_base = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(map_offset >> 32),
+                                     static_cast<DWORD>(map_offset & 0xFFFFFFFF), view->m_map_size);
+        CloseHandle(mapping);   // the view keeps the mapping alive
+    }
+    CloseHandle(file);
+#else
+    void * base =
+        mmap(nullptr, view->m_map_size, PROT_READ, MAP_PRIVATE, file, static_cast<off_t>(map_offset));
+    if(base != MAP_FAILED)
+        view->m_base = base;
+    close(file);   // the mapping keeps the file alive
+#endif
+
+    if(view->m_base == nullptr)
+    {
+        std::stringstream ss;
+        ss << "MappedFile::Map File: " << path << " - mapping failed";
+        std::cout << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    view->m_data = static_cast<int8_t const *>(view->m_base) + (offset - map_offset);
+    view->m_size = length;
+
+    return view;
+}
@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only memory-mapped view of a file region. Pages are loaded by the OS on first access, so
+// mapping a large file costs almost nothing until the data is actually read.
+class MappedFile
+{
+public:
+    ~MappedFile();
+
+    MappedFile(MappedFile const &)             = delete;
+    MappedFile & operator=(MappedFile const &) = delete;
+
+    // length == 0 maps the file from offset to the end, nullptr on error
+    static std::shared_ptr<MappedFile> Map(std::string const & path, size_t offset = 0, size_t length = 0);
+
+    int8_t const * getData() const { return m_data; }
+    size_t         getSize() const { return m_size; }
+
+private:
+    MappedFile() = default;
+
+    void *         m_base     = nullptr;   // start of the mapping, aligned to the allocation granularity
+    size_t         m_map_size = 0;
+    int8_t const * m_data     = nullptr;   // requested region inside the mapping
+    size_t         m_size     = 0;
+};
+
+#endif   // MAPPEDFILE_H
@@ -19,18 +19,33 @@ bool InputMemoryStream::read(void * out_data, size_t byte_count) const
     if(result_head > m_capacity)
     {
         if(static_cast<int>(m_capacity - m_head) > 0)
-            std::memcpy(out_data, mup_data.get() + m_head, m_capacity - m_head);
+            std::memcpy(out_data, m_buffer.data() + m_head, m_capacity - m_head);
         m_head = m_capacity;
         m_eof  = true;
         return false;
     }
 
-    std::memcpy(out_data, mup_data.get() + m_head, byte_count);
+    std::memcpy(out_data, m_buffer.data() + m_head, byte_count);
 
     m_head = result_head;
     return true;
 }
 
+SharedBuffer InputMemoryStream::readBuffer(size_t byte_count) const
+{
+    if(byte_count > m_capacity - m_head)
+    {
+        m_head = m_capacity;
+        m_eof  = true;
+        return {};
+    }
+
+    SharedBuffer result = m_buffer.slice(m_head, byte_count);
+
+    m_head += byte_count;
+    return result;
+}
+
 InputMemoryStream const & GetLine(InputMemoryStream const & input_stream, std::string & out_str)
 {
     char ch;
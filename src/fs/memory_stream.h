@@ -1,6 +1,7 @@
 #ifndef MEMORYSTREAM_H
 #define MEMORYSTREAM_H
 
+#include "shared_buffer.h"
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -31,7 +32,7 @@ public:
     OutputMemoryStream(OutputMemoryStream && other)
         : OutputMemoryStream()
     {
-        std::swap(*this, other);
+        swap(*this, other);
     }
 
     OutputMemoryStream & operator=(OutputMemoryStream && other)
@@ -40,7 +41,7 @@ public:
         if(&other == this)
             return *this;
 
-        std::swap(*this, other);
+        swap(*this, other);
 
         return *this;
     }
@@ -69,66 +70,52 @@ public:
     void write(InputMemoryStream const & stream);
 
     void clear() { m_buffer.clear(); }
+    // moves the written bytes into an immutable buffer without copying, the stream is left empty
+    SharedBuffer release() { return SharedBuffer(std::move(m_buffer)); }
 
 private:
     std::vector<int8_t> m_buffer;
 };
 
+// Reader over an immutable SharedBuffer: copies of the stream share the data and have their own head.
 class InputMemoryStream
 {
 public:
     InputMemoryStream(std::unique_ptr<int8_t[]> data, size_t byte_count)
-        : mup_data{std::move(data)},
+        : m_buffer{std::move(data), byte_count},
           m_head{0},
           m_capacity{byte_count}
     {}
-    explicit InputMemoryStream(size_t byte_count)
-        : mup_data{std::make_unique<int8_t[]>(byte_count)},
+    explicit InputMemoryStream(SharedBuffer buffer)
+        : m_buffer{std::move(buffer)},
           m_head{0},
+          m_capacity{m_buffer.size()}
+    {}
+    explicit InputMemoryStream(size_t byte_count)
+        : m_head{0},
           m_capacity{byte_count}
     {
-        std::memset(mup_data.get(), 0, byte_count);
+        auto data = std::make_unique<int8_t[]>(byte_count);
+        std::memset(data.get(), 0, byte_count);
+        m_buffer = SharedBuffer(std::move(data), byte_count);
     }
     InputMemoryStream()  = default;
     ~InputMemoryStream() = default;
 
-    InputMemoryStream(InputMemoryStream const & other)
-        : m_head{other.m_head},
-          m_capacity{other.m_capacity},
-          m_eof{other.m_eof}
-    {
-        mup_data = std::make_unique<int8_t[]>(m_capacity);
-        std::memcpy(mup_data.get(), other.mup_data.get(), m_capacity);
-    }
-
+    // the written bytes are copied, use OutputMemoryStream::release() to take them over
     explicit InputMemoryStream(OutputMemoryStream const & stream)
-        : m_head{0},
+        : m_buffer{SharedBuffer::Copy(stream.getBufferPtr(), stream.getLength())},
+          m_head{0},
           m_capacity{stream.getLength()}
-    {
-        std::unique_ptr<int8_t[]> new_buf = std::make_unique<int8_t[]>(m_capacity);
-        std::memcpy(new_buf.get(), stream.getBufferPtr(), stream.getLength());
-        std::swap(mup_data, new_buf);
-    }
-
-    InputMemoryStream & operator=(InputMemoryStream const & other)
-    {
-        // check for self-assignment
-        if(&other == this)
-            return *this;
+    {}
 
-        m_head     = other.m_head;
-        m_capacity = other.m_capacity;
-        m_eof      = other.m_eof;
-        mup_data   = std::make_unique<int8_t[]>(m_capacity);
-        std::memcpy(mup_data.get(), other.mup_data.get(), m_capacity);
-
-        return *this;
-    }
+    InputMemoryStream(InputMemoryStream const & other)             = default;
+    InputMemoryStream & operator=(InputMemoryStream const & other) = default;
 
     InputMemoryStream(InputMemoryStream && other)
         : InputMemoryStream()
     {
-        std::swap(*this, other);
+        swap(*this, other);
     }
 
     InputMemoryStream & operator=(InputMemoryStream && other)
@@ -137,7 +124,7 @@ public:
         if(&other == this)
             return *this;
 
-        std::swap(*this, other);
+        swap(*this, other);
 
         return *this;
     }
@@ -146,13 +133,15 @@ public:
     {
         using std::swap;
 
-        swap(left.mup_data, right.mup_data);
+        swap(left.m_buffer, right.m_buffer);
         swap(left.m_head, right.m_head);
         swap(left.m_capacity, right.m_capacity);
         swap(left.m_eof, right.m_eof);
     }
 
     bool read(void * out_data, size_t byte_count) const;
+    // zero-copy read: a view of the next byte_count bytes, empty if the stream is shorter
+    SharedBuffer readBuffer(size_t byte_count) const;
 
     template<typename T>
     bool read(T & out_data) const
@@ -161,11 +150,12 @@ public:
         return read(reinterpret_cast<void *>(&out_data), sizeof(out_data));
     }
 
-    size_t         getRemainingDataSize() const { return m_capacity - m_head; }
-    size_t         getCapacity() const { return m_capacity; }
-    int8_t const * getCurPosPtr() const { return mup_data.get() + m_head; }
-    int8_t const * getPtr() const { return mup_data.get(); }
-    explicit       operator bool() const { return !m_eof; }
+    size_t               getRemainingDataSize() const { return m_capacity - m_head; }
+    size_t               getCapacity() const { return m_capacity; }
+    int8_t const *       getCurPosPtr() const { return m_buffer.data() + m_head; }
+    int8_t const *       getPtr() const { return m_buffer.data(); }
+    SharedBuffer const & getBuffer() const { return m_buffer; }
+    explicit             operator bool() const { return !m_eof; }
 
     void resetHead()
     {
@@ -173,13 +163,17 @@ public:
         m_eof  = false;
     }
 
-    void setCapacity(uint32_t new_capacity) { m_capacity = new_capacity; }
+    void setCapacity(uint32_t new_capacity)
+    {
+        assert(new_capacity <= m_buffer.size());
+        m_capacity = new_capacity;
+    }
 
 private:
-    std::unique_ptr<int8_t[]> mup_data;
-    mutable size_t            m_head;
-    size_t                    m_capacity;
-    mutable bool              m_eof = false;
+    SharedBuffer   m_buffer;
+    mutable size_t m_head     = 0;
+    size_t         m_capacity = 0;
+    mutable bool   m_eof      = false;
 };
 
 InputMemoryStream const & GetLine(InputMemoryStream const & input_stream, std::string & out_str);
@@ -0,0 +1,68 @@
+#ifndef SHAREDBUFFER_H
+#define SHAREDBUFFER_H
+
+#include "mapped_file.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Immutable ref-counted bytes. Copies and slices share the storage, which is released with the last view,
+// so passing file data around costs O(1). The storage is a heap array, a vector or a mapped file region.
+class SharedBuffer
+{
+public:
+    SharedBuffer() = default;
+    SharedBuffer(std::unique_ptr<int8_t[]> data, size_t size) : m_data(data.get()), m_size(size)
+    {
+        m_owner = std::shared_ptr<int8_t[]>(std::move(data));
+    }
+    explicit SharedBuffer(std::vector<int8_t> data)
+    {
+        auto owner = std::make_shared<std::vector<int8_t>>(std::move(data));
+        m_data     = owner->data();
+        m_size     = owner->size();
+        m_owner    = std::move(owner);
+    }
+    explicit SharedBuffer(std::shared_ptr<MappedFile> view)
+    {
+        if(view)
+        {
+            m_data  = view->getData();
+            m_size  = view->getSize();
+            m_owner = std::move(view);
+        }
+    }
+
+    static SharedBuffer Copy(void const * data, size_t size)
+    {
+        auto buffer = std::make_unique<int8_t[]>(size);
+        if(size != 0)
+            std::memcpy(buffer.get(), data, size);
+        return {std::move(buffer), size};
+    }
+
+    int8_t const * data() const { return m_data; }
+    size_t         size() const { return m_size; }
+    bool           empty() const { return m_size == 0; }
+    long           useCount() const { return m_owner.use_count(); }
+
+    SharedBuffer slice(size_t offset, size_t size) const   // view of a part, shares the storage
+    {
+        assert(offset + size <= m_size);
+
+        SharedBuffer result;
+        result.m_owner = m_owner;
+        result.m_data  = m_data + offset;
+        result.m_size  = size;
+        return result;
+    }
+
+private:
+    std::shared_ptr<void const> m_owner;   // keeps the storage alive
+    int8_t const *              m_data = nullptr;
+    size_t                      m_size = 0;
+};
+
+#endif   // SHAREDBUFFER_H
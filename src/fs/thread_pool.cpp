@@ -0,0 +1,50 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t num_threads)
+{
+    num_threads = std::max<std::size_t>(1, num_threads);
+
+    m_workers.reserve(num_threads);
+    for(std::size_t i = 0; i < num_threads; ++i)
+        m_workers.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+
+    for(auto & worker : m_workers)
+        worker.join();
+}
+
+std::size_t ThreadPool::DefaultThreadCount()
+{
+    unsigned int const hw_threads = std::thread::hardware_concurrency();
+
+    return hw_threads > 1 ? hw_threads - 1 : 1;
+}
+
+void ThreadPool::worker()
+{
+    for(;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+
+            if(m_stop && m_queue.empty())
+                return;
+
+            task = std::move(m_queue.front());
+            m_queue.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed size pool of worker threads, tasks are executed in FIFO order.
+class ThreadPool
+{
+public:
+    ThreadPool(std::size_t num_threads = DefaultThreadCount());
+    ~ThreadPool();   // finishes the queued tasks and joins the workers
+
+    ThreadPool(ThreadPool const &)             = delete;
+    ThreadPool & operator=(ThreadPool const &) = delete;
+
+    template<typename F>
+    auto enqueue(F && task) -> std::future<std::invoke_result_t<std::decay_t<F>>>;
+
+    std::size_t getNumThreads() const { return m_workers.size(); }
+
+    static std::size_t DefaultThreadCount();   // one thread is left for the main loop
+
+private:
+    void worker();
+
+    std::vector<std::thread>          m_workers;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_cv;
+    std::queue<std::function<void()>> m_queue;
+    bool                              m_stop = false;
+};
+
+template<typename F>
+auto ThreadPool::enqueue(F && task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+{
+    using result_type = std::invoke_result_t<std::decay_t<F>>;
+
+    // std::function requires a copyable target
+    auto packaged = std::make_shared<std::packaged_task<result_type()>>(std::forward<F>(task));
+    auto future   = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.emplace([packaged]() { (*packaged)(); });
+    }
+    m_cv.notify_one();
+
+    return future;
+}
+
+#endif   // THREAD_POOL_H
@@ -57,6 +57,29 @@ struct LocalFileHeader
                                          // extra field (variable size)
 };
 
+struct Zip64EOCDLocator   // Zip64 end of central directory locator, precedes the EOCD record
+{
+    uint32_t signature;                // 0x07064b50
+    uint32_t zip64_eocd_disk_number;   // number of the disk with the start of the zip64 EOCD record
+    uint64_t zip64_eocd_offset;        // relative offset of the zip64 EOCD record
+    uint32_t total_disks;              // total number of disks
+};
+
+struct Zip64EOCD   // Zip64 end of central directory record
+{
+    uint32_t signature;                         // 0x06064b50
+    uint64_t size_of_record;                    // size of zip64 end of central directory record
+    uint16_t version_made_by;                   // version made by
+    uint16_t version_to_extract;                // version needed to extract
+    uint32_t disk_number;                       // number of this disk
+    uint32_t start_disk_number;                 // number of the disk with the start of the central directory
+    uint64_t number_central_directory_record;   // entries in the central directory on this disk
+    uint64_t total_central_directory_record;    // total number of entries in the central directory
+    uint64_t size_of_central_directory;         // size of the central directory
+    uint64_t central_directory_offset;          // offset of start of central directory
+                                                // zip64 extensible data sector (variable size)
+};
+
 #pragma pack(pop)
 
 #endif   // ZIP_H_INCLUDED
@@ -0,0 +1,112 @@
+#include "zip_archive.h"
+#include "zip.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+ZipArchive::ZipArchive(std::string path) : m_name(std::move(path))
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(m_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(handle, &file_size);
+
+        m_handle = handle;
+        m_size   = static_cast<uint64_t>(file_size.QuadPart);
+    }
+#else
+    m_fd = open(m_name.c_str(), O_RDONLY);
+    if(m_fd >= 0)
+    {
+        struct stat st;
+        fstat(m_fd, &st);
+        m_size = static_cast<uint64_t>(st.st_size);
+    }
+#endif
+
+    if(!isOpen())
+    {
+        std::stringstream ss;
+        ss << "ZipArchive::ZipArchive File: " << m_name << " - not found";
+        std::cout << ss.str() << std::endl;
+    }
+}
+
+ZipArchive::~ZipArchive()
+{
+#ifdef _WIN32
+    if(m_handle)
+        CloseHandle(m_handle);
+#else
+    if(m_fd >= 0)
+        close(m_fd);
+#endif
+}
+
+bool ZipArchive::isOpen() const
+{
+#ifdef _WIN32
+    return m_handle != nullptr;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+bool ZipArchive::read(void * buffer, size_t length, uint64_t offset) const
+{
+    if(!isOpen() || offset + length > m_size)
+        return false;
+
+    auto * dst = static_cast<char *>(buffer);
+
+    while(length > 0)
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset     = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD       bytes_read = 0;
+        DWORD const chunk      = static_cast<DWORD>(std::min<size_t>(length, 0x40000000));
+        if(!ReadFile(m_handle, dst, chunk, &bytes_read, &overlapped) || bytes_read == 0)
+            return false;
+#else
+        ssize_t const bytes_read = pread(m_fd, dst, length, static_cast<off_t>(offset));
+        if(bytes_read <= 0)
+            return false;
+#endif
+
+        dst += bytes_read;
+        offset += static_cast<uint64_t>(bytes_read);
+        length -= static_cast<size_t>(bytes_read);
+    }
+
+    return true;
+}
+
+bool ZipArchive::getDataOffset(uint64_t lfh_offset, uint64_t & data_offset) const
+{
+    LocalFileHeader lfh{};
+    if(!read(&lfh, sizeof(lfh), lfh_offset) || 0x04034b50 != lfh.signature)
+    {
+        std::stringstream ss;
+        ss << "ZipArchive::getDataOffset File: " << m_name << " - doesn't have zip file signature";
+        std::cout << ss.str() << std::endl;
+        return false;
+    }
+
+    data_offset = lfh_offset + sizeof(lfh) + lfh.filename_length + lfh.extra_field_length;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef ZIPARCHIVE_H
+#define ZIPARCHIVE_H
+
+#include <cstdint>
+#include <string>
+
+// Zip archive kept open for the lifetime of the file system. Reads are positional (pread /
+// ReadFile with OVERLAPPED offset), so they do not share a file position and need no reopen or seek.
+class ZipArchive
+{
+public:
+    ZipArchive(std::string path);
+    ~ZipArchive();
+
+    ZipArchive(ZipArchive const &)             = delete;
+    ZipArchive & operator=(ZipArchive const &) = delete;
+
+    bool                isOpen() const;
+    std::string const & getName() const { return m_name; }
+    uint64_t            getSize() const { return m_size; }
+
+    bool read(void * buffer, size_t length, uint64_t offset) const;   // false if fewer bytes are read
+
+    // offset of the entry data, behind the local file header and its variable length fields
+    bool getDataOffset(uint64_t lfh_offset, uint64_t & data_offset) const;
+
+private:
+    std::string m_name;
+    uint64_t    m_size = 0;
+#ifdef _WIN32
+    void * m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+#endif   // ZIPARCHIVE_H
@@ -0,0 +1,194 @@
+#include "zip_codec.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <zlib.h>
+
+#ifdef USE_ZSTD
+#    include <zstd.h>
+#endif
+
+namespace ZipCodec
+{
+class DeflateDecoder : public Decoder
+{
+public:
+    DeflateDecoder()
+    {
+        std::memset(&m_zs, 0, sizeof(m_zs));
+        m_init = inflateInit2(&m_zs, -MAX_WBITS) == Z_OK;
+    }
+    ~DeflateDecoder() override
+    {
+        if(m_init)
+            inflateEnd(&m_zs);
+    }
+
+    bool decode(unsigned char const *& in, size_t & in_size, unsigned char *& out, size_t & out_size,
+                bool & finished) override
+    {
+        if(!m_init)
+            return false;
+
+        m_zs.next_in   = const_cast<unsigned char *>(in);
+        m_zs.avail_in  = static_cast<uInt>(in_size);
+        m_zs.next_out  = out;
+        m_zs.avail_out = static_cast<uInt>(out_size);
+
+        auto res = inflate(&m_zs, Z_NO_FLUSH);
+
+        in       = m_zs.next_in;
+        in_size  = m_zs.avail_in;
+        out      = m_zs.next_out;
+        out_size = m_zs.avail_out;
+        finished = res == Z_STREAM_END;
+
+        return res == Z_OK || res == Z_STREAM_END || res == Z_BUF_ERROR;
+    }
+
+    void reset() override { inflateReset(&m_zs); }
+
+private:
+    z_stream m_zs;
+    bool     m_init = false;
+};
+
+#ifdef USE_ZSTD
+class ZstdDecoder : public Decoder
+{
+public:
+    ZstdDecoder() : m_ctx(ZSTD_createDCtx()) {}
+    ~ZstdDecoder() override { ZSTD_freeDCtx(m_ctx); }
+
+    bool decode(unsigned char const *& in, size_t & in_size, unsigned char *& out, size_t & out_size,
+                bool & finished) override
+    {
+        if(m_ctx == nullptr)
+            return false;
+
+        ZSTD_inBuffer  input  = {in, in_size, 0};
+        ZSTD_outBuffer output = {out, out_size, 0};
+
+        size_t const res = ZSTD_decompressStream(m_ctx, &output, &input);
+        if(ZSTD_isError(res))
+            return false;
+
+        in += input.pos;
+        in_size -= input.pos;
+        out += output.pos;
+        out_size -= output.pos;
+        finished = res == 0;   // frame completely decoded and flushed
+
+        return true;
+    }
+
+    void reset() override { ZSTD_DCtx_reset(m_ctx, ZSTD_reset_session_only); }
+
+private:
+    ZSTD_DCtx * m_ctx;
+};
+#endif
+
+bool IsSupported(uint16_t method)
+{
+#ifdef USE_ZSTD
+    if(method == MethodZstd)
+        return true;
+#endif
+    return method == MethodStored || method == MethodDeflate;
+}
+
+uint16_t VersionToExtract(uint16_t method)
+{
+    switch(method)
+    {
+        case MethodDeflate:
+            return 20;
+        case MethodZstd:
+            return 63;
+        default:
+            return 10;
+    }
+}
+
+std::unique_ptr<Decoder> CreateDecoder(uint16_t method)
+{
+    switch(method)
+    {
+        case MethodDeflate:
+            return std::make_unique<DeflateDecoder>();
+#ifdef USE_ZSTD
+        case MethodZstd:
+            return std::make_unique<ZstdDecoder>();
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+uint16_t ChooseMethod(std::string const & fname, size_t size)
+{
+    // formats with their own compression do not shrink any further
+    static std::array<char const *, 9> const packed_ext = {".png", ".jpg", ".jpeg", ".zip", ".gz",
+                                                           ".zst", ".ogg", ".mp3",  ".ktx2"};
+
+    if(size < MinCompressSize)
+        return MethodStored;
+
+    std::string ext;
+    if(auto pos = fname.find_last_of('.'); pos != std::string::npos)
+        ext = fname.substr(pos);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+    if(std::find(packed_ext.begin(), packed_ext.end(), ext) != packed_ext.end())
+        return MethodStored;
+
+#ifdef USE_ZSTD
+    return MethodZstd;   // several times faster to decode than deflate at a similar ratio
+#else
+    return MethodDeflate;
+#endif
+}
+
+bool Compress(uint16_t method, void const * data, size_t size, std::vector<uint8_t> & out)
+{
+    if(method == MethodDeflate)
+    {
+        out.resize(size);
+
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return false;
+
+        zs.avail_in  = static_cast<uInt>(size);
+        zs.next_in   = static_cast<unsigned char *>(const_cast<void *>(data));
+        zs.avail_out = static_cast<uInt>(out.size());
+        zs.next_out  = out.data();
+
+        // the output buffer is the size of the input, Z_STREAM_END means the data has shrunk
+        auto res = deflate(&zs, Z_FINISH);
+        out.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        return res == Z_STREAM_END && out.size() < size;
+    }
+#ifdef USE_ZSTD
+    if(method == MethodZstd)
+    {
+        out.resize(ZSTD_compressBound(size));
+
+        size_t const res = ZSTD_compress(out.data(), out.size(), data, size, 19);
+        if(ZSTD_isError(res) || res >= size)
+            return false;
+
+        out.resize(res);
+        return true;
+    }
+#endif
+
+    return false;
+}
+}   // namespace ZipCodec
@@ -0,0 +1,43 @@
+#ifndef ZIPCODEC_H
+#define ZIPCODEC_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Compression methods of the zip entries. Deflate is always available, zstd (method 93 of the zip
+// APPNOTE) is compiled in with USE_ZSTD (qmake CONFIG+=zstd).
+namespace ZipCodec
+{
+constexpr uint16_t MethodStored  = 0;
+constexpr uint16_t MethodDeflate = 8;
+constexpr uint16_t MethodZstd    = 93;
+
+constexpr size_t MinCompressSize = 256;   // smaller entries are stored
+
+bool     IsSupported(uint16_t method);
+uint16_t VersionToExtract(uint16_t method);
+
+// Streaming decompressor of one entry
+class Decoder
+{
+public:
+    virtual ~Decoder() = default;
+
+    // consumes input and produces output, the pointers and sizes are advanced; false on a data error
+    virtual bool decode(unsigned char const *& in, size_t & in_size, unsigned char *& out, size_t & out_size,
+                        bool & finished) = 0;
+    virtual void reset()                 = 0;   // start of a new entry
+};
+
+std::unique_ptr<Decoder> CreateDecoder(uint16_t method);   // nullptr for stored and unsupported methods
+
+// method of a new entry by its size and type: small and already compressed files are stored,
+// the rest uses the fastest to decode codec compiled in
+uint16_t ChooseMethod(std::string const & fname, size_t size);
+// false if the codec failed or did not make the data smaller, the entry is stored then
+bool Compress(uint16_t method, void const * data, size_t size, std::vector<uint8_t> & out);
+}   // namespace ZipCodec
+
+#endif   // ZIPCODEC_H
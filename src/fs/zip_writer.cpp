@@ -0,0 +1,325 @@
+#include "zip_writer.h"
+#include "file.h"
+#include "thread_pool.h"
+#include "zip.h"
+#include "zip_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <zlib.h>
+
+static void GetDosTime(std::time_t rawtime, uint16_t & time, uint16_t & date)
+{
+    // http://stackoverflow.com/questions/15763259/unix-timestamp-to-fat-timestamp
+    struct tm * timeinfo;
+    timeinfo = localtime(&rawtime);
+
+    time =
+        static_cast<uint16_t>((timeinfo->tm_hour << 11) | (timeinfo->tm_min << 5) | (timeinfo->tm_sec >> 1));
+    date = static_cast<uint16_t>(((timeinfo->tm_year - 80) << 9) | ((timeinfo->tm_mon + 1) << 5)
+                                 | (timeinfo->tm_mday));
+}
+
+ZipWriter::ZipWriter(std::string path, Mode mode, ThreadPool * pool) : m_path(std::move(path)), m_pool(pool)
+{
+    if(mode == Mode::CREATE)
+        m_ofs.open(m_path, std::fstream::binary | std::fstream::out | std::fstream::trunc);
+    else
+        m_ofs.open(m_path, std::fstream::binary | std::fstream::in | std::fstream::out);
+
+    if(!m_ofs.is_open())
+    {
+        std::stringstream ss;
+        ss << "ZipWriter File: " << m_path << " - not opened";
+        std::cout << ss.str() << std::endl;
+        return;
+    }
+
+    if(mode == Mode::APPEND)
+    {
+        m_append = true;
+        if(!readCentralDirectory())
+        {
+            m_failed = true;
+            return;
+        }
+
+        // new entries overwrite the old central directory
+        m_ofs.seekp(static_cast<std::streamoff>(m_write_offset), std::fstream::beg);
+    }
+}
+
+ZipWriter::~ZipWriter()
+{
+    if(!m_finalized)
+        finalize();
+}
+
+bool ZipWriter::readCentralDirectory()
+{
+    m_ofs.seekg(0, std::fstream::end);
+    uint64_t const file_size = static_cast<uint64_t>(m_ofs.tellg());
+
+    if(file_size < sizeof(uint32_t) + sizeof(EOCD))
+        return false;
+
+    // EOCD is in the tail: the record itself and a comment of at most 64 KB
+    size_t const      tail_size   = static_cast<size_t>(std::min<uint64_t>(file_size, 0xFFFF + 22));
+    std::vector<char> tail(tail_size);
+
+    m_ofs.seekg(static_cast<std::streamoff>(file_size - tail_size), std::fstream::beg);
+    if(!m_ofs.read(tail.data(), static_cast<std::streamsize>(tail_size)))
+        return false;
+
+    EOCD eocd{};
+    bool found = false;
+    for(size_t pos = tail_size - sizeof(uint32_t) - sizeof(EOCD) + 1; pos-- > 0;)
+    {
+        uint32_t signature = 0;
+        std::memcpy(&signature, tail.data() + pos, sizeof(signature));
+
+        if(0x06054b50 == signature)
+        {
+            std::memcpy(&eocd, tail.data() + pos + sizeof(uint32_t), sizeof(eocd));
+            found = true;
+            break;
+        }
+    }
+
+    if(!found || eocd.number_central_directory_record == 0xFFFF
+       || eocd.central_directory_offset == 0xFFFFFFFF
+       || uint64_t{eocd.central_directory_offset} + eocd.size_of_central_directory > file_size)
+    {
+        std::stringstream ss;
+        ss << "ZipWriter File: " << m_path << " - not found EOCD or zip64 archive";
+        std::cout << ss.str() << std::endl;
+        return false;
+    }
+
+    // whole central directory with one read
+    m_central_directory.resize(eocd.size_of_central_directory);
+    m_ofs.seekg(eocd.central_directory_offset, std::fstream::beg);
+    if(!m_ofs.read(m_central_directory.data(), static_cast<std::streamsize>(m_central_directory.size())))
+        return false;
+
+    size_t pos = 0;
+    for(uint16_t i = 0; i < eocd.number_central_directory_record; ++i)
+    {
+        CentralDirectoryFileHeader cdfh{};
+        if(pos + sizeof(cdfh) > m_central_directory.size())
+            return false;
+
+        std::memcpy(&cdfh, m_central_directory.data() + pos, sizeof(cdfh));
+        if(0x02014b50 != cdfh.signature
+           || pos + sizeof(cdfh) + cdfh.filename_length > m_central_directory.size())
+            return false;
+
+        m_names.emplace(m_central_directory.data() + pos + sizeof(cdfh), cdfh.filename_length);
+
+        pos += sizeof(cdfh) + cdfh.filename_length + cdfh.extra_field_length + cdfh.file_comment_length;
+    }
+
+    m_num_entries  = eocd.number_central_directory_record;
+    m_write_offset = eocd.central_directory_offset;
+
+    return true;
+}
+
+bool ZipWriter::addFile(BaseFile const & file)
+{
+    uint16_t time = 0;
+    uint16_t date = 0;
+    GetDosTime(std::chrono::system_clock::to_time_t(file.timeStamp()), time, date);
+
+    std::vector<int8_t> data(file.getData(), file.getData() + file.getFileSize());
+
+    return addFile(file.getName(), std::move(data), time, date);
+}
+
+bool ZipWriter::addFile(std::string name, std::vector<int8_t> data, uint16_t dos_time, uint16_t dos_date)
+{
+    if(!isOpen() || m_finalized)
+        return false;
+
+    if(!m_names.insert(name).second)
+        return false;   // If there is a file with this name
+
+    Entry entry;
+    entry.name              = std::move(name);
+    entry.modification_time = dos_time;
+    entry.modification_date = dos_date;
+    entry.data              = std::move(data);
+
+    ++m_num_added;
+
+    if(m_pool == nullptr)
+    {
+        writeEntry(Compress(std::move(entry)));
+        return true;
+    }
+
+    m_pending.push_back(
+        m_pool->enqueue([entry = std::move(entry)]() mutable { return Compress(std::move(entry)); }));
+
+    // entries are written in the order they were added
+    size_t const max_pending = MaxPendingPerThread * m_pool->getNumThreads();
+    while(m_pending.size() > max_pending)
+    {
+        writeEntry(m_pending.front().get());
+        m_pending.pop_front();
+    }
+
+    return true;
+}
+
+ZipWriter::Entry ZipWriter::Compress(Entry entry)
+{
+    entry.uncompressed_size = entry.data.size();
+    entry.crc32             = static_cast<uint32_t>(crc32(
+        0, reinterpret_cast<unsigned char const *>(entry.data.data()), static_cast<uInt>(entry.data.size())));
+
+    // the codec is chosen by the size and the type of the file
+    entry.method = ZipCodec::ChooseMethod(entry.name, entry.data.size());
+    if(entry.method != ZipCodec::MethodStored
+       && ZipCodec::Compress(entry.method, entry.data.data(), entry.data.size(), entry.compressed))
+    {
+        std::vector<int8_t>().swap(entry.data);
+    }
+    else
+    {
+        entry.method = ZipCodec::MethodStored;
+        std::vector<uint8_t>().swap(entry.compressed);
+    }
+
+    return entry;
+}
+
+void ZipWriter::writeEntry(Entry const & entry)
+{
+    if(m_failed)
+        return;
+
+    bool const   stored    = entry.method == ZipCodec::MethodStored;
+    size_t const data_size = stored ? entry.data.size() : entry.compressed.size();
+
+    if(m_write_offset > 0xFFFFFFFF || entry.uncompressed_size > 0xFFFFFFFF || entry.name.size() > 0xFFFF)
+    {
+        std::stringstream ss;
+        ss << "ZipWriter File: " << m_path << " - " << entry.name << " needs zip64, not supported";
+        std::cout << ss.str() << std::endl;
+        m_failed = true;
+        return;
+    }
+
+    LocalFileHeader lfh{};
+    std::memset(&lfh, 0, sizeof(lfh));
+
+    lfh.signature          = 0x04034b50;
+    lfh.version_to_extract = ZipCodec::VersionToExtract(entry.method);
+    lfh.compression_method = entry.method;
+    lfh.modification_time  = entry.modification_time;
+    lfh.modification_date  = entry.modification_date;
+    lfh.crc32              = entry.crc32;
+    lfh.compressed_size    = static_cast<uint32_t>(data_size);
+    lfh.uncompressed_size  = static_cast<uint32_t>(entry.uncompressed_size);
+    lfh.filename_length    = static_cast<uint16_t>(entry.name.size());
+
+    // Write Local File Header, filename and data
+    m_ofs.write(reinterpret_cast<char const *>(&lfh), sizeof(lfh));
+    m_ofs.write(entry.name.c_str(), static_cast<std::streamsize>(entry.name.size()));
+    char const * data_ptr = stored ? reinterpret_cast<char const *>(entry.data.data())
+                                   : reinterpret_cast<char const *>(entry.compressed.data());
+    m_ofs.write(data_ptr, static_cast<std::streamsize>(data_size));
+
+    if(!m_ofs)
+    {
+        m_failed = true;
+        return;
+    }
+
+    CentralDirectoryFileHeader cdfh{};
+    std::memset(&cdfh, 0, sizeof(cdfh));
+
+    cdfh.signature                = 0x02014b50;
+    cdfh.version_to_extract       = lfh.version_to_extract;
+    cdfh.compression_method       = lfh.compression_method;
+    cdfh.modification_time        = lfh.modification_time;
+    cdfh.modification_date        = lfh.modification_date;
+    cdfh.crc32                    = lfh.crc32;
+    cdfh.compressed_size          = lfh.compressed_size;
+    cdfh.uncompressed_size        = lfh.uncompressed_size;
+    cdfh.filename_length          = lfh.filename_length;
+    cdfh.local_file_header_offset = static_cast<uint32_t>(m_write_offset);
+
+    char const * cdfh_ptr = reinterpret_cast<char const *>(&cdfh);
+    m_central_directory.insert(m_central_directory.end(), cdfh_ptr, cdfh_ptr + sizeof(cdfh));
+    m_central_directory.insert(m_central_directory.end(), entry.name.begin(), entry.name.end());
+
+    m_write_offset += sizeof(lfh) + entry.name.size() + data_size;
+    ++m_num_entries;
+}
+
+bool ZipWriter::finalize()
+{
+    if(m_finalized)
+        return !m_failed;
+
+    m_finalized = true;
+
+    // the archive is unchanged, rewriting its central directory would drop the comment and trailing data
+    if(m_append && m_num_added == 0)
+        return !m_failed;
+
+    while(!m_pending.empty())
+    {
+        writeEntry(m_pending.front().get());
+        m_pending.pop_front();
+    }
+
+    if(!m_ofs.is_open())
+        return false;
+
+    if(m_num_entries > 0xFFFF || m_write_offset > 0xFFFFFFFF || m_central_directory.size() > 0xFFFFFFFF)
+    {
+        std::stringstream ss;
+        ss << "ZipWriter File: " << m_path << " - needs zip64, not supported";
+        std::cout << ss.str() << std::endl;
+        m_failed = true;
+    }
+
+    if(m_failed)
+    {
+        m_ofs.close();
+        return false;
+    }
+
+    // Central directory of all entries with one write
+    m_ofs.write(m_central_directory.data(), static_cast<std::streamsize>(m_central_directory.size()));
+
+    EOCD eocd{};
+    std::memset(&eocd, 0, sizeof(eocd));
+    eocd.central_directory_offset        = static_cast<uint32_t>(m_write_offset);
+    eocd.number_central_directory_record = static_cast<uint16_t>(m_num_entries);
+    eocd.total_central_directory_record  = static_cast<uint16_t>(m_num_entries);
+    eocd.size_of_central_directory       = static_cast<uint32_t>(m_central_directory.size());
+
+    uint32_t const signature = 0x06054b50;
+    m_ofs.write(reinterpret_cast<char const *>(&signature), sizeof(signature));
+    m_ofs.write(reinterpret_cast<char const *>(&eocd), sizeof(eocd));
+
+    uint64_t const end_offset =
+        m_write_offset + m_central_directory.size() + sizeof(signature) + sizeof(eocd);
+
+    m_failed = !m_ofs;
+    m_ofs.close();
+
+    // an appended archive may be shorter than the old one (EOCD comment)
+    std::error_code ec;
+    if(!m_failed && std::filesystem::file_size(m_path, ec) > end_offset)
+        std::filesystem::resize_file(m_path, end_offset, ec);
+
+    return !m_failed;
+}
@@ -0,0 +1,76 @@
+#ifndef ZIPWRITER_H
+#define ZIPWRITER_H
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class BaseFile;
+class ThreadPool;
+
+// Batched zip writer session. Entries are compressed on the worker pool and appended to the archive in
+// the order they were added, the central directory is written once by finalize(). In append mode the
+// new entries overwrite the old central directory, which is kept in memory and written back in front
+// of the new records, so the data of the existing entries is never touched.
+class ZipWriter
+{
+public:
+    enum class Mode
+    {
+        CREATE,   // truncates the file
+        APPEND
+    };
+
+    ZipWriter(std::string path, Mode mode, ThreadPool * pool = nullptr);   // no pool: compress inline
+    ~ZipWriter();   // finalizes the archive, an appended archive only if entries were added
+
+    ZipWriter(ZipWriter const &)             = delete;
+    ZipWriter & operator=(ZipWriter const &) = delete;
+
+    bool isOpen() const { return m_ofs.is_open() && !m_failed; }
+
+    // false for a duplicate name or a closed writer, the file data is copied
+    bool addFile(BaseFile const & file);
+    bool addFile(std::string name, std::vector<int8_t> data, uint16_t dos_time, uint16_t dos_date);
+
+    bool   finalize();   // writes the pending entries and the central directory, false on any error
+    size_t getNumEntries() const { return m_num_entries; }
+
+private:
+    struct Entry
+    {
+        std::string          name;
+        uint16_t             method            = 0;
+        uint16_t             modification_time = 0;
+        uint16_t             modification_date = 0;
+        uint32_t             crc32             = 0;
+        uint64_t             uncompressed_size = 0;
+        std::vector<int8_t>  data;         // uncompressed data, released after compression
+        std::vector<uint8_t> compressed;   // empty for stored entries
+    };
+
+    static Entry Compress(Entry entry);   // runs on a worker
+    bool         readCentralDirectory();   // append mode
+    void         writeEntry(Entry const & entry);
+
+    static constexpr size_t MaxPendingPerThread = 2;   // bounds the memory of queued entries
+
+    std::string                     m_path;
+    std::fstream                    m_ofs;
+    ThreadPool *                    m_pool = nullptr;
+    std::deque<std::future<Entry>>  m_pending;
+    std::unordered_set<std::string> m_names;
+    std::vector<char>               m_central_directory;   // records of the existing and written entries
+    uint64_t                        m_write_offset = 0;    // start of the central directory
+    size_t                          m_num_entries  = 0;
+    size_t                          m_num_added    = 0;
+    bool                            m_append       = false;
+    bool                            m_failed       = false;
+    bool                            m_finalized    = false;
+};
+
+#endif   // ZIPWRITER_H
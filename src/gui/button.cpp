@@ -9,6 +9,8 @@ Button::Button(WidgetDesc const & desc, UIWindow & owner) :
     auto lines   = TextFitter::AdjustTextToSize(*m_font, m_rect.m_size, false, m_caption);
     m_caption    = lines[0];
     m_text_color = desc.text_color;
+
+    m_font->cacheShapedText(m_caption.c_str());
 }
 
 void Button::subClassUpdate(float time, bool check_cursor)
@@ -88,7 +90,7 @@ RegionDataOfUITexture const * Button::getRegionFromState(ButtonState state) cons
     return result;
 }
 
-void Button::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const
+void Button::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text, Rect2D const & clip) const
 {
     // draw text
     float const line_height = m_font->getHeight();
@@ -99,5 +101,5 @@ void Button::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const
                 + glm::abs(m_font->getDescender());   // vertically align to the center only
     pen_pos.x = getHorizontalOffset(m_caption);
 
-    m_font->addText(ColorMap::GetOrCreate(text, m_text_color), m_caption.c_str(), pen_pos);
+    m_font->addText(ColorMap::GetOrCreate(text, m_text_color), m_caption.c_str(), pen_pos, &clip);
 }
@@ -18,10 +18,12 @@ public:
     Button(WidgetDesc const & desc, UIWindow & owner);
 
     void setCallback(std::function<void(void)> click_callback) { m_click_callback = click_callback; }
+    auto getCallback() const { return m_click_callback; }
 
 private:
-    void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const override;
+    void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text, Rect2D const & clip) const override;
     void subClassUpdate(float time, bool check_cursor) override;
+    RegionDataOfUITexture const * subClassFindRegion() const override { return getRegionFromState(m_state); }
 
     RegionDataOfUITexture const * getRegionFromState(ButtonState state) const;
 
@@ -77,41 +77,76 @@ static glm::vec2 GetWidgetsSize(Widget const & root, float border)
     return result;
 }
 
+// The layout strings only place the leaf widgets, the rect of a layoutee is the union of its children so
+// fillBuffers() can cull the subtree. An empty one keeps an empty rect.
+static void FitLayouteeRects(Widget & root)
+{
+    if(root.getType() != ElementType::VerticalLayoutee && root.getType() != ElementType::HorizontalLayoutee)
+        return;
+
+    bool   first = true;
+    Rect2D rect;
+    for(auto & ch : root.getChildren())
+    {
+        auto & w = GetRef(ch);
+        FitLayouteeRects(w);
+
+        rect  = first ? w.getRect() : Rect2D::Union_rect2D(rect, w.getRect());
+        first = false;
+    }
+
+    root.setRect(rect);
+}
+
 void ChainsPacker::fitWidgets(UIWindow * win) const
 {
     if(win == nullptr || win->getRootWidget() == nullptr)
         return;
 
-    MemPool        pool;
-    Widget &       root       = *win->getRootWidget();
-    StringLayout * top_string = nullptr;
-    auto           size       = glm::max(GetWidgetsSize(root, m_border), win->size());
+    Widget &    root   = *win->getRootWidget();
+    float const border = win->getSpacing();
+    auto        size   = win->size();
 
     if(root.getType() == ElementType::VerticalLayoutee || root.getType() == ElementType::HorizontalLayoutee)
     {
-        if(root.getType() == ElementType::VerticalLayoutee)
+        if(win->m_layout == nullptr)
+            win->m_layout = std::make_unique<WindowLayout>();
+
+        if(win->m_layout->top_string == nullptr)
         {
-            top_string = pool.createNewLayout(Direction::Up, m_border);
-            addNewString(root, top_string, pool);
+            // the chain tree is built once per widget tree, see UIWindow::sizeUpdated(); the arena of the
+            // old tree is reused
+            win->m_resized_widgets.clear();
+
+            auto &    layout = *win->m_layout;
+            Direction dir =
+                root.getType() == ElementType::VerticalLayoutee ? Direction::Up : Direction::LeftToRight;
+
+            layout.top_string = layout.pool.createNewLayout(dir, border);
+            addNewString(root, layout.top_string, layout.pool, border);
+
+            size = glm::max(GetWidgetsSize(root, border), size);
         }
         else
         {
-            top_string = pool.createNewLayout(Direction::LeftToRight, m_border);
-            addNewString(root, top_string, pool);
+            for(auto const * widget : win->m_resized_widgets)
+                win->m_layout->pool.markWidgetDirty(widget);
+            win->m_resized_widgets.clear();
         }
+
+        auto new_size = win->m_layout->top_string->resizeAll(size.x, size.y);
+        win->setSize(new_size.x, new_size.y);
+
+        FitLayouteeRects(root);
+        root.setRect(Rect2D{glm::vec2(0.f), new_size});
     }
     else
     {
+        size = glm::max(GetWidgetsSize(root, border), size);
         win->setSize(size.x, size.y);
         root.setSize(size.x, size.y);
     }
 
-    if(top_string != nullptr)
-    {
-        auto new_size = top_string->resizeAll(size.x, size.y);
-        win->setSize(new_size.x, new_size.y);
-    }
-
     auto w_rect = win->getRect();
     if(auto backround = win->getBackgroundWidget(); backround != nullptr)
     {
@@ -119,7 +154,8 @@ void ChainsPacker::fitWidgets(UIWindow * win) const
     }
 }
 
-void ChainsPacker::addNewString(Widget & string_node, StringLayout * parent, MemPool & pool) const
+void ChainsPacker::addNewString(Widget & string_node, StringLayout * parent, MemPool & pool,
+                                float border) const
 {
     for(auto & ch : string_node.getChildren())
     {
@@ -128,17 +164,17 @@ void ChainsPacker::addNewString(Widget & string_node, StringLayout * parent, Mem
         {
             case ElementType::VerticalLayoutee:
                 {
-                    auto * nested_string = pool.createNewLayout(Direction::Up, m_border);
+                    auto * nested_string = pool.createNewLayout(Direction::Up, border);
                     parent->addString(nested_string);
-                    addNewString(w, nested_string, pool);
+                    addNewString(w, nested_string, pool, border);
 
                     break;
                 }
             case ElementType::HorizontalLayoutee:
                 {
-                    auto * nested_string = pool.createNewLayout(Direction::LeftToRight, m_border);
+                    auto * nested_string = pool.createNewLayout(Direction::LeftToRight, border);
                     parent->addString(nested_string);
-                    addNewString(w, nested_string, pool);
+                    addNewString(w, nested_string, pool, border);
 
                     break;
                 }
@@ -10,11 +10,8 @@ class Packer
 public:
     virtual ~Packer() = default;
 
-    void         setSpacing(float val) { m_border = val; }
+    // stateless, the windows can be laid out in parallel; the spacing is taken from the window
     virtual void fitWidgets(UIWindow * win) const = 0;
-
-protected:
-    float m_border = 1.0f;
 };
 
 class StringLayout;
@@ -26,7 +23,7 @@ public:
     void fitWidgets(UIWindow * win) const override;
 
 protected:
-    void addNewString(Widget & string_node, StringLayout * parent, MemPool & pool) const;
+    void addNewString(Widget & string_node, StringLayout * parent, MemPool & pool, float border) const;
     void addWidgetInLayout(Widget & node, StringLayout * layout) const;
 };
 
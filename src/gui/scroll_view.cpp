@@ -0,0 +1,272 @@
+#include "scroll_view.h"
+#include "text_box.h"
+#include "uiconfigloader.h"
+#include "ui.h"
+#include <algorithm>
+
+ScrollView::ScrollView(WidgetDesc const & desc, UIWindow & owner) :
+    Widget(desc, owner),
+    m_row_font(desc.font_name),
+    m_row_font_size(desc.size),
+    m_row_text_color(desc.text_color),
+    m_row_text_hor(desc.text_hor)
+{
+    // a text line of the default rows
+    m_estimated_height = m_font->getHeight() + m_font->getLineGap() + m_fields.z + m_fields.w;
+    m_scroll_step      = 3.f * m_estimated_height;
+
+    setRowFactory(nullptr);
+}
+
+void ScrollView::setRowFactory(RowFactory factory)
+{
+    if(factory)
+    {
+        m_factory = std::move(factory);
+    }
+    else
+    {
+        m_factory = [this](UIWindow & owner) {
+            WidgetDesc desc;
+            desc.type       = ElementType::TextBox;
+            desc.min_size   = {m_rect.width(), m_estimated_height};
+            desc.font_name  = m_row_font;
+            desc.size       = m_row_font_size;
+            desc.text_color = m_row_text_color;
+            desc.text_hor   = m_row_text_hor;
+
+            return WidgetDesc::GetWidgetFromDesc(desc, owner);
+        };
+    }
+
+    // rows of the old factory
+    m_children.clear();
+    m_row_items.clear();
+    m_rebind = true;
+}
+
+void ScrollView::setItems(std::size_t count, RowBinder binder)
+{
+    m_binder = std::move(binder);
+    m_heights.assign(count, m_estimated_height);
+    m_measured.assign(count, false);
+    buildHeightTree();
+
+    m_rebind = true;
+    scrollTo(m_offset);
+}
+
+void ScrollView::setEstimatedItemHeight(float height)
+{
+    m_estimated_height = height;
+    for(std::size_t i = 0; i < m_heights.size(); ++i)
+    {
+        if(!m_measured[i])
+            m_heights[i] = height;
+    }
+    buildHeightTree();
+
+    m_rebind = true;
+}
+
+void ScrollView::scrollTo(float offset)
+{
+    float const max_offset = std::max(0.f, getContentHeight() - m_rect.height());
+    m_offset               = glm::clamp(offset, 0.f, max_offset);
+}
+
+void ScrollView::scrollToItem(std::size_t item)
+{
+    scrollTo(getItemOffset(std::min(item, m_heights.size())));
+}
+
+void ScrollView::buildHeightTree()
+{
+    // O(n): every node adds itself to its parent
+    std::size_t const n = m_heights.size();
+    m_height_tree.assign(n + 1, 0.f);
+    for(std::size_t i = 1; i <= n; ++i)
+    {
+        m_height_tree[i] += m_heights[i - 1];
+        if(std::size_t parent = i + (i & (~i + 1)); parent <= n)
+            m_height_tree[parent] += m_height_tree[i];
+    }
+}
+
+float ScrollView::getItemOffset(std::size_t item) const
+{
+    float offset = 0.f;
+    for(std::size_t i = std::min(item, m_heights.size()); i > 0; i -= i & (~i + 1))
+        offset += m_height_tree[i];
+
+    return offset;
+}
+
+std::size_t ScrollView::findItem(float offset) const
+{
+    std::size_t const n = m_heights.size();
+    if(n == 0)
+        return 0;
+
+    // binary lifting over the tree: the number of items ending above the offset
+    std::size_t pos  = 0;
+    std::size_t step = 1;
+    while(step * 2 <= n)
+        step *= 2;
+
+    for(; step > 0; step /= 2)
+    {
+        if(pos + step <= n && m_height_tree[pos + step] <= offset)
+        {
+            pos += step;
+            offset -= m_height_tree[pos];
+        }
+    }
+
+    return std::min(pos, n - 1);
+}
+
+void ScrollView::setItemHeight(std::size_t item, float height)
+{
+    float const delta = height - m_heights[item];
+    m_heights[item]   = height;
+    m_measured[item]  = true;
+
+    for(std::size_t i = item + 1; i < m_height_tree.size(); i += i & (~i + 1))
+        m_height_tree[i] += delta;
+}
+
+bool ScrollView::isCursorInside() const
+{
+    auto const & inp = *m_owner.getOwner().m_input;
+
+    return Rect2D{m_pos, m_rect.m_size}.contains(inp.getMousePosition());
+}
+
+void ScrollView::subClassUpdate(float time, bool check_cursor)
+{
+    if(check_cursor && isCursorInside())
+    {
+        auto & inp = *m_owner.getOwner().m_input;
+        for(auto const & wheel : inp.getEventQueue<MouseScrollEvent>())
+            scrollTo(m_offset - wheel.offset.y * m_scroll_step);
+    }
+
+    layoutRows();
+}
+
+void ScrollView::subClassUpdateChildren(float time, bool check_cursor)
+{
+    // the overscan rows are outside the view
+    bool const cursor_in_view = check_cursor && isCursorInside();
+    for(std::size_t r = 0; r < m_children.size(); ++r)
+    {
+        if(m_row_items[r] != NoItem)
+            m_children[r]->update(time, cursor_in_view);
+    }
+}
+
+void ScrollView::subClassFillChildren(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                                      Rect2D const & clip) const
+{
+    if(!visible() || m_children.empty())
+        return;
+
+    // the overscan rows are culled by the clip, the row text is trimmed to it, the scissor cuts the row
+    // backgrounds
+    UI const & ui = m_owner.getOwner();
+    ui.pushClipRect(clip, background, text);
+    for(std::size_t r = 0; r < m_children.size(); ++r)
+    {
+        if(m_row_items[r] != NoItem)
+            m_children[r]->fillBuffers(background, text, clip);
+    }
+    ui.popClipRect(background, text);
+}
+
+void ScrollView::layoutRows()
+{
+    constexpr float eps = std::numeric_limits<float>::epsilon();
+    if(!glm::all(glm::epsilonEqual(m_rect.m_size, m_laid_out_size, eps)))
+    {
+        m_laid_out_size = m_rect.m_size;
+        m_rebind        = true;
+        scrollTo(m_offset);
+    }
+
+    std::size_t const n = m_heights.size();
+    if(n == 0 || !m_binder || m_rect.height() <= 0.f)
+    {
+        std::fill(m_row_items.begin(), m_row_items.end(), NoItem);
+        return;
+    }
+
+    // visible range plus the overscan
+    std::size_t const top_item = findItem(m_offset);
+
+    std::size_t first = top_item;
+    std::size_t last  = findItem(m_offset + m_rect.height());
+    first             = first > static_cast<std::size_t>(m_overscan) ? first - m_overscan : 0;
+    last              = std::min(n - 1, last + m_overscan);
+
+    // rows of the items that left the range are free
+    m_has_row.assign(last - first + 1, false);
+    for(auto & item : m_row_items)
+    {
+        if(m_rebind || item == NoItem || item < first || item > last)
+            item = NoItem;
+        else
+            m_has_row[item - first] = true;
+    }
+    m_rebind = false;
+
+    // the new items take the free rows, rows are created only when the range grows
+    std::size_t free_row = 0;
+    for(std::size_t item = first; item <= last; ++item)
+    {
+        if(m_has_row[item - first])
+            continue;
+
+        while(free_row < m_row_items.size() && m_row_items[free_row] != NoItem)
+            free_row++;
+        if(free_row == m_row_items.size())
+        {
+            adoptChild(m_factory(m_owner));
+            m_row_items.push_back(NoItem);
+        }
+
+        // the width is set before binding, text rows are fitted to it
+        Widget & row = *m_children[free_row];
+        row.setRect(Rect2D{m_rect.left(), 0.f, m_rect.width(), m_heights[item]});
+        m_binder(row, item);
+        m_row_items[free_row] = item;
+
+        float const height = row.minimumSize().y;
+        if(height > 0.f && !glm::epsilonEqual(height, m_heights[item], eps))
+        {
+            // the items above the view don't move the ones in it
+            if(item < top_item)
+                m_offset += height - m_heights[item];
+            setItemHeight(item, height);
+        }
+    }
+
+    // rows from the top of the view down, in window coordinates
+    glm::vec2 const origin = m_pos - m_rect.m_pos;
+    for(std::size_t r = 0; r < m_children.size(); ++r)
+    {
+        Widget & row = *m_children[r];
+        if(m_row_items[r] == NoItem)
+        {
+            row.hide();
+            continue;
+        }
+
+        std::size_t const item = m_row_items[r];
+        float const       top  = m_rect.top() - (getItemOffset(item) - m_offset);
+
+        row.setRect(Rect2D{m_rect.left(), top - m_heights[item], m_rect.width(), m_heights[item]});
+        row.move(origin);
+        row.show();
+    }
+}
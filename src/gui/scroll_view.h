@@ -0,0 +1,70 @@
+#ifndef SCROLL_VIEW_H
+#define SCROLL_VIEW_H
+
+#include "widget.h"
+#include <functional>
+#include <limits>
+
+// Virtualized vertical list. Only the items in the view plus the overscan have row widgets, the rows are
+// recycled while scrolling and bound to their items by the binder. The item heights are estimated until
+// a bound row reports its minimum height; their offsets are kept in a Fenwick tree, so a frame costs
+// O(log n + visible rows) for any number of items. The rows are clipped to the view with the scissor test.
+class ScrollView : public Widget
+{
+public:
+    using RowFactory = std::function<std::unique_ptr<Widget>(UIWindow & owner)>;
+    using RowBinder  = std::function<void(Widget & row, std::size_t item)>;
+
+    static constexpr std::size_t NoItem = std::numeric_limits<std::size_t>::max();
+
+    ScrollView(WidgetDesc const & desc, UIWindow & owner);
+
+    void setRowFactory(RowFactory factory);   // TextBox rows with the font of the view by default
+    void setItems(std::size_t count, RowBinder binder);
+    void itemsChanged() { m_rebind = true; }   // the rows are bound again on the next update
+    void setEstimatedItemHeight(float height);   // for the items not bound yet
+    void setOverscan(int32_t rows) { m_overscan = rows; }
+
+    void        scrollTo(float offset);   // from the top of the first item
+    void        scrollToItem(std::size_t item);
+    float       getScrollOffset() const { return m_offset; }
+    float       getContentHeight() const { return getItemOffset(m_heights.size()); }
+    std::size_t getItemCount() const { return m_heights.size(); }
+
+private:
+    void subClassUpdate(float time, bool check_cursor) override;
+    void subClassUpdateChildren(float time, bool check_cursor) override;
+    void subClassFillChildren(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                              Rect2D const & clip) const override;
+
+    bool        isCursorInside() const;
+    float       getItemOffset(std::size_t item) const;   // sum of the heights of the items above it
+    std::size_t findItem(float offset) const;            // item at the offset from the top
+    void        setItemHeight(std::size_t item, float height);
+    void        buildHeightTree();
+    void        layoutRows();
+
+    RowFactory m_factory;
+    RowBinder  m_binder;
+
+    std::vector<float>       m_heights;       // per item, estimated or measured
+    std::vector<bool>        m_measured;
+    std::vector<float>       m_height_tree;   // Fenwick tree over m_heights, 1-based
+    std::vector<std::size_t> m_row_items;     // item bound to each child row, NoItem if the row is free
+    std::vector<bool>        m_has_row;       // scratch: items of the visible range with a bound row
+
+    float     m_estimated_height = 0.f;
+    float     m_offset           = 0.f;
+    float     m_scroll_step      = 0.f;   // per wheel notch
+    int32_t   m_overscan         = 4;     // rows bound above and below the view
+    glm::vec2 m_laid_out_size    = {};    // the rows are bound again when the view is resized
+    bool      m_rebind           = false;
+
+    // default rows
+    std::string m_row_font;
+    float       m_row_font_size  = 0.f;
+    glm::vec4   m_row_text_color = ColorMap::black;
+    Align       m_row_text_hor   = Align::left;
+};
+
+#endif   // SCROLL_VIEW_H
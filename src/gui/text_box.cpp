@@ -9,7 +9,7 @@ TextBox::TextBox(WidgetDesc const & desc, UIWindow & owner) :
     adjustTextToLines();
 }
 
-void TextBox::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const
+void TextBox::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text, Rect2D const & clip) const
 {
     if(!m_formated)
         return;
@@ -23,9 +23,15 @@ void TextBox::subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const
         glm::vec2 text_pos;
         text_pos.x = getHorizontalOffset(line);
         text_pos.y = y + getVerticalOffset();
-
-        m_font->addText(ColorMap::GetOrCreate(text, m_text_color), line.c_str(), text_pos);
         y -= line_height;
+
+        // lines above the clip rect are skipped, the ones below it end the text
+        if(text_pos.y + m_font->getDescender() >= clip.top())
+            continue;
+        if(text_pos.y + m_font->getAscender() <= clip.bottom())
+            break;
+
+        m_font->addText(ColorMap::GetOrCreate(text, m_text_color), line.c_str(), text_pos, &clip);
     }
 }
 
@@ -42,5 +48,8 @@ void TextBox::adjustTextToLines()
     glm::vec2 fit_size{m_rect.width() - m_fields.x - m_fields.y, m_rect.height() - m_fields.z - m_fields.w};
     m_lines = TextFitter::AdjustTextToSize(*m_font, fit_size, false, m_text);
 
+    for(auto const & line : m_lines)
+        m_font->cacheShapedText(line.c_str());
+
     m_formated = true;
 }
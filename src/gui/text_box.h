@@ -12,7 +12,7 @@ public:
 
 private:
     void adjustTextToLines();
-    void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const override;
+    void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text, Rect2D const & clip) const override;
 
 protected:
     std::string m_text       = {};
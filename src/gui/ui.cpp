@@ -2,14 +2,60 @@
 #include "uiconfigloader.h"
 #include "../render/vertex_buffer.h"
 #include "../render/renderer.h"
+#include "button.h"
+#include <algorithm>
+#include <cassert>
+#include <future>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+using CallbackMap = std::map<std::string, std::function<void(void)>>;   // widget id -> click callback
+
+static void CollectCallbacks(Widget const & widget, CallbackMap & callbacks)
+{
+    if(widget.getType() == ElementType::Button)
+    {
+        if(auto fn = static_cast<Button const &>(widget).getCallback(); fn)
+            callbacks[widget.getId()] = std::move(fn);
+    }
+
+    for(auto const & ch : widget.getChildren())
+        CollectCallbacks(*ch, callbacks);
+}
 
 UI::UI(FileSystem & fsys) : m_fsys(fsys), m_fonts(fsys), m_win_buf(VertexBuffer::pos_tex)
 {
-    m_packer = std::make_unique<ChainsPacker>();
+    m_packer      = std::make_unique<ChainsPacker>();
+    m_layout_pool = std::make_unique<ThreadPool>();
 }
 
 void UI::update(float time)
 {
+    // the windows don't share layout state, the dirty ones are laid out in parallel first
+    std::vector<UIWindow *> dirty_windows;
+    for(auto & ptr : m_windows)
+    {
+        if(ptr->needsLayout())
+            dirty_windows.push_back(ptr.get());
+    }
+
+    if(dirty_windows.size() > 1)
+    {
+        // the main thread takes the last window instead of only waiting
+        std::vector<std::future<void>> layouts;
+        layouts.reserve(dirty_windows.size() - 1);
+        for(std::size_t i = 0; i + 1 < dirty_windows.size(); ++i)
+        {
+            UIWindow * win = dirty_windows[i];
+            layouts.push_back(m_layout_pool->enqueue([win]() { win->layout(); }));
+        }
+        dirty_windows.back()->layout();
+
+        for(auto & fut : layouts)
+            fut.get();
+    }
+
     for(auto & ptr : m_windows)
     {
         ptr->update(time, true);
@@ -18,24 +64,31 @@ void UI::update(float time)
 
 void UI::clearAndFillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const
 {
+    m_clip_batches.clear();
+    m_clip_stack.clear();
     background.clear();
     for(auto & [color, text_buf] : text)
     {
         text_buf.clear();
     }
 
+    Rect2D const screen{glm::vec2(0.f), glm::vec2(m_screen_size)};
     for(auto const & ptr : m_windows)
     {
-        ptr->fillBuffers(background, text);
+        ptr->fillBuffers(background, text, screen);
     }
 }
 
 bool UI::init(RendererBase & render)
 {
-    if(auto file = m_fsys.getFile("ui/jsons/ui_res.json"); file)
+    if(auto file = m_fsys.getFile(UIResFileName); file)
     {
+        // the images of an up to date baked atlas are not packed again, ParseUIRes() adds the rest
+        m_ui_image_atlas.loadBaked(m_fsys, UIImageGroupManager::GetBakeKey(*file));
         UIImageManagerDesc::ParseUIRes(m_ui_image_atlas, *file, m_fsys);
+        m_fonts.loadCache();
         FontDataDesc::ParseFontsRes(m_fonts, *file);
+        m_fonts.saveCache();
         UIDesc::ParseDefaultUISetID(*this, *file);
     }
     else
@@ -47,6 +100,41 @@ bool UI::init(RendererBase & render)
     return true;
 }
 
+static void DrawRange(RendererBase const & render, VertexBuffer const & geo, uint32_t first, uint32_t end)
+{
+    if(end > first)
+        render.drawIndexed(first, end - first, 0, geo.getNumVertex());
+}
+
+// the index ranges of geo recorded in the batches are drawn with their scissor rects, the rest without
+static void DrawClipped(RendererBase const & render, VertexBuffer const & geo,
+                        std::vector<UI::ClipBatch> const & batches)
+{
+    if(batches.empty())
+    {
+        render.draw(geo);
+        return;
+    }
+
+    uint32_t cur = 0;
+    for(auto const & batch : batches)
+    {
+        auto it = std::find_if(batch.ranges.begin(), batch.ranges.end(),
+                               [&geo](auto const & range) { return range.first == &geo; });
+        if(it == batch.ranges.end())
+            continue;
+
+        DrawRange(render, geo, cur, it->second.x);
+        render.enableScissor(batch.rect);
+        DrawRange(render, geo, it->second.x, it->second.y);
+        render.disableScissor();
+
+        cur = it->second.y;
+    }
+
+    DrawRange(render, geo, cur, geo.getNumTriangles() * 3);
+}
+
 void UI::draw(RendererBase & render)
 {
     glm::mat4   prj_mtx;
@@ -58,8 +146,17 @@ void UI::draw(RendererBase & render)
     render.setIdentityMatrix(RendererBase::MatrixType::MODELVIEW);
 
     clearAndFillBuffers(m_win_buf, m_colored_text_buffers);
+    // shaped text that skipped glyphs not loaded yet is filled again with them
+    if(m_fonts.loadMissingGlyphs() > 0)
+        clearAndFillBuffers(m_win_buf, m_colored_text_buffers);
     render.uploadBuffer(m_win_buf);
 
+    // glyphs of the shaped text are loaded on demand, so the atlases can change after init()
+    if(getUIImageAtlas().isDirty())
+        AtlasTex::UploadAtlasTexture(render, getUIImageAtlas());
+    if(getFontImageAtlas().isDirty())
+        AtlasTex::UploadAtlasTexture(render, getFontImageAtlas());
+
     AlphaState blend;
     DepthState depth;
     depth.enabled       = false;
@@ -69,6 +166,12 @@ void UI::draw(RendererBase & render)
     auto const old_blend = render.setAlphaState(blend);
 
     // draw background
+    if(getUIImageAtlas().getOptions().premultiplied_alpha)
+    {
+        AlphaState premultiplied = blend;
+        premultiplied.src_blend  = AlphaState::SrcBlendMode::ONE;
+        render.setAlphaState(premultiplied);
+    }
     slot.coord_source      = TextureSlot::TexCoordSource::TEX_COORD_BUFFER;
     slot.tex_channel_num   = 0;
     slot.texture           = getUIImageAtlas().getAtlasTextureState();
@@ -77,9 +180,10 @@ void UI::draw(RendererBase & render)
     render.addTextureSlot(slot);
     render.bindSlots();
     render.bindVertexBuffer(&m_win_buf);
-    render.draw(m_win_buf);
+    DrawClipped(render, m_win_buf, m_clip_batches);
     render.unbindVertexBuffer();
     render.unbindAndClearSlots();
+    render.setAlphaState(blend);   // the font atlas has straight alpha
 
     // draw text
     for(auto & [color, text_buf] : m_colored_text_buffers)
@@ -95,7 +199,7 @@ void UI::draw(RendererBase & render)
         render.addTextureSlot(slot);
         render.bindSlots();
         render.bindVertexBuffer(&text_buf);
-        render.draw(text_buf);
+        DrawClipped(render, text_buf, m_clip_batches);
         render.unbindVertexBuffer();
         render.unbindAndClearSlots();
     }
@@ -105,8 +209,74 @@ void UI::draw(RendererBase & render)
     render.setAlphaState(old_blend);
 }
 
+void UI::pushClipRect(Rect2D const & rect, VertexBuffer const & background,
+                      ColorMap::ColoredTextBuffers const & text) const
+{
+    glm::ivec4 clip{glm::floor(rect.m_pos), glm::ceil(rect.m_size)};
+    if(!m_clip_stack.empty())
+    {
+        closeClipBatch(background, text);
+
+        // intersection with the outer rect
+        glm::ivec4 const & outer = m_clip_stack.back();
+        glm::ivec2 const   lb    = glm::max(glm::ivec2(clip), glm::ivec2(outer));
+        glm::ivec2 const   rt    = glm::min(glm::ivec2(clip) + glm::ivec2(clip.z, clip.w),
+                                            glm::ivec2(outer) + glm::ivec2(outer.z, outer.w));
+        clip = glm::ivec4(lb, glm::max(rt - lb, glm::ivec2(0)));
+    }
+
+    m_clip_stack.push_back(clip);
+    openClipBatch(clip, background, text);
+}
+
+void UI::popClipRect(VertexBuffer const & background, ColorMap::ColoredTextBuffers const & text) const
+{
+    assert(!m_clip_stack.empty());
+
+    closeClipBatch(background, text);
+    m_clip_stack.pop_back();
+
+    if(!m_clip_stack.empty())
+        openClipBatch(m_clip_stack.back(), background, text);
+}
+
+void UI::openClipBatch(glm::ivec4 const & rect, VertexBuffer const & background,
+                       ColorMap::ColoredTextBuffers const & text) const
+{
+    ClipBatch batch;
+    batch.rect = rect;
+    batch.ranges.emplace_back(&background, glm::uvec2(background.getNumTriangles() * 3));
+    for(auto const & [color, text_buf] : text)
+        batch.ranges.emplace_back(&text_buf, glm::uvec2(text_buf.getNumTriangles() * 3));
+
+    m_clip_batches.push_back(std::move(batch));
+}
+
+void UI::closeClipBatch(VertexBuffer const & background, ColorMap::ColoredTextBuffers const & text) const
+{
+    auto & ranges = m_clip_batches.back().ranges;
+    auto   close  = [&ranges](VertexBuffer const & buf) {
+        auto it = std::find_if(ranges.begin(), ranges.end(),
+                               [&buf](auto const & range) { return range.first == &buf; });
+        if(it == ranges.end())   // text color added inside the rect
+            it = ranges.insert(ranges.end(), {&buf, glm::uvec2(0)});
+        it->second.y = buf.getNumTriangles() * 3;
+    };
+
+    close(background);
+    for(auto const & [color, text_buf] : text)
+        close(text_buf);
+
+    // empty ranges are not drawn
+    ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                                [](auto const & range) { return range.second.y <= range.second.x; }),
+                 ranges.end());
+}
+
 void UI::terminate(RendererBase & render)
 {
+    m_fonts.saveCache();   // glyphs loaded after init
+
     AtlasTex::DeleteAtlasTexture(render, getUIImageAtlas());
     AtlasTex::DeleteAtlasTexture(render, getFontImageAtlas());
 
@@ -122,14 +292,32 @@ void UI::terminate(RendererBase & render)
 
 UIWindow * UI::loadWindow(InFile & file_json, int32_t layer, std::string const & image_group)
 {
-    std::unique_ptr<UIWindow> win;
+    auto win = createWindow(image_group);
+    WindowDesc::LoadWindow(*win, file_json);
+    win->setSourcePath(FileSystem::NormalizePath(file_json.getName()));
+
+    return addWindow(std::move(win), layer);
+}
+
+UIWindow * UI::loadWindow(InputFileStream & json_stream, int32_t layer, std::string const & image_group)
+{
+    auto win = createWindow(image_group);
+    WindowDesc::LoadWindow(*win, json_stream);
+    win->setSourcePath(FileSystem::NormalizePath(json_stream.getName()));
+
+    return addWindow(std::move(win), layer);
+}
+
+std::unique_ptr<UIWindow> UI::createWindow(std::string const & image_group)
+{
     if(image_group.empty())
-        win = std::make_unique<UIWindow>(*this, m_current_gui_set);
+        return std::make_unique<UIWindow>(*this, m_current_gui_set);
     else
-        win = std::make_unique<UIWindow>(*this, image_group);
-
-    WindowDesc::LoadWindow(*win, file_json);
+        return std::make_unique<UIWindow>(*this, image_group);
+}
 
+UIWindow * UI::addWindow(std::unique_ptr<UIWindow> win, int32_t layer)
+{
     m_windows.push_back(std::move(win));
 
     auto * win_ptr = m_windows.back().get();
@@ -143,11 +331,94 @@ UIWindow * UI::loadWindow(InFile & file_json, int32_t layer, std::string const &
     return win_ptr;
 }
 
+void UI::loadWindowAsync(std::string const & json_path, std::function<void(UIWindow *)> on_loaded,
+                         int32_t layer, std::string const & image_group)
+{
+    m_fsys.getFileAsync(json_path, [this, layer, image_group, on_loaded = std::move(on_loaded)](
+                                       std::optional<InFile> file) {
+        UIWindow * win_ptr = file ? loadWindow(*file, layer, image_group) : nullptr;
+        if(on_loaded)
+            on_loaded(win_ptr);
+    });
+}
+
 void UI::fitWidgets(UIWindow * win_ptr) const
 {
     if(win_ptr == nullptr)
         return;
 
-    m_packer->setSpacing(win_ptr->getSpacing());
     m_packer->fitWidgets(win_ptr);
 }
+
+void UI::reloadChangedFiles(std::vector<std::string> const & paths)
+{
+    bool regions_changed = m_ui_image_atlas.reloadImageFiles(m_fsys, paths);
+
+    for(auto const & path : paths)
+    {
+        if(path == UIResFileName)
+        {
+            try
+            {
+                if(auto file = m_fsys.getFile(path); file)
+                    UIImageManagerDesc::ParseUIRes(m_ui_image_atlas, *file, m_fsys);
+            }
+            catch(std::exception const & e)
+            {
+                std::stringstream ss;
+                ss << "UI::reloadChangedFiles File: " << path << " - " << e.what();
+                std::cout << ss.str() << std::endl;
+            }
+            regions_changed = true;
+        }
+        else
+        {
+            for(auto & win : m_windows)
+                if(win->getSourcePath() == path)
+                    reloadWindow(*win);
+        }
+    }
+
+    // regions may have been moved or the atlas rebuilt
+    if(regions_changed)
+        for(auto & win : m_windows)
+            win->refreshRegions();
+}
+
+bool UI::reloadWindow(UIWindow & win)
+{
+    auto file = m_fsys.getFile(win.getSourcePath());
+    if(!file)
+        return false;
+
+    // the callbacks are set by the application, they are moved to the new widgets with the same id
+    CallbackMap callbacks;
+    if(auto * root = win.getRootWidget(); root != nullptr)
+        CollectCallbacks(*root, callbacks);
+    if(auto * background = win.getBackgroundWidget(); background != nullptr)
+        CollectCallbacks(*background, callbacks);
+
+    try
+    {
+        // the window is not changed if the json can't be parsed
+        WindowDesc::LoadWindow(win, *file);
+    }
+    catch(std::exception const & e)
+    {
+        std::stringstream ss;
+        ss << "UI::reloadWindow File: " << win.getSourcePath() << " - " << e.what();
+        std::cout << ss.str() << std::endl;
+        return false;
+    }
+
+    for(auto & [id, fn] : callbacks)
+    {
+        auto * widget = win.getWidgetFromID(id);
+        if(widget != nullptr && widget->getType() == ElementType::Button)
+            static_cast<Button *>(widget)->setCallback(std::move(fn));
+    }
+
+    win.sizeUpdated();   // laid out again on the next update
+
+    return true;
+}
@@ -2,6 +2,7 @@
 #define GUI_H
 
 #include <glm/glm.hpp>
+#include "../fs/thread_pool.h"
 #include "../input/input.h"
 #include "../render/vertex_buffer.h"
 #include "utils/fontmanager.h"
@@ -16,6 +17,8 @@ class UI
 public:
     UI(FileSystem & fsys);
 
+    static constexpr char const * UIResFileName = "ui/jsons/ui_res.json";
+
     void       update(float time);
     void       resize(int32_t w, int32_t h) { m_screen_size = glm::ivec2{w, h}; }
     glm::ivec2 getScreenSize() const { return m_screen_size; }
@@ -26,16 +29,43 @@ public:
 
     UIWindow * loadWindow(InFile & file_json, int32_t layer = 0,
                           std::string const & image_group = std::string());
+    UIWindow * loadWindow(InputFileStream & json_stream, int32_t layer = 0,
+                          std::string const & image_group = std::string());
+    // the json is read on the worker pool, the window is built and on_loaded is called (nullptr on
+    // failure) from FileSystem::processCompleted() on the main thread
+    void loadWindowAsync(std::string const & json_path, std::function<void(UIWindow *)> on_loaded,
+                         int32_t layer = 0, std::string const & image_group = std::string());
 
     void fitWidgets(UIWindow * win_ptr) const;
 
+    // Hot reload of the files reported by FileSystem::pollChanges(): changed images are decoded again and
+    // patched into their atlas regions, ui_res.json adds and replaces images, window jsons are parsed and
+    // laid out again. Fonts are not reloaded.
+    void reloadChangedFiles(std::vector<std::string> const & paths);
+    bool reloadWindow(UIWindow & win);   // button callbacks are kept
+
     AtlasTex & getUIImageAtlas() { return m_ui_image_atlas.getAtlas(); }
     AtlasTex & getFontImageAtlas() { return m_fonts.getAtlas(); }
 
     glm::vec4 const & getFontColor() const { return m_font_color; }
 
+    // Scissor clipped index ranges of the batched UI buffers, recorded by the widgets clipping their
+    // children (ScrollView) in fillBuffers() and drawn with the scissor test by draw(). Nested rects are
+    // intersected.
+    struct ClipBatch
+    {
+        glm::ivec4                                               rect;     // screen pixels
+        std::vector<std::pair<VertexBuffer const *, glm::uvec2>> ranges;   // first, end index per buffer
+    };
+    void pushClipRect(Rect2D const & rect, VertexBuffer const & background,
+                      ColorMap::ColoredTextBuffers const & text) const;
+    void popClipRect(VertexBuffer const & background, ColorMap::ColoredTextBuffers const & text) const;
+
     // private
-    void clearAndFillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const;
+    std::unique_ptr<UIWindow> createWindow(std::string const & image_group);
+    UIWindow *                addWindow(std::unique_ptr<UIWindow> win, int32_t layer);
+    void                      clearAndFillBuffers(VertexBuffer &                  background,
+                                                  ColorMap::ColoredTextBuffers & text) const;
 
     Input *      m_input = nullptr;
     FileSystem & m_fsys;
@@ -48,12 +78,21 @@ public:
     std::unique_ptr<Packer> m_packer;
     std::string             m_current_gui_set = {"default"};
 
+    void openClipBatch(glm::ivec4 const & rect, VertexBuffer const & background,
+                       ColorMap::ColoredTextBuffers const & text) const;
+    void closeClipBatch(VertexBuffer const & background, ColorMap::ColoredTextBuffers const & text) const;
+
     mutable VertexBuffer                 m_win_buf;
     mutable ColorMap::ColoredTextBuffers m_colored_text_buffers =
         ColorMap::ColoredTextBuffers{ColorMap::EpsilonLessVec4(0.001f)};
 
+    mutable std::vector<ClipBatch>  m_clip_batches;
+    mutable std::vector<glm::ivec4> m_clip_stack;
+
     std::vector<std::unique_ptr<UIWindow>> m_windows;
     std::vector<std::vector<UIWindow *>>   m_layers;
+    // own workers for the window layouts, the pool of the file system may be busy with the asset jobs
+    std::unique_ptr<ThreadPool> m_layout_pool;   // last member: workers are joined first
 };
 
 #endif
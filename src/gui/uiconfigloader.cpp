@@ -6,7 +6,32 @@
 #include "text_box.h"
 #include "button.h"
 #include "imagebox.h"
+#include "scroll_view.h"
 #include <boost/json.hpp>
+#include <vector>
+
+// the json text is fed to the parser directly, without building a copy of the file
+static boost::json::value ReadJson(InputMemoryStream const & stream)
+{
+    boost::json::stream_parser parser;
+
+    parser.write(reinterpret_cast<char const *>(stream.getPtr()), stream.getCapacity());
+    parser.finish();
+
+    return parser.release();
+}
+
+static boost::json::value ReadJson(InputFileStream & stream)
+{
+    boost::json::stream_parser parser;
+    std::vector<char>          chunk(InputFileStream::ChunkSize);
+
+    while(size_t const count = stream.readSome(chunk.data(), chunk.size()))
+        parser.write(chunk.data(), count);
+    parser.finish();
+
+    return parser.release();
+}
 
 Glyph::OutlineType FontDataDesc::GetOutlineTypeFromString(std::string_view str_outline)
 {
@@ -28,16 +53,7 @@ void FontDataDesc::ParseFontsRes(FontManager & fmgr, InFile & file_json)
 
     try
     {
-        std::string file_data;
-
-        std::string line;
-        while(GetLine(file_json.getStream(), line))
-        {
-            file_data += line;
-        }
-        file_json.getStream().resetHead();
-
-        jv = boost::json::parse(file_data);
+        jv = ReadJson(file_json.getStream());
     }
     catch(std::exception const & e)
     {
@@ -77,6 +93,15 @@ void FontDataDesc::ParseFontsRes(FontManager & fmgr, InFile & file_json)
                     {
                         desc.kerning = kvp.value().as_bool();
                     }
+                    else if(kvp.key() == sid_shaping)
+                    {
+                        desc.shaping = kvp.value().as_bool();
+                    }
+                    else if(kvp.key() == sid_fallback)
+                    {
+                        for(auto const & fallback_id : kvp.value().as_array())
+                            desc.fallback.emplace_back(fallback_id.as_string());
+                    }
                     else if(kvp.key() == sid_outline_thickness)
                     {
                         desc.outline_thickness = kvp.value().as_double();
@@ -101,6 +126,9 @@ void FontDataDesc::ParseFontsRes(FontManager & fmgr, InFile & file_json)
                     }
                 }
 
+                if(!desc.fallback.empty())
+                    fmgr.setFallbackChain(desc.font_id, desc.fallback);
+
                 auto & fnt = fmgr.addFont(desc);
                 fnt.cacheGlyphs(glyphs.c_str());
             }
@@ -187,6 +215,18 @@ static std::unique_ptr<Widget> GetWidgetFromJson(boost::json::object const & obj
         {
             desc.stretch = static_cast<float>(kvp.value().as_int64());
         }
+        else if(kvp.key() == WidgetDesc::sid_basis)
+        {
+            std::vector<int32_t> vec;
+            vec = boost::json::value_to<std::vector<int32_t>>(kvp.value());
+
+            desc.basis.x = static_cast<float>(vec[0]);
+            desc.basis.y = static_cast<float>(vec[1]);
+        }
+        else if(kvp.key() == WidgetDesc::sid_shrink)
+        {
+            desc.shrink = static_cast<float>(kvp.value().to_number<double>());
+        }
         else if(kvp.key() == WidgetDesc::sid_visible)
         {
             desc.visible = kvp.value().as_bool();
@@ -237,7 +277,9 @@ static std::unique_ptr<Widget> GetWidgetFromJson(boost::json::object const & obj
 
     auto widg_ptr = WidgetDesc::GetWidgetFromDesc(desc, owner);
 
-    if(auto const children_it = obj.find(WidgetDesc::sid_children); children_it != obj.end())
+    // the rows of a ScrollView are created by its row factory
+    if(auto const children_it = obj.find(WidgetDesc::sid_children);
+       children_it != obj.end() && desc.type != ElementType::ScrollView)
     {
         auto const & arr = children_it->value().as_array();
         if(!arr.empty())
@@ -277,6 +319,12 @@ std::unique_ptr<Widget> WidgetDesc::GetWidgetFromDesc(WidgetDesc const & desc, U
             {
                 result = std::make_unique<Button>(desc, owner);
 
+                break;
+            }
+        case ElementType::ScrollView:
+            {
+                result = std::make_unique<ScrollView>(desc, owner);
+
                 break;
             }
         case ElementType::VerticalLayoutee:
@@ -298,22 +346,34 @@ void WindowDesc::LoadWindow(UIWindow & win, InFile & file_json)
 
     try
     {
-        std::string file_data;
+        jv = ReadJson(file_json.getStream());
+    }
+    catch(std::exception const & e)
+    {
+        throw std::runtime_error(e.what());
+    }
 
-        std::string line;
-        while(GetLine(file_json.getStream(), line))
-        {
-            file_data += line;
-        }
-        file_json.getStream().resetHead();
+    LoadWindow(win, jv);
+}
+
+void WindowDesc::LoadWindow(UIWindow & win, InputFileStream & json_stream)
+{
+    boost::json::value jv;
 
-        jv = boost::json::parse(file_data);
+    try
+    {
+        jv = ReadJson(json_stream);
     }
     catch(std::exception const & e)
     {
         throw std::runtime_error(e.what());
     }
 
+    LoadWindow(win, jv);
+}
+
+void WindowDesc::LoadWindow(UIWindow & win, boost::json::value const & jv)
+{
     assert(!jv.is_null());
 
     if(auto const & win_obj = jv.get_object(); !win_obj.empty())
@@ -354,43 +414,67 @@ void WindowDesc::LoadWindow(UIWindow & win, InFile & file_json)
 
 void parseImages(boost::json::value const & jv, UIImageGroup & group, FileSystem & fsys)
 {
+    struct ImageDesc
+    {
+        std::string               path;
+        std::string               name;
+        std::vector<int32_t>      margins;
+        UIImageGroup::ImageFuture image;
+    };
+
     auto const & arr = jv.get_array();
     if(!arr.empty())
     {
+        // all images of the group are decoded in parallel
+        std::vector<ImageDesc> images;
+        images.reserve(arr.size());
         for(auto const & kvp : arr)
         {
-            std::string          path;
-            std::string          name;
-            std::vector<int32_t> margins;
+            ImageDesc desc;
 
             auto const it = kvp.get_object().begin();
-            name          = it->key();
+            desc.name     = it->key();
 
             for(auto const & kvp2 : it->value().as_object())
             {
                 if(kvp2.key() == UIImageManagerDesc::sid_texture)
-                    path = kvp2.value().as_string();
+                    desc.path = kvp2.value().as_string();
                 else if(kvp2.key() == UIImageManagerDesc::sid_9slice_margins)
                 {
-                    margins = boost::json::value_to<std::vector<int32_t>>(kvp2.value());
+                    desc.margins = boost::json::value_to<std::vector<int32_t>>(kvp2.value());
                 }
             }
 
-            tex::ImageData image;
-            if(auto file = fsys.getFile(path); file)
+            // ui_res.json reloaded: images already in the atlas are patched by the file watcher
+            if(auto const * reg = group.getImageRegion(desc.name); reg != nullptr && reg->path == desc.path)
             {
-                if(!tex::ReadTGA(*file, image))
-                    continue;
+                auto const & m = desc.margins;
+                group.setMargins(desc.name, m[0], m[1], m[2], m[3]);
+                continue;
             }
-            else
+
+            desc.image = UIImageGroup::LoadImageAsync(fsys, desc.path);
+            images.push_back(std::move(desc));
+        }
+
+        // the atlas is filled on this thread in the order of the description
+        for(auto & desc : images)
+        {
+            auto image = desc.image.get();
+            if(!image)
                 continue;
 
-            if(group.addImage(name, path, image, margins[0], margins[1], margins[2], margins[3]) == -1)
+            auto const & m         = desc.margins;
+            auto         add_image = [&]() {
+                return group.updateImage(desc.name, desc.path, *image, m[0], m[1], m[2], m[3]);
+            };
+
+            if(add_image() == -1)
             {
                 // texture atlas is full
                 // let's try again
                 group.getOwner().resizeAtlas();
-                if(group.addImage(name, path, image, margins[0], margins[1], margins[2], margins[3]) == -1)
+                if(add_image() == -1)
                     throw std::runtime_error("Texture atlas is full");
             }
         }
@@ -403,16 +487,7 @@ void UIImageManagerDesc::ParseUIRes(UIImageGroupManager & mgr, InFile & file_jso
 
     try
     {
-        std::string file_data;
-
-        std::string line;
-        while(GetLine(file_json.getStream(), line))
-        {
-            file_data += line;
-        }
-        file_json.getStream().resetHead();
-
-        jv = boost::json::parse(file_data);
+        jv = ReadJson(file_json.getStream());
     }
     catch(std::exception const & e)
     {
@@ -441,8 +516,11 @@ void UIImageManagerDesc::ParseUIRes(UIImageGroupManager & mgr, InFile & file_jso
                     }
                     else if(kvp.key() == sid_images)
                     {
-                        mgr.m_groups[gr_name] = std::make_unique<UIImageGroup>(mgr, fsys);
-                        parseImages(kvp.value(), *mgr.m_groups[gr_name], fsys);
+                        // groups are kept on reload, windows point to them
+                        auto & group = mgr.m_groups[gr_name];
+                        if(!group)
+                            group = std::make_unique<UIImageGroup>(mgr, fsys);
+                        parseImages(kvp.value(), *group, fsys);
                     }
                 }
             }
@@ -461,16 +539,7 @@ void UIDesc::ParseDefaultUISetID(UI & ui, InFile & file_json)
 
     try
     {
-        std::string file_data;
-
-        std::string line;
-        while(GetLine(file_json.getStream(), line))
-        {
-            file_data += line;
-        }
-        file_json.getStream().resetHead();
-
-        jv = boost::json::parse(file_data);
+        jv = ReadJson(file_json.getStream());
     }
     catch(std::exception const & e)
     {
@@ -6,6 +6,12 @@
 #include "utils/texfont.h"
 #include <glm/glm.hpp>
 #include <memory>
+#include <vector>
+
+namespace boost::json
+{
+class value;
+}
 
 class UIImageGroupManager;
 class UIWindow;
@@ -24,14 +30,18 @@ struct FontDataDesc
     static constexpr char const * sid_outline_type      = "outline_type";
     static constexpr char const * sid_font_size         = "font_size";
     static constexpr char const * sid_glyphs            = "glyphs";
-
-    std::string        filename;
-    std::string        font_id;
-    float              pt_size           = 24.0f;
-    bool               hinting           = true;
-    bool               kerning           = true;
-    float              outline_thickness = 0.0f;
-    Glyph::OutlineType outline_type      = Glyph::OutlineType::NONE;
+    static constexpr char const * sid_shaping           = "shaping";
+    static constexpr char const * sid_fallback          = "fallback";
+
+    std::string              filename;
+    std::string              font_id;
+    float                    pt_size           = 24.0f;
+    bool                     hinting           = true;
+    bool                     kerning           = true;
+    float                    outline_thickness = 0.0f;
+    Glyph::OutlineType       outline_type      = Glyph::OutlineType::NONE;
+    bool                     shaping           = false;
+    std::vector<std::string> fallback;   // font ids, in lookup order
 
     static Glyph::OutlineType GetOutlineTypeFromString(std::string_view str_outline);
     static void               ParseFontsRes(FontManager & fmgr, InFile & file_json);
@@ -47,6 +57,8 @@ struct WidgetDesc
     static constexpr char const * sid_region_name      = "region_name";
     static constexpr char const * sid_id_name          = "id_name";
     static constexpr char const * sid_stretch          = "stretch";
+    static constexpr char const * sid_basis            = "basis";
+    static constexpr char const * sid_shrink           = "shrink";
     static constexpr char const * sid_align_horizontal = "align_horizontal";
     static constexpr char const * sid_align_vertical   = "align_vertical";
     static constexpr char const * sid_font             = "font";
@@ -68,6 +80,8 @@ struct WidgetDesc
     glm::vec2   max_size    = {MaxWidgetSize, MaxWidgetSize};
     ElementType type        = ElementType::Unknown;
     float       stretch     = 0.f;
+    glm::vec2   basis       = {};    // 0 - the minimal size
+    float       shrink      = 1.f;   // share of the missing space, times the basis
     bool        visible     = true;
     std::string region_name = {};
     std::string id_name     = {};
@@ -89,6 +103,10 @@ struct WindowDesc
     static constexpr char const * sid_widgets        = "widgets";
 
     static void LoadWindow(UIWindow & win, InFile & file_json);
+    static void LoadWindow(UIWindow & win, InputFileStream & json_stream);   // parsed while it is read
+
+private:
+    static void LoadWindow(UIWindow & win, boost::json::value const & jv);
 };
 
 struct UIImageManagerDesc
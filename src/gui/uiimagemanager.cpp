@@ -1,8 +1,29 @@
 #include "uiimagemanager.h"
 #include <algorithm>
+#include <iostream>
+#include <sstream>
 #include <stdexcept>
 
 #include "../render/vertex_buffer.h"
+#include "../fs/memory_stream.h"
+#include "utils/rect_packer.h"
+
+static void WriteString(OutputMemoryStream & stream, std::string const & str)
+{
+    std::uint32_t const length = static_cast<std::uint32_t>(str.size());
+    stream.write(length);
+    stream.write(reinterpret_cast<int8_t const *>(str.data()), length);
+}
+
+static bool ReadString(InputMemoryStream const & stream, std::string & str)
+{
+    std::uint32_t length = 0;
+    if(!stream.read(length) || length > stream.getRemainingDataSize())
+        return false;
+
+    str.resize(length);
+    return stream.read(str.data(), length);
+}
 
 void RegionDataOfUITexture::addBlock(VertexBuffer & vb, glm::vec2 & pos, glm::vec2 new_size) const
 {
@@ -82,7 +103,7 @@ UIImageGroup const & UIImageGroupManager::getImageGroup(std::string const & grou
 
 void UIImageGroupManager::resizeAtlas()
 {
-    AtlasTex new_atlas(m_atlas.getSize() * 2);
+    AtlasTex new_atlas(m_atlas.getSize() * 2, m_atlas.getOptions());
     m_atlas = std::move(new_atlas);
 
     for(auto & gr : m_groups)
@@ -91,47 +112,340 @@ void UIImageGroupManager::resizeAtlas()
     }
 }
 
-int32_t UIImageGroup::addImage(std::string name, std::string path, tex::ImageData const & image, int32_t left,
+bool UIImageGroupManager::reloadImageFiles(FileSystem const & fsys, std::vector<std::string> const & paths)
+{
+    // decode in parallel, only the files used by the groups
+    std::vector<std::pair<std::string, UIImageGroup::ImageFuture>> images;
+    for(auto const & path : paths)
+    {
+        bool const used = std::any_of(m_groups.begin(), m_groups.end(),
+                                      [&path](auto const & gr) { return gr.second->isUsingFile(path); });
+        if(used)
+            images.emplace_back(path, UIImageGroup::LoadImageAsync(fsys, path));
+    }
+
+    bool changed = false;
+    for(auto & [path, future] : images)
+    {
+        auto image = future.get();
+        if(!image)
+        {
+            std::stringstream ss;
+            ss << "UIImageGroupManager::reloadImageFiles File: " << path << " - unable to decode the image";
+            std::cout << ss.str() << std::endl;
+            continue;
+        }
+
+        for(auto & gr : m_groups)
+        {
+            if(gr.second->reloadImageFile(path, *image) < 0)
+            {
+                // the atlas is full, rebuild it with the current contents of all files
+                resizeAtlas();
+                return true;
+            }
+        }
+        changed = true;
+    }
+
+    return changed;
+}
+
+std::uint64_t UIImageGroupManager::GetBakeKey(BaseFile const & ui_res_file)
+{
+    // a fixed hash, std::hash may differ between the baker and the app builds
+    auto const *  data = reinterpret_cast<std::uint8_t const *>(ui_res_file.getData());
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < ui_res_file.getFileSize(); ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+void UIImageGroupManager::repackAtlas()
+{
+    struct PackedImage
+    {
+        glm::ivec4                           src;        // x, y, width, height in the current atlas
+        glm::ivec4                           dst = {};   // in the new one
+        std::vector<RegionDataOfUITexture *> regions;
+    };
+
+    // one pixel gap to the right and top neighbours like UIImageGroup::packImage(), and the gutter
+    int32_t const gutter  = m_atlas.getOptions().gutter;
+    int32_t const padding = 1 + 2 * gutter;
+
+    // a file used by several regions is stored once
+    std::vector<PackedImage> images;
+    int64_t                  area = 0;
+    for(auto & gr : m_groups)
+    {
+        for(auto & reg : gr.second->m_regions)
+        {
+            auto it = std::find_if(images.begin(), images.end(), [&reg](auto const & img) {
+                auto const & first = *img.regions.front();
+                return first.path == reg.path && first.getSize() == reg.getSize();
+            });
+            if(it == images.end())
+            {
+                images.push_back({glm::ivec4(reg.left_bottom, reg.getSize()), {}, {}});
+                area += static_cast<int64_t>(reg.getWidth() + padding) * (reg.getHeight() + padding);
+                it = images.end() - 1;
+            }
+            it->regions.push_back(&reg);
+        }
+    }
+
+    // the largest first
+    std::sort(images.begin(), images.end(), [](auto const & a, auto const & b) {
+        int32_t const a_max = std::max(a.src.z, a.src.w), b_max = std::max(b.src.z, b.src.w);
+        return a_max != b_max ? a_max > b_max : std::min(a.src.z, a.src.w) > std::min(b.src.z, b.src.w);
+    });
+
+    uint32_t size        = 64;
+    int32_t  used_height = 0;
+    while(static_cast<int64_t>(size - 2) * (size - 2) < area)
+        size *= 2;
+
+    for(;; size *= 2)
+    {
+        // the atlas border stays empty
+        RectPacker packer(size - 2, size - 2);
+        bool       packed = true;
+
+        for(auto & img : images)
+        {
+            glm::ivec4 const rect = packer.insert(img.src.z + padding, img.src.w + padding);
+            if(rect.x < 0)
+            {
+                packed = false;
+                break;
+            }
+            img.dst = glm::ivec4(rect.x + 1 + gutter, rect.y + 1 + gutter, img.src.z, img.src.w);
+        }
+
+        if(packed)
+        {
+            used_height = packer.getUsedHeight();
+            break;
+        }
+    }
+
+    AtlasTex    atlas(size, m_atlas.getOptions());
+    float const inv_size = 1.0f / static_cast<float>(size);
+    for(auto const & img : images)
+    {
+        // already premultiplied
+        if(img.src.z > 0 && img.src.w > 0)
+            atlas.copyRegion(m_atlas, glm::ivec2(img.src.x, img.src.y), img.dst);
+
+        for(auto * reg : img.regions)
+        {
+            reg->left_bottom = glm::ivec2(img.dst.x, img.dst.y);
+            reg->right_top   = glm::ivec2(img.dst.x + img.dst.z, img.dst.y + img.dst.w);
+            reg->tx0         = glm::vec2(reg->left_bottom) * inv_size;
+            reg->tx1         = glm::vec2(reg->right_top) * inv_size;
+        }
+    }
+
+    // images added at runtime are packed above the baked ones
+    atlas.setPackedHeight(used_height + 1);
+
+    atlas.getAtlasTextureState()->m_render_id = m_atlas.getAtlasTextureState()->m_render_id;
+    m_atlas                                   = std::move(atlas);
+}
+
+bool UIImageGroupManager::saveBaked(FileSystem & fsys, std::uint64_t bake_key,
+                                    std::string const & fname) const
+{
+    OutFile              file(fname);
+    OutputMemoryStream & stream     = file.getStream();
+    std::uint32_t const  num_groups = static_cast<std::uint32_t>(m_groups.size());
+
+    stream.write(BakedMagic);
+    stream.write(BakedVersion);
+    stream.write(bake_key);
+    m_atlas.writeToStream(stream);
+    stream.write(num_groups);
+
+    for(auto const & [name, group] : m_groups)
+    {
+        WriteString(stream, name);
+        group->writeToStream(stream);
+    }
+
+    return fsys.writeFile(file);
+}
+
+bool UIImageGroupManager::loadBaked(FileSystem & fsys, std::uint64_t bake_key, std::string const & fname)
+{
+    if(!fsys.isExist(fname))
+        return false;
+
+    auto file = fsys.getFile(fname);
+    if(!file)
+        return false;
+
+    auto const &  stream     = file->getStream();
+    std::uint32_t magic      = 0;
+    std::uint32_t version    = 0;
+    std::uint32_t num_groups = 0;
+    std::uint64_t key        = 0;
+
+    stream.read(magic);
+    stream.read(version);
+    stream.read(key);
+    if(magic != BakedMagic || version != BakedVersion || key != bake_key)
+    {
+        std::stringstream ss;
+        ss << "UIImageGroupManager::loadBaked File: " << fname
+           << " - baked from another ui_res.json, ignored";
+        std::cout << ss.str() << std::endl;
+        return false;
+    }
+
+    AtlasTex atlas;
+    if(!atlas.readFromStream(stream))
+        return false;
+
+    image_group_map groups;
+
+    stream.read(num_groups);
+    for(std::uint32_t i = 0; i < num_groups && stream; ++i)
+    {
+        std::string name;
+        auto        group = std::make_unique<UIImageGroup>(*this, fsys);
+        if(!ReadString(stream, name) || !group->readFromStream(stream, atlas.getSize()))
+            return false;
+
+        groups[name] = std::move(group);
+    }
+
+    if(!stream)
+        return false;
+
+    atlas.getAtlasTextureState()->m_render_id = m_atlas.getAtlasTextureState()->m_render_id;
+    m_atlas                                   = std::move(atlas);
+    m_groups                                  = std::move(groups);
+
+    return true;
+}
+
+int32_t UIImageGroup::addImage(std::string name, std::string path, UIImageFile const & image, int32_t left,
                                int32_t right, int32_t bottom, int32_t top)
+{
+    RegionDataOfUITexture tex_region;
+    if(!packImage(tex_region, image))
+    {
+        return -1;
+    }
+
+    tex_region.name   = std::move(name);
+    tex_region.path   = std::move(path);
+    tex_region.left   = left;
+    tex_region.right  = right;
+    tex_region.bottom = bottom;
+    tex_region.top    = top;
+
+    m_regions.push_back(tex_region);
+
+    return m_regions.size() - 1;
+}
+
+bool UIImageGroup::packImage(RegionDataOfUITexture & tex_region, UIImageFile const & image)
 {
     glm::ivec4 region;
     size_t     x, y, w, h;
-    size_t     size            = m_owner.getAtlas().getSize();
-    float      inv_size        = 1.0f / static_cast<float>(size);
-    int32_t    bytes_per_pixel = image.type == tex::ImageData::PixelType::pt_rgb ? 3 : 4;
+    size_t     size     = m_owner.getAtlas().getSize();
+    float      inv_size = 1.0f / static_cast<float>(size);
 
-    w      = image.width + 1;
-    h      = image.height + 1;
+    w      = image.header.width + 1;
+    h      = image.header.height + 1;
     region = m_owner.getAtlas().getRegion(w, h);
 
     if(region.x < 0)
     {
-        return -1;
+        return false;
     }
 
     w = w - 1;
     h = h - 1;
     x = region.x;
     y = region.y;
-    m_owner.getAtlas().setRegionBL(glm::ivec4(x, y, w, h), image.data.get(), image.width, bytes_per_pixel);
+    // decoded in place, the region stays empty if the file turns out to be damaged
+    AtlasTex & atlas = m_owner.getAtlas();
+    if(!tex::ReadImage(image.file, atlas.getRegionDestination(glm::ivec4(x, y, w, h))))
+    {
+        std::stringstream ss;
+        ss << "UIImageGroup::packImage File: " << image.file.getName() << " - unable to decode the image";
+        std::cout << ss.str() << std::endl;
+    }
+    atlas.commitRegion(glm::ivec4(x, y, w, h));
 
-    RegionDataOfUITexture tex_region;
-    tex_region.name        = std::move(name);
-    tex_region.path        = std::move(path);
     tex_region.left_bottom = glm::ivec2(x, y);
     tex_region.right_top   = glm::ivec2(x + w, y + h);
     tex_region.tx0.s       = x * inv_size;
     tex_region.tx0.t       = y * inv_size;
     tex_region.tx1.s       = (x + w) * inv_size;
     tex_region.tx1.t       = (y + h) * inv_size;
-    tex_region.left        = left;
-    tex_region.right       = right;
-    tex_region.bottom      = bottom;
-    tex_region.top         = top;
 
-    m_regions.push_back(tex_region);
+    return true;
+}
 
-    return m_regions.size() - 1;
+int32_t UIImageGroup::updateImage(std::string const & name, std::string const & path,
+                                  UIImageFile const & image, int32_t left, int32_t right, int32_t bottom,
+                                  int32_t top)
+{
+    auto it = std::find_if(begin(m_regions), end(m_regions),
+                           [&name](auto & region) { return name == region.name; });
+    if(it == m_regions.end())
+        return addImage(name, path, image, left, right, bottom, top);
+
+    RegionDataOfUITexture & reg = *it;
+    if(reg.getSize() == glm::ivec2(image.header.width, image.header.height))
+    {
+        AtlasTex &       atlas = m_owner.getAtlas();
+        glm::ivec4 const rect(reg.left_bottom, reg.getSize());
+        if(!tex::ReadImage(image.file, atlas.getRegionDestination(rect)))
+        {
+            std::stringstream ss;
+            ss << "UIImageGroup::updateImage File: " << path << " - unable to decode the image";
+            std::cout << ss.str() << std::endl;
+        }
+        atlas.commitRegion(rect);
+    }
+    else if(!packImage(reg, image))   // the old area stays unused until the atlas is rebuilt
+    {
+        return -1;
+    }
+
+    reg.path   = path;
+    reg.left   = left;
+    reg.right  = right;
+    reg.bottom = bottom;
+    reg.top    = top;
+
+    return static_cast<int32_t>(it - m_regions.begin());
+}
+
+int32_t UIImageGroup::reloadImageFile(std::string const & path, UIImageFile const & image)
+{
+    int32_t num_updated = 0;
+    for(size_t i = 0; i < m_regions.size(); ++i)
+    {
+        if(m_regions[i].path != path)
+            continue;
+
+        auto const reg = m_regions[i];
+        if(updateImage(reg.name, reg.path, image, reg.left, reg.right, reg.bottom, reg.top) < 0)
+            return -1;
+        ++num_updated;
+    }
+
+    return num_updated;
 }
 
 void UIImageGroup::bindRegionAsRenderTarget(RendererBase & render, RegionDataOfUITexture const & region) const
@@ -152,22 +466,132 @@ RegionDataOfUITexture const * UIImageGroup::getImageRegion(std::string const & n
     return nullptr;
 }
 
+bool UIImageGroup::setMargins(std::string const & name, int32_t left, int32_t right, int32_t bottom,
+                              int32_t top)
+{
+    auto it = std::find_if(begin(m_regions), end(m_regions),
+                           [&name](auto & region) { return name == region.name; });
+    if(it == m_regions.end())
+        return false;
+
+    it->left   = left;
+    it->right  = right;
+    it->bottom = bottom;
+    it->top    = top;
+
+    return true;
+}
+
+bool UIImageGroup::isUsingFile(std::string const & path) const
+{
+    return std::any_of(begin(m_regions), end(m_regions),
+                       [&path](auto & region) { return path == region.path; });
+}
+
+void UIImageGroup::writeToStream(OutputMemoryStream & stream) const
+{
+    std::uint32_t const num_regions = static_cast<std::uint32_t>(m_regions.size());
+
+    stream.write(num_regions);
+    for(auto const & reg : m_regions)
+    {
+        stream.write(reg.left_bottom);
+        stream.write(reg.right_top);
+        stream.write(reg.left);
+        stream.write(reg.right);
+        stream.write(reg.bottom);
+        stream.write(reg.top);
+        WriteString(stream, reg.name);
+        WriteString(stream, reg.path);
+
+        std::uint64_t size  = 0;
+        std::uint64_t stamp = 0;
+        m_fsys.getFileStamp(reg.path, size, stamp);
+        stream.write(size);
+        stream.write(stamp);
+    }
+}
+
+bool UIImageGroup::readFromStream(InputMemoryStream const & stream, uint32_t atlas_size)
+{
+    float const   inv_size    = 1.0f / static_cast<float>(atlas_size);
+    std::uint32_t num_regions = 0;
+
+    std::vector<RegionDataOfUITexture> regions;
+
+    stream.read(num_regions);
+    for(std::uint32_t i = 0; i < num_regions && stream; ++i)
+    {
+        RegionDataOfUITexture reg;
+        stream.read(reg.left_bottom);
+        stream.read(reg.right_top);
+        stream.read(reg.left);
+        stream.read(reg.right);
+        stream.read(reg.bottom);
+        stream.read(reg.top);
+        if(!ReadString(stream, reg.name) || !ReadString(stream, reg.path))
+            return false;
+
+        // the pixels of an image file edited after the bake are stale
+        std::uint64_t baked_size = 0, baked_stamp = 0, size = 0, stamp = 0;
+        stream.read(baked_size);
+        stream.read(baked_stamp);
+        if(!m_fsys.getFileStamp(reg.path, size, stamp) || size != baked_size || stamp != baked_stamp)
+        {
+            std::stringstream ss;
+            ss << "UIImageGroup::readFromStream File: " << reg.path << " - changed since the bake";
+            std::cout << ss.str() << std::endl;
+            return false;
+        }
+
+        reg.tx0 = glm::vec2(reg.left_bottom) * inv_size;
+        reg.tx1 = glm::vec2(reg.right_top) * inv_size;
+        regions.push_back(std::move(reg));
+    }
+
+    if(!stream)
+        return false;
+
+    m_regions = std::move(regions);
+    return true;
+}
+
+UIImageGroup::ImageFuture UIImageGroup::LoadImageAsync(FileSystem const & fsys, std::string path)
+{
+    return fsys.runAsync([&fsys, path = std::move(path)]() {
+        std::optional<UIImageFile> result;
+        try
+        {
+            tex::ImageHeader header;
+            if(auto file = fsys.getFile(path); file && tex::ReadImageHeader(*file, header))
+                result = UIImageFile{std::move(*file), header};
+        }
+        catch(std::exception const & e)
+        {
+            std::cerr << "UIImageGroup::LoadImageAsync File: " << path << " - " << e.what() << std::endl;
+        }
+        return result;
+    });
+}
+
 void UIImageGroup::reloadImages()
 {
     auto regions = std::move(m_regions);
     m_regions.clear();
 
-    for(auto & reg : regions)
+    // decode in parallel, pack into the atlas in the original order
+    std::vector<ImageFuture> images;
+    images.reserve(regions.size());
+    for(auto const & reg : regions)
+        images.push_back(LoadImageAsync(m_fsys, reg.path));
+
+    for(size_t i = 0; i < regions.size(); ++i)
     {
-        tex::ImageData image;
-        if(auto file = m_fsys.getFile(reg.path); file)
-        {
-            if(!tex::ReadTGA(*file, image))
-                continue;
-        }
-        else
+        auto const & reg   = regions[i];
+        auto         image = images[i].get();
+        if(!image)
             continue;
         // we don't care about the oversize atlas error in this function
-        addImage(reg.name, reg.path, image, reg.left, reg.right, reg.bottom, reg.top);
+        addImage(reg.name, reg.path, *image, reg.left, reg.right, reg.bottom, reg.top);
     }
 }
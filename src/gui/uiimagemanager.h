@@ -13,6 +13,8 @@
 class RendererBase;
 class UIImageGroupManager;
 class VertexBuffer;
+class InputMemoryStream;
+class OutputMemoryStream;
 
 //                      (right_top, tx1)
 //  --------------------
@@ -44,6 +46,13 @@ struct RegionDataOfUITexture
     void addBlock(VertexBuffer & vb, glm::vec2 & pos, glm::vec2 new_size) const;
 };
 
+// image file read by UIImageGroup::LoadImageAsync(), the pixels are decoded straight into its atlas region
+struct UIImageFile
+{
+    InFile           file;
+    tex::ImageHeader header;
+};
+
 class UIImageGroup   // a group of images of the same style
 {
 public:
@@ -51,34 +60,76 @@ public:
 
     UIImageGroupManager & getOwner() { return m_owner; }
 
-    int32_t addImage(std::string name, std::string path, tex::ImageData const & image, int32_t left,
+    int32_t addImage(std::string name, std::string path, UIImageFile const & image, int32_t left,
                      int32_t right, int32_t bottom, int32_t top);
     void    bindRegionAsRenderTarget(RendererBase & render, RegionDataOfUITexture const & region) const;
 
     RegionDataOfUITexture const * getImageRegion(std::string const & name) const;
+    bool                          isUsingFile(std::string const & path) const;
 
     void reloadImages();
+    // Hot reload: the pixels of the image are replaced in place when its size is unchanged, otherwise it
+    // gets a new region. A missing image is added. Returns -1 if the atlas is full, like addImage()
+    int32_t updateImage(std::string const & name, std::string const & path, UIImageFile const & image,
+                        int32_t left, int32_t right, int32_t bottom, int32_t top);
+    int32_t reloadImageFile(std::string const & path, UIImageFile const & image);   // all its regions
+    bool    setMargins(std::string const & name, int32_t left, int32_t right, int32_t bottom, int32_t top);
+
+    // reads the file and its header on the worker pool of the file system, addImage() decodes the pixels
+    using ImageFuture = std::future<std::optional<UIImageFile>>;
+    static ImageFuture LoadImageAsync(FileSystem const & fsys, std::string path);
+
+    // Regions of the baked atlas, the texture coordinates are computed from the atlas size. The size and
+    // modification stamp of every image file are stored, reading fails if one of the files was changed.
+    void writeToStream(OutputMemoryStream & stream) const;
+    bool readFromStream(InputMemoryStream const & stream, uint32_t atlas_size);
 
 private:
+    bool packImage(RegionDataOfUITexture & region, UIImageFile const & image);   // new atlas region
+
     UIImageGroupManager &              m_owner;
     FileSystem &                       m_fsys;
     std::vector<RegionDataOfUITexture> m_regions;
+
+    friend class UIImageGroupManager;
 };
 
 class UIImageGroupManager
 {
 public:
+    // premultiplied alpha, gutters and mips: one atlas serves the UI drawn at any scale down to 1/4
+    static constexpr AtlasTex::Options AtlasOptions = {4, 3, true};
+
     UIImageGroupManager() = default;
 
     UIImageGroup const & getImageGroup(std::string const & group_name) const;
 
     AtlasTex & getAtlas() { return m_atlas; }
     void       resizeAtlas();
+    // re-decodes the changed files used by the groups and patches their atlas regions, returns true if
+    // any region was changed; the region pointers of the widgets have to be refreshed then
+    bool reloadImageFiles(FileSystem const & fsys, std::vector<std::string> const & paths);
+
+    // Offline baked atlas, written by the atlas_baker tool: the pixels and the regions of all groups.
+    // loadBaked() replaces the groups, so it goes before UIImageManagerDesc::ParseUIRes(), which doesn't
+    // pack or decode the images it holds again. A file baked from another ui_res.json, or with image files
+    // changed since the bake, is rejected.
+    static constexpr char const * BakedAtlasFileName = "ui_atlas.bin";
+
+    static std::uint64_t GetBakeKey(BaseFile const & ui_res_file);   // FNV-1a of the ui_res.json bytes
+
+    void repackAtlas();   // all regions again with RectPacker into the smallest atlas, shared files once
+    bool saveBaked(FileSystem & fsys, std::uint64_t bake_key,
+                   std::string const & fname = BakedAtlasFileName) const;
+    bool loadBaked(FileSystem & fsys, std::uint64_t bake_key, std::string const & fname = BakedAtlasFileName);
 
 private:
     using image_group_map = std::map<std::string, std::unique_ptr<UIImageGroup>>;
 
-    AtlasTex        m_atlas;   // one tex atlas for all loaded UI elements
+    static constexpr std::uint32_t BakedMagic   = 0x41495558;   // "XUIA"
+    static constexpr std::uint32_t BakedVersion = 3;
+
+    AtlasTex        m_atlas = AtlasTex(64, AtlasOptions);   // one tex atlas for all loaded UI elements
     image_group_map m_groups;
 
     friend struct UIImageManagerDesc;
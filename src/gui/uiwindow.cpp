@@ -1,32 +1,56 @@
 #include "uiwindow.h"
 #include "ui.h"
+#include "utils/chain.h"
 
 UIWindow::UIWindow(UI & owner, std::string const & image_group) : m_owner(owner)
 {
     m_images = &m_owner.m_ui_image_atlas.getImageGroup(image_group);
 }
 
-void UIWindow::fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const
+UIWindow::~UIWindow() = default;
+
+void UIWindow::fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                           Rect2D const & clip) const
 {
-    if(!m_visible)
+    Rect2D const bounds = getBounds();
+    if(!m_visible || !clip.intersects(bounds))
         return;
 
+    Rect2D const inner = Rect2D::Intersect(clip, bounds);
     if(m_background)
-        m_background->fillBuffers(background, text);
+        m_background->fillBuffers(background, text, inner);
 
     if(m_root)
-        m_root->fillBuffers(background, text);
+        m_root->fillBuffers(background, text, inner);
+}
+
+void UIWindow::sizeUpdated()
+{
+    m_size_updated = true;
+    if(m_layout)
+        m_layout->clear();
+    m_resized_widgets.clear();
+}
+
+void UIWindow::widgetSizeUpdated(Widget const * widget)
+{
+    m_size_updated = true;
+    if(m_layout && m_layout->top_string != nullptr)
+        m_resized_widgets.push_back(widget);
+}
+
+void UIWindow::layout()
+{
+    m_owner.fitWidgets(this);
+    move(m_pos);
+
+    m_size_updated = false;
 }
 
 void UIWindow::update(float time, bool check_cursor)
 {
     if(m_size_updated)
-    {
-        m_owner.fitWidgets(this);
-        move(m_pos);
-
-        m_size_updated = false;
-    }
+        layout();
 
     if(!m_visible)
         return;
@@ -59,6 +83,16 @@ void UIWindow::move(glm::vec2 const & new_origin)
     }
 }
 
+void UIWindow::refreshRegions()
+{
+    if(m_root)
+        m_root->refreshRegion();
+    if(m_background)
+        m_background->refreshRegion();
+
+    sizeUpdated();
+}
+
 Widget * UIWindow::getRootWidget() const
 {
     if(m_root)
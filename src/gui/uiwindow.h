@@ -8,17 +8,21 @@
 
 class UI;
 class UIImageGroup;
+struct WindowLayout;
 
 class UIWindow
 {
 public:
     UIWindow(UI & owner, std::string const & image_group);
+    ~UIWindow();
 
     UI &                 getOwner() { return m_owner; }
     bool                 isImageGroupExist() const { return m_images != nullptr; }
     UIImageGroup const & getImageGroup() const { return *m_images; }
 
-    void fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const;
+    // clip: the screen rect, a window outside it is skipped
+    void fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                     Rect2D const & clip) const;
     void update(float time, bool check_cursor);
 
     void        setCaption(std::string caption) { m_caption = std::move(caption); }
@@ -27,9 +31,17 @@ public:
     void show() { m_visible = true; }
     void hide() { m_visible = false; }
     bool visible() const { return m_visible; }
-    void sizeUpdated() { m_size_updated = true; }
+    void sizeUpdated();                                // the widget tree was changed, full layout
+    void widgetSizeUpdated(Widget const * widget);   // only the chains of the widget are solved again
+    bool needsLayout() const { return m_size_updated; }
+    void layout();   // called by update(), or by UI::update() on the worker pool for the dirty windows
 
     void move(glm::vec2 const & new_origin);
+    void refreshRegions();   // after a hot reload of the images
+
+    // json file of the window, for the hot reload
+    std::string const & getSourcePath() const { return m_source_path; }
+    void                setSourcePath(std::string path) { m_source_path = std::move(path); }
 
     Rect2D    getRect() const { return m_rect; }
     void      setRect(Rect2D const & rect) { m_rect = rect; }
@@ -37,6 +49,7 @@ public:
     float     getSpacing() const { return m_spacing; }
     glm::vec2 size() const { return m_rect.m_size; }
     glm::vec2 pos() const { return m_pos; }
+    Rect2D    getBounds() const { return {m_pos, m_rect.m_size}; }   // on the screen
 
     Widget * getRootWidget() const;
     Widget * getBackgroundWidget() const;
@@ -57,6 +70,7 @@ public:
 
 private:
     std::string m_caption;
+    std::string m_source_path;
     float       m_spacing      = 0.f;
     bool        m_visible      = false;
     bool        m_draw_caption = false;
@@ -73,7 +87,11 @@ private:
 
     std::vector<std::function<void(void)>> m_callbacks_queue;
 
+    std::unique_ptr<WindowLayout> m_layout;            // chain tree kept between the layout passes
+    std::vector<Widget const *>   m_resized_widgets;   // since the last pass
+
     friend struct WindowDesc;
+    friend class ChainsPacker;
 };
 
 #endif
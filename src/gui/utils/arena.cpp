@@ -0,0 +1,44 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+
+void * Arena::allocate(std::size_t size, std::size_t align)
+{
+    while(m_current < m_blocks.size())
+    {
+        auto &         block  = m_blocks[m_current];
+        std::uintptr_t base   = reinterpret_cast<std::uintptr_t>(block.data.get());
+        std::uintptr_t offset = ((base + m_offset + align - 1) & ~(align - 1)) - base;
+        if(offset + size <= block.size)
+        {
+            m_offset = offset + size;
+            return block.data.get() + offset;
+        }
+
+        // the rest of the block is wasted until the next reset()
+        m_current++;
+        m_offset = 0;
+    }
+
+    Block block;
+    block.size = std::max(m_block_size, size + align);
+    block.data = std::make_unique<std::byte[]>(block.size);
+    m_blocks.push_back(std::move(block));
+
+    return allocate(size, align);
+}
+
+void Arena::reset()
+{
+    m_current = 0;
+    m_offset  = 0;
+}
+
+std::size_t Arena::getCapacity() const
+{
+    std::size_t capacity = 0;
+    for(auto const & block : m_blocks)
+        capacity += block.size;
+
+    return capacity;
+}
@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Monotonic allocator: objects are placed one after another in large blocks and are only freed all at
+// once by reset(), which keeps the blocks, so a rebuild of the same size allocates nothing. The objects
+// are not destroyed by the arena, their owner has to call the destructors before reset().
+class Arena
+{
+public:
+    static constexpr std::size_t DefaultBlockSize = 16 * 1024;
+
+    explicit Arena(std::size_t block_size = DefaultBlockSize) : m_block_size(block_size) {}
+    Arena(Arena const &)             = delete;
+    Arena & operator=(Arena const &) = delete;
+
+    void * allocate(std::size_t size, std::size_t align);
+
+    template<class T, class... Args>
+    T * create(Args &&... args)
+    {
+        return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    void        reset();
+    std::size_t getCapacity() const;   // bytes in all blocks
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t                  size = 0;
+    };
+
+    std::vector<Block> m_blocks;
+    std::size_t        m_block_size;
+    std::size_t        m_current = 0;   // block the next object goes to
+    std::size_t        m_offset  = 0;   // in the current block
+};
+
+#endif   // ARENA_H
@@ -1,6 +1,8 @@
 #include "atlastex.h"
 #include "../../res/imagedata.h"
+#include "../../res/pixel_ops.h"
 #include "../../render/renderer.h"
+#include "../../fs/memory_stream.h"
 #include <cassert>
 #include <cstring>
 
@@ -9,7 +11,16 @@ constexpr bool IsPowerOfTwo(uint32_t x)
     return x && ((x & (x - 1)) == 0);
 }
 
-AtlasTex::AtlasTex(uint32_t size) : m_size{size}
+// the texels of the next mip level covering rect (x, y, width, height)
+static glm::ivec4 MipRect(glm::ivec4 rect)
+{
+    int32_t const x = rect.x / 2, y = rect.y / 2;
+    return {x, y, (rect.x + rect.z + 1) / 2 - x, (rect.y + rect.w + 1) / 2 - y};
+}
+
+AtlasTex::AtlasTex(uint32_t size) : AtlasTex(size, Options{}) {}
+
+AtlasTex::AtlasTex(uint32_t size, Options options) : m_size{size}, m_options{options}
 {
     assert(m_size != 0);
     assert(IsPowerOfTwo(m_size));
@@ -26,10 +37,31 @@ AtlasTex::AtlasTex(uint32_t size) : m_size{size}
     m_atlas_tex.m_height      = m_size;
     m_atlas_tex.m_gen_mips    = false;
     m_atlas_tex.m_sampler.max = ImageState::Filter::LINEAR;
-    m_atlas_tex.m_sampler.min = ImageState::Filter::LINEAR;
     m_atlas_tex.m_sampler.r   = ImageState::Wrap::CLAMP_TO_EDGE;
     m_atlas_tex.m_sampler.s   = ImageState::Wrap::CLAMP_TO_EDGE;
     m_atlas_tex.m_sampler.t   = ImageState::Wrap::CLAMP_TO_EDGE;
+
+    applyOptions();
+    markAllDirty();
+}
+
+void AtlasTex::applyOptions()
+{
+    assert(m_options.gutter >= 0 && m_options.mip_levels >= 1);
+
+    // down to 1x1 at most
+    while((m_size >> (m_options.mip_levels - 1)) == 0)
+        --m_options.mip_levels;
+
+    m_mips.resize(m_options.mip_levels - 1);
+    for(uint32_t level = 1; level < m_options.mip_levels; ++level)
+    {
+        size_t const size = m_size >> level;
+        m_mips[level - 1].assign(size * size * 4, 0);
+    }
+
+    m_atlas_tex.m_sampler.min =
+        m_options.mip_levels > 1 ? ImageState::Filter::LINEAR_MIPMAP_LINEAR : ImageState::Filter::LINEAR;
 }
 
 void AtlasTex::clear()
@@ -41,6 +73,32 @@ void AtlasTex::clear()
     m_nodes.emplace_back(1, 1, m_size - 2);
     m_data.resize(m_size * m_size * 4);
     std::memset(m_data.data(), 0, m_size * m_size * 4);
+    applyOptions();
+    markAllDirty();
+}
+
+void AtlasTex::markDirty(glm::ivec4 rect)
+{
+    if(!m_dirty)
+    {
+        m_dirty      = true;
+        m_dirty_rect = rect;
+        return;
+    }
+
+    glm::ivec2 const dirty_bl(m_dirty_rect.x, m_dirty_rect.y);
+    glm::ivec2 const dirty_tr = dirty_bl + glm::ivec2(m_dirty_rect.z, m_dirty_rect.w);
+
+    glm::ivec2 const bl = glm::min(dirty_bl, glm::ivec2(rect.x, rect.y));
+    glm::ivec2 const tr = glm::max(dirty_tr, glm::ivec2(rect.x + rect.z, rect.y + rect.w));
+
+    m_dirty_rect = {bl.x, bl.y, tr.x - bl.x, tr.y - bl.y};
+}
+
+void AtlasTex::markAllDirty()
+{
+    m_dirty      = true;
+    m_dirty_rect = {0, 0, static_cast<int32_t>(m_size), static_cast<int32_t>(m_size)};
 }
 
 int32_t AtlasTex::atlasFit(uint32_t index, uint32_t width, uint32_t height)
@@ -99,6 +157,16 @@ void AtlasTex::atlasMerge()
 }
 
 glm::ivec4 AtlasTex::getRegion(uint32_t width, uint32_t height)
+{
+    uint32_t const   gutter = static_cast<uint32_t>(m_options.gutter);
+    glm::ivec4 const region = allocRegion(width + 2 * gutter, height + 2 * gutter);
+    if(region.x < 0)
+        return region;
+
+    return glm::ivec4(region.x + gutter, region.y + gutter, width, height);
+}
+
+glm::ivec4 AtlasTex::allocRegion(uint32_t width, uint32_t height)
 {
     int32_t     y, best_height, best_width, best_index;
     glm::ivec3 *node, *prev;
@@ -184,31 +252,14 @@ void AtlasTex::setRegionTL(glm::ivec4 reg, unsigned char const * data, int32_t s
     assert(reg.y < (static_cast<int32_t>(m_size) - 1));
     assert((reg.y + reg.w) <= (static_cast<int32_t>(m_size) - 1));
 
-    int32_t       charsize = sizeof(unsigned char);
-    int32_t       y        = reg.y + reg.w;
-    unsigned char bytes[4] = {0};   // 4 - alpha
+    size_t const row_size = m_size * 4;
 
-    for(int32_t i = 0; i < reg.w; ++i)
-    {
-        for(int32_t j = 0; j < reg.z; ++j)
-        {
-            uint32_t dst_shift = ((y - i) * m_size + reg.x + j) * charsize * 4;
-            uint32_t src_shift = (i * stride + j) * bytes_ppx * charsize;
-
-            bytes[0] = data[src_shift + 0];
-            bytes[1] = data[src_shift + 1];
-            bytes[2] = data[src_shift + 2];
-            if(bytes_ppx == 3)
-                bytes[3] = std::min((bytes[0] + bytes[1] + bytes[2]) / 3, 255);
-            else
-                bytes[3] = data[src_shift + 3];
+    markDirty({reg.x, reg.y + 1, reg.z, reg.w});
 
-            m_data[dst_shift + 0] = bytes[0];
-            m_data[dst_shift + 1] = bytes[1];
-            m_data[dst_shift + 2] = bytes[2];
-            m_data[dst_shift + 3] = bytes[3];
-        }
-    }
+    // top-left origin source, rows go from the top of the region down
+    PixelOps::BlitToRGBA(data, stride * bytes_ppx, bytes_ppx, &m_data[(reg.y + reg.w) * row_size + reg.x * 4],
+                         -static_cast<ptrdiff_t>(row_size), reg.z, reg.w);
+    commitRegion({reg.x, reg.y + 1, reg.z, reg.w});
 }
 
 void AtlasTex::setRegionBL(glm::ivec4 reg, unsigned char const * data, int32_t stride, int32_t bytes_ppx)
@@ -220,31 +271,130 @@ void AtlasTex::setRegionBL(glm::ivec4 reg, unsigned char const * data, int32_t s
     assert(reg.y < (static_cast<int32_t>(m_size) - 1));
     assert((reg.y + reg.w) <= (static_cast<int32_t>(m_size) - 1));
 
-    uint32_t charsize = sizeof(char);
+    size_t const row_size = m_size * 4;
+
+    markDirty(reg);
+
+    PixelOps::BlitToRGBA(data, stride * bytes_ppx, bytes_ppx, &m_data[reg.y * row_size + reg.x * 4],
+                         static_cast<ptrdiff_t>(row_size), reg.z, reg.w);
+    commitRegion(reg);
+}
+
+tex::ImageDestination AtlasTex::getRegionDestination(glm::ivec4 reg)
+{
+    assert(reg.x > 0);
+    assert(reg.y > 0);
+    assert((reg.x + reg.z) <= (static_cast<int32_t>(m_size) - 1));
+    assert((reg.y + reg.w) <= (static_cast<int32_t>(m_size) - 1));
+
+    size_t const row_size = m_size * 4;
 
-    for(int32_t i = 0; i < reg.w; ++i)
+    markDirty(reg);
+
+    tex::ImageDestination dst;
+    dst.data           = &m_data[reg.y * row_size + reg.x * 4];
+    dst.stride         = static_cast<ptrdiff_t>(row_size);
+    dst.coverage_alpha = true;
+
+    return dst;
+}
+
+void AtlasTex::commitRegion(glm::ivec4 reg)
+{
+    if(m_options.premultiplied_alpha)
     {
-        unsigned char bytes[4] = {0};   // 4 - alpha
+        size_t const row_size = m_size * 4;
+        for(int32_t y = reg.y; y < reg.y + reg.w; ++y)
+            PixelOps::PremultiplyAlpha(&m_data[y * row_size + reg.x * 4], reg.z);
+    }
 
-        for(int32_t j = 0; j < reg.z; ++j)
-        {
-            uint32_t dst_shift = ((reg.y + i) * m_size + reg.x + j) * charsize * 4;
-            uint32_t src_shift = (i * stride + j) * bytes_ppx * charsize;
-
-            bytes[0] = data[src_shift + 0];
-            bytes[1] = data[src_shift + 1];
-            bytes[2] = data[src_shift + 2];
-            if(bytes_ppx == 3)
-                bytes[3] = std::min((bytes[0] + bytes[1] + bytes[2]) / 3, 255);
-            else
-                bytes[3] = data[src_shift + 3];
+    extrudeGutter(reg);
+}
 
-            m_data[dst_shift + 0] = bytes[0];
-            m_data[dst_shift + 1] = bytes[1];
-            m_data[dst_shift + 2] = bytes[2];
-            m_data[dst_shift + 3] = bytes[3];
+void AtlasTex::copyRegion(AtlasTex const & src, glm::ivec2 src_pos, glm::ivec4 reg)
+{
+    assert(src.m_options.premultiplied_alpha == m_options.premultiplied_alpha);
+    assert((reg.x + reg.z) <= (static_cast<int32_t>(m_size) - 1));
+    assert((reg.y + reg.w) <= (static_cast<int32_t>(m_size) - 1));
+
+    size_t const row_size     = m_size * 4;
+    size_t const src_row_size = src.m_size * 4;
+
+    for(int32_t y = 0; y < reg.w; ++y)
+    {
+        std::memcpy(&m_data[(reg.y + y) * row_size + reg.x * 4],
+                    &src.m_data[(src_pos.y + y) * src_row_size + src_pos.x * 4], reg.z * 4);
+    }
+
+    markDirty(reg);
+    extrudeGutter(reg);
+}
+
+void AtlasTex::extrudeGutter(glm::ivec4 reg)
+{
+    int32_t const gutter = m_options.gutter;
+    if(gutter == 0 || reg.z <= 0 || reg.w <= 0)
+        return;
+
+    assert(reg.x - gutter >= 0 && reg.y - gutter >= 0);
+    assert(reg.x + reg.z + gutter <= static_cast<int32_t>(m_size));
+    assert(reg.y + reg.w + gutter <= static_cast<int32_t>(m_size));
+
+    size_t const row_size = m_size * 4;
+
+    // the first and the last pixel of each row to the left and right
+    for(int32_t y = reg.y; y < reg.y + reg.w; ++y)
+    {
+        unsigned char * row = &m_data[y * row_size];
+        for(int32_t i = 1; i <= gutter; ++i)
+        {
+            std::memcpy(row + (reg.x - i) * 4, row + reg.x * 4, 4);
+            std::memcpy(row + (reg.x + reg.z - 1 + i) * 4, row + (reg.x + reg.z - 1) * 4, 4);
         }
     }
+
+    // then the bottom and the top row with the corners
+    size_t const          width  = static_cast<size_t>(reg.z + 2 * gutter) * 4;
+    unsigned char const * bottom = &m_data[reg.y * row_size + (reg.x - gutter) * 4];
+    unsigned char const * top    = &m_data[(reg.y + reg.w - 1) * row_size + (reg.x - gutter) * 4];
+    for(int32_t i = 1; i <= gutter; ++i)
+    {
+        std::memcpy(&m_data[(reg.y - i) * row_size + (reg.x - gutter) * 4], bottom, width);
+        std::memcpy(&m_data[(reg.y + reg.w - 1 + i) * row_size + (reg.x - gutter) * 4], top, width);
+    }
+
+    markDirty({reg.x - gutter, reg.y - gutter, reg.z + 2 * gutter, reg.w + 2 * gutter});
+}
+
+void AtlasTex::updateMips(glm::ivec4 rect)
+{
+    if(rect.z <= 0 || rect.w <= 0)
+        return;
+
+    unsigned char const * src      = m_data.data();
+    uint32_t              src_size = m_size;
+    for(auto & level : m_mips)
+    {
+        uint32_t const   size = src_size / 2;
+        glm::ivec4 const next = MipRect(rect);
+
+        size_t const src_offset = (2 * static_cast<size_t>(next.y) * src_size + 2 * next.x) * 4;
+        size_t const dst_offset = (static_cast<size_t>(next.y) * size + next.x) * 4;
+        PixelOps::DownsampleBox(src + src_offset, src_size * 4, level.data() + dst_offset, size * 4, next.z,
+                                next.w);
+
+        src      = level.data();
+        src_size = size;
+        rect     = next;
+    }
+}
+
+void AtlasTex::setPackedHeight(int32_t height)
+{
+    assert(height > 0 && height < static_cast<int32_t>(m_size));
+
+    m_nodes.clear();
+    m_nodes.emplace_back(1, height, m_size - 2);
 }
 
 void AtlasTex::writeAtlasToTGA(std::string const & name)
@@ -260,6 +410,49 @@ void AtlasTex::writeAtlasToTGA(std::string const & name)
     tex::WriteTGA(name, image);
 }
 
+void AtlasTex::writeToStream(OutputMemoryStream & stream) const
+{
+    std::uint32_t const num_nodes     = static_cast<std::uint32_t>(m_nodes.size());
+    std::uint32_t const premultiplied = m_options.premultiplied_alpha ? 1 : 0;
+
+    stream.write(m_size);
+    stream.write(m_options.gutter);
+    stream.write(m_options.mip_levels);
+    stream.write(premultiplied);
+    stream.write(num_nodes);
+    stream.write(reinterpret_cast<int8_t const *>(m_nodes.data()), num_nodes * sizeof(glm::ivec3));
+    stream.write(reinterpret_cast<int8_t const *>(m_data.data()), m_data.size());
+}
+
+bool AtlasTex::readFromStream(InputMemoryStream const & stream)
+{
+    std::uint32_t size = 0, num_nodes = 0, premultiplied = 0;
+    Options       options;
+
+    stream.read(size);
+    stream.read(options.gutter);
+    stream.read(options.mip_levels);
+    stream.read(premultiplied);
+    stream.read(num_nodes);
+    options.premultiplied_alpha = premultiplied != 0;
+
+    size_t const data_size = static_cast<size_t>(size) * size * 4;
+    if(!stream || !IsPowerOfTwo(size) || options.gutter < 0 || options.mip_levels == 0
+       || num_nodes * sizeof(glm::ivec3) + data_size > stream.getRemainingDataSize())
+        return false;
+
+    m_size    = size;
+    m_options = options;
+    m_nodes.resize(num_nodes);
+    m_data.resize(data_size);
+    stream.read(m_nodes.data(), num_nodes * sizeof(glm::ivec3));
+    stream.read(m_data.data(), data_size);
+    applyOptions();
+    markAllDirty();
+
+    return true;
+}
+
 void AtlasTex::UploadAtlasTexture(RendererBase const & render, AtlasTex & atlas)
 {
     if(atlas.m_atlas_tex.m_render_id == 0)
@@ -267,17 +460,55 @@ void AtlasTex::UploadAtlasTexture(RendererBase const & render, AtlasTex & atlas)
         render.createTexture(atlas.m_atlas_tex);
     }
 
-    tex::ImageData tex_data;
-    tex_data.type      = tex::ImageData::PixelType::pt_rgba;
-    tex_data.width     = atlas.getSize();
-    tex_data.height    = atlas.getSize();
-    tex_data.data_size = atlas.m_data.size();
+    glm::ivec4 const rect = atlas.m_dirty_rect;
+    if(atlas.m_atlas_tex.m_committed && (rect.z < static_cast<int32_t>(atlas.getSize())
+                                         || rect.w < static_cast<int32_t>(atlas.getSize())))
+    {
+        // only the patched regions changed since the last upload, and the texels of the mips below them
+        if(rect.z > 0 && rect.w > 0)
+        {
+            atlas.updateMips(rect);
+
+            glm::ivec4 level_rect = rect;
+            for(uint32_t level = 0; level < atlas.m_options.mip_levels; ++level)
+            {
+                auto const &   data   = level == 0 ? atlas.m_data : atlas.m_mips[level - 1];
+                uint32_t const size   = atlas.getSize() >> level;
+                size_t const   offset = (static_cast<size_t>(level_rect.y) * size + level_rect.x) * 4;
+
+                render.uploadTextureRegion(atlas.m_atlas_tex, level_rect, data.data() + offset, size, level);
+                level_rect = MipRect(level_rect);
+            }
+        }
 
+        atlas.m_dirty = false;
+        return;
+    }
+
+    atlas.updateMips(glm::ivec4(0, 0, atlas.getSize(), atlas.getSize()));
+
+    tex::ImageData tex_data;
+    tex_data.type       = tex::ImageData::PixelType::pt_rgba;
+    tex_data.width      = atlas.getSize();
+    tex_data.height     = atlas.getSize();
+    tex_data.mip_levels = atlas.m_options.mip_levels;
+    tex_data.data_size  = atlas.m_data.size();
+    for(auto const & level : atlas.m_mips)
+        tex_data.data_size += level.size();
+
+    // the levels one after another
     auto atlas_data = std::make_unique<uint8_t[]>(tex_data.data_size);
-    std::memcpy(atlas_data.get(), atlas.m_data.data(), tex_data.data_size);
+    std::memcpy(atlas_data.get(), atlas.m_data.data(), atlas.m_data.size());
+    size_t offset = atlas.m_data.size();
+    for(auto const & level : atlas.m_mips)
+    {
+        std::memcpy(atlas_data.get() + offset, level.data(), level.size());
+        offset += level.size();
+    }
     tex_data.data = std::move(atlas_data);
 
     render.uploadTextureData(atlas.m_atlas_tex, tex_data);
+    atlas.m_dirty = false;
 }
 
 void AtlasTex::DeleteAtlasTexture(RendererBase const & render, AtlasTex & atlas)
@@ -5,27 +5,58 @@
 #include <string>
 #include <vector>
 #include "../../render/texture.h"
+#include "../../res/imagedata.h"
 
 class RendererBase;
+class InputMemoryStream;
+class OutputMemoryStream;
 
 class AtlasTex
 {
 public:
+    // Kept when the atlas is grown or cached. gutter: pixels around every region, filled with its edge
+    // pixels by commitRegion() so filtering doesn't pull in the neighbours. mip_levels > 1: box filtered
+    // levels computed on the CPU, level n stays clean while gutter >> n is at least 1 pixel.
+    // premultiplied_alpha: the regions are premultiplied on commit, draw with ONE, ONE_MINUS_SRC_ALPHA.
+    struct Options
+    {
+        int32_t  gutter              = 0;
+        uint32_t mip_levels          = 1;
+        bool     premultiplied_alpha = false;
+    };
+
     AtlasTex(uint32_t size = 64);
+    AtlasTex(uint32_t size, Options options);
 
     void clear();
 
-    glm::ivec4 getRegion(uint32_t width, uint32_t height);
+    glm::ivec4 getRegion(uint32_t width, uint32_t height);   // the gutter is added around the region
     void       setRegionTL(glm::ivec4 reg, unsigned char const * data, int32_t stride,
                            int32_t bytes_ppx = 3);   // z - width, w - height, top-left region
     void       setRegionBL(glm::ivec4 reg, unsigned char const * data, int32_t stride,
                            int32_t bytes_ppx = 3);   // z - width, w - height, bottom-left region
+    // decode target covering a bottom-left region, see tex::ReadImage(); RGB files get coverage alpha
+    // like setRegionBL(). commitRegion() has to be called once the pixels are written.
+    tex::ImageDestination getRegionDestination(glm::ivec4 reg);
+    void                  commitRegion(glm::ivec4 reg);   // premultiplies alpha and fills the gutter
+    // pixels of a committed region of an atlas with the same options, reg is the bottom-left target
+    void copyRegion(AtlasTex const & src, glm::ivec2 src_pos, glm::ivec4 reg);
+    // for pixels placed by another packer: the skyline restarts as one flat line at height, so getRegion()
+    // only returns space above it
+    void setPackedHeight(int32_t height);
 
     uint32_t              getSize() const { return m_size; }
+    Options const &       getOptions() const { return m_options; }
     unsigned char const * getData() const { return m_data.data(); }
+    bool                  isDirty() const { return m_dirty; }   // data changed after the last upload
+    glm::ivec4            getDirtyRect() const { return m_dirty_rect; }   // x, y, width, height
 
     void writeAtlasToTGA(std::string const & name);
 
+    // options, packer state and pixels, for the precompiled font cache and the baked UI atlas
+    void writeToStream(OutputMemoryStream & stream) const;
+    bool readFromStream(InputMemoryStream const & stream);
+
     ImageState * getAtlasTextureState() { return &m_atlas_tex; }
 
     static void UploadAtlasTexture(RendererBase const & render, AtlasTex & atlas);
@@ -34,13 +65,23 @@ public:
                                               AtlasTex & atlas);
 
 private:
-    int32_t atlasFit(uint32_t index, uint32_t width, uint32_t height);
-    void    atlasMerge();
+    glm::ivec4 allocRegion(uint32_t width, uint32_t height);   // skyline packer
+    int32_t    atlasFit(uint32_t index, uint32_t width, uint32_t height);
+    void       atlasMerge();
+    void       markDirty(glm::ivec4 rect);   // grows the dirty rect to cover rect (x, y, width, height)
+    void       markAllDirty();
+    void       applyOptions();
+    void       extrudeGutter(glm::ivec4 reg);
+    void       updateMips(glm::ivec4 rect);   // the texels of the levels below rect of level 0
 
-    uint32_t                   m_size = 0;
-    std::vector<unsigned char> m_data;
+    uint32_t                                m_size    = 0;
+    Options                                 m_options = {};
+    std::vector<unsigned char>              m_data;
+    std::vector<std::vector<unsigned char>> m_mips;   // levels 1 .. mip_levels - 1
     std::vector<glm::ivec3>    m_nodes;
-    ImageState                 m_atlas_tex = {};
+    ImageState                 m_atlas_tex  = {};
+    bool                       m_dirty      = true;
+    glm::ivec4                 m_dirty_rect = {};   // area to upload, the whole atlas after a clear
 };
 
 #endif   // ATLASTEX_H
@@ -1,5 +1,6 @@
 #include <limits>
 #include <algorithm>
+#include <functional>
 #include <numeric>
 #include "chain.h"
 
@@ -20,11 +21,17 @@ static constexpr Direction Perp(Direction dir)
         return Direction::LeftToRight;
 }
 
-static void SetWinfo(Widget * w, WDict & dict, Direction d, float p, float s)
+static void SetWinfo(int32_t index, WDict & dict, Direction d, float p, float s)
 {
-    WidgetInfo & wi = dict[w];
+    WidgetInfo & wi = dict[index];
+
+    // the other axis may be left as it is by this pass
+    if(!wi.placed)
+    {
+        wi.placed = true;
+        wi.geom   = wi.widget->getRect();
+    }
 
-    wi.widget = w;
     if(Horz(d))
     {
         wi.geom.m_pos.x  = p;
@@ -37,6 +44,25 @@ static void SetWinfo(Widget * w, WDict & dict, Direction d, float p, float s)
     }
 }
 
+void Chain::markDirty()
+{
+    for(Chain * ch = this; ch != nullptr && !ch->dirty; ch = ch->parent)
+        ch->dirty = true;
+}
+
+void Chain::place(WDict & wd, float pos, float space)
+{
+    constexpr float eps = std::numeric_limits<float>::epsilon();
+    if(!dirty && glm::epsilonEqual(pos, last_pos, eps) && glm::epsilonEqual(space, last_space, eps))
+        return;   // the widgets of the chain keep their geometry
+
+    distribute(wd, pos, space);
+
+    last_pos   = pos;
+    last_space = space;
+    dirty      = false;
+}
+
 class SpaceChain : public Chain
 {
 public:
@@ -57,17 +83,20 @@ private:
 class WidChain : public Chain
 {
 public:
-    WidChain(Direction d, Widget * w) : Chain(d), widget(w) {}
+    WidChain(Direction d, Widget * w, int32_t i) : Chain(d), widget(w), index(i) {}
     bool addChain(Chain *) override { return false; }
 
-    float minSize() const override;
-    float maxSize() const override;
+    void  recalc() override;
+    float minSize() const override { return minsize; }
+    float maxSize() const override { return maxsize; }
+    float basisSize() const override { return basissize; }
 
     bool removeWidget(Widget const * w) override
     {
         if(w == widget)
         {
             widget = nullptr;
+            markDirty();
             return true;
         }
         else
@@ -79,60 +108,79 @@ public:
     void distribute(WDict & wd, float pos, float space) override
     {
         if(widget)
-            SetWinfo(widget, wd, direction(), pos, space);
+            SetWinfo(index, wd, direction(), pos, space);
     }
 
 private:
     Widget * widget;
+    int32_t  index;   // in the WDict of the layout
+    float    minsize   = 0.f;
+    float    maxsize   = unlimited;
+    float    basissize = 0.f;
 };
 
-class ParChain : public Chain
+// chain with children, kept as an intrusive list of the chains in the arena
+class GroupChain : public Chain
 {
 public:
-    ParChain(Direction d) : Chain(d) {}
+    GroupChain(Direction d) : Chain(d) {}
 
     bool addChain(Chain * s) override;
+    bool removeWidget(Widget const * w) override;
+
+protected:
+    template<typename F>
+    void forEach(F && fn) const
+    {
+        for(Chain * ch = first; ch != nullptr; ch = ch->next)
+            fn(ch);
+    }
+
+    static Chain * Next(Chain const * ch) { return ch->next; }
+    static float & Given(Chain * ch) { return ch->given; }
+
+    Chain * first  = nullptr;
+    Chain * last   = nullptr;
+    int32_t number = 0;
+};
+
+class ParChain : public GroupChain
+{
+public:
+    ParChain(Direction d) : GroupChain(d) {}
 
     void recalc() override;
 
     void distribute(WDict & wd, float pos, float space) override;
-    bool removeWidget(Widget const * w) override;
 
     float maxSize() const override { return maxsize; }
     float minSize() const override { return minsize; }
+    float basisSize() const override { return basissize; }
 
 private:
     float maxsize;
     float minsize;
-
-    std::vector<Chain *> chains;
+    float basissize;
 
     float minMax() const;
     float maxMin() const;
 };
 
-class SerChain : public Chain
+class SerChain : public GroupChain
 {
 public:
-    SerChain(Direction d) : Chain(d) {}
-
-    bool addChain(Chain * s) override;
+    SerChain(Direction d) : GroupChain(d) {}
 
     void  recalc() override;
     void  distribute(WDict &, float, float) override;
-    bool  removeWidget(Widget const * w) override;
     float maxSize() const override { return maxsize; }
     float minSize() const override { return minsize; }
+    float basisSize() const override { return basissize; }
 
 private:
-    float sumMax() const;
-    float sumMin() const;
-    float sumStretch() const;
-
     float maxsize;
     float minsize;
-
-    std::vector<Chain *> chains;
+    float basissize;
 };
 
 StringLayout::StringLayout(ChainOwner & chains_pool, Direction d, float def_border) :
@@ -188,14 +236,22 @@ void StringLayout::addWidget(Widget * widget, float stretch, Align alignment)
     {
         sc->add(m_chains_pool.getChain<SpaceChain>(sc->direction(), 0, unlimited), 0);
     }
-    sc->add(m_chains_pool.getChain<WidChain>(sc->direction(), widget), 1);
+    int32_t const index      = static_cast<int32_t>(m_chains_pool.widgets.size());
+    Chain *       perp_chain = m_chains_pool.getChain<WidChain>(sc->direction(), widget, index);
+    sc->add(perp_chain, 1);
     if(alignment == Align::center || alignment == Align::left || alignment == Align::bottom)
     {
         sc->add(m_chains_pool.getChain<SpaceChain>(sc->direction(), 0, unlimited), 0);
     }
     m_par_chain->add(sc, 0);
 
-    m_ser_chain->add(m_chains_pool.getChain<WidChain>(m_ser_chain->direction(), widget), stretch);
+    Chain * ser_chain = m_chains_pool.getChain<WidChain>(m_ser_chain->direction(), widget, index);
+    m_ser_chain->add(ser_chain, stretch);
+
+    perp_chain->setShrink(widget->getShrink());
+    ser_chain->setShrink(widget->getShrink());
+
+    m_chains_pool.addWidget(widget, perp_chain, ser_chain);
 }
 
 void StringLayout::addString(StringLayout * layout, float stretch)
@@ -220,10 +276,12 @@ void StringLayout::addString(StringLayout * layout, float stretch)
 
 glm::vec2 StringLayout::resizeAll(float new_width, float new_height)
 {
-    WDict lookup_table;
+    WDict & lookup_table = m_chains_pool.widgets;
+    for(auto & wi : lookup_table)
+        wi.placed = false;
 
-    m_par_chain->recalc();
-    m_ser_chain->recalc();
+    m_par_chain->updateSizes();
+    m_ser_chain->updateSizes();
 
     float const cur_border = border();
 
@@ -235,45 +293,42 @@ glm::vec2 StringLayout::resizeAll(float new_width, float new_height)
     float const width  = std::max(min_x, std::min(new_width, max_x));
     float const height = std::max(min_y, std::min(new_height, max_y));
 
-    mainHorizontalChain()->distribute(lookup_table, cur_border, width - 2 * cur_border);
-    mainVerticalChain()->distribute(lookup_table, cur_border, height - 2 * cur_border);
+    mainHorizontalChain()->place(lookup_table, cur_border, width - 2 * cur_border);
+    mainVerticalChain()->place(lookup_table, cur_border, height - 2 * cur_border);
 
-    for(auto & [key, val] : lookup_table)
+    for(auto const & wi : lookup_table)
     {
-        if(val.widget)
+        if(wi.placed)
         {
-            val.widget->setRect(val.geom);
+            wi.widget->setRect(wi.geom);
         }
     }
 
     return {width, height};
 }
 
-float WidChain::minSize() const
+void WidChain::recalc()
 {
     if(!widget)
-        return 0;
-
-    glm::vec2 s = widget->minimumSize();
-    if(Horz(direction()))
-        return s.x;   // width
-    else
-        return s.y;   // height
-}
+    {
+        minsize   = 0.f;
+        maxsize   = unlimited;
+        basissize = 0.f;
+        return;
+    }
 
-float WidChain::maxSize() const
-{
-    if(!widget)
-        return unlimited;
+    int32_t const axis = Horz(direction()) ? 0 : 1;   // width or height
 
-    glm::vec2 s = widget->maximumSize();
-    if(Horz(direction()))
-        return s.x;   // width
+    minsize   = widget->minimumSize()[axis];
+    maxsize   = widget->maximumSize()[axis];
+    basissize = widget->getBasis()[axis];
+    if(basissize > 0.f)
+        basissize = glm::clamp(basissize, minsize, std::max(minsize, maxsize));
     else
-        return s.y;   // height
+        basissize = minsize;   // auto
 }
 
-bool ParChain::addChain(Chain * s)
+bool GroupChain::addChain(Chain * s)
 {
     if(Horz(s->direction()) != Horz(direction()))
     {
@@ -284,26 +339,19 @@ bool ParChain::addChain(Chain * s)
         return false;
     }
 
-    chains.push_back(s);
-    return true;
-}
-
-void ParChain::recalc()
-{
-    std::for_each(std::begin(chains), std::end(chains), [](Chain * p) { p->recalc(); });
-
-    maxsize = minMax();
-    minsize = maxMin();
-}
+    if(last != nullptr)
+        last->next = s;
+    else
+        first = s;
+    last = s;
+    number++;
 
-void ParChain::distribute(WDict & wd, float pos, float space)
-{
-    std::for_each(std::begin(chains), std::end(chains), [&](Chain * p) { p->distribute(wd, pos, space); });
+    return true;
 }
 
-bool ParChain::removeWidget(Widget const * w)
+bool GroupChain::removeWidget(Widget const * w)
 {
-    for(auto & ch : chains)
+    for(Chain * ch = first; ch != nullptr; ch = ch->next)
     {
         if(ch->removeWidget(w))
         {
@@ -314,10 +362,26 @@ bool ParChain::removeWidget(Widget const * w)
     return false;
 }
 
+void ParChain::recalc()
+{
+    forEach([](Chain * p) { p->updateSizes(); });
+
+    maxsize   = minMax();
+    minsize   = maxMin();
+    basissize = minsize;
+    forEach([this](Chain const * p) { basissize = std::max(basissize, p->basisSize()); });
+    basissize = std::min(basissize, std::max(minsize, maxsize));
+}
+
+void ParChain::distribute(WDict & wd, float pos, float space)
+{
+    forEach([&](Chain * p) { p->place(wd, pos, space); });
+}
+
 float ParChain::minMax() const
 {
     float min = std::numeric_limits<float>::max();
-    std::for_each(std::begin(chains), std::end(chains), [&min](Chain const * p) {
+    forEach([&min](Chain const * p) {
         float m = p->maxSize();
         if(m < min)
             min = m;
@@ -329,7 +393,7 @@ float ParChain::minMax() const
 float ParChain::maxMin() const
 {
     float max = 0;
-    std::for_each(std::begin(chains), std::end(chains), [&max](Chain const * p) {
+    forEach([&max](Chain const * p) {
         float m = p->minSize();
         if(m > max)
             max = m;
@@ -338,144 +402,183 @@ float ParChain::maxMin() const
     return max;
 }
 
-bool SerChain::addChain(Chain * s)
+void SerChain::recalc()
 {
-    if(Horz(s->direction()) != Horz(direction()))
-    {
-        if(Horz(direction()))
-            std::cerr << "Cannot add vertical chain to horizontal serial chain";
-        else
-            std::cerr << "Cannot add horizontal chain to vertical serial chain";
-        return false;
-    }
+    minsize   = 0.f;
+    maxsize   = 0.f;
+    basissize = 0.f;
+    forEach([this](Chain * p) {
+        p->updateSizes();
 
-    chains.push_back(s);
-    return true;
+        minsize += p->minSize();
+        maxsize += p->maxSize();
+        basissize += p->basisSize();
+    });
 }
 
-void SerChain::recalc()
+namespace
 {
-    std::for_each(std::begin(chains), std::end(chains), [](Chain * p) { p->recalc(); });
+    // child of a serial chain being solved: it moves from its basis size by up to room, a share of the
+    // moved space proportional to weight
+    struct FlexSlot
+    {
+        Chain * chain;
+        float   room;
+        float   weight;
+        float   given;
+    };
 
-    minsize = sumMin();
-    maxsize = sumMax();
-}
+    // Water filling: the slots that reach their room at the lowest level of space per weight are
+    // saturated first, the rest share what is left in one step. Returns the space no slot could take.
+    float FillSlots(FlexSlot * begin, FlexSlot * end, float space)
+    {
+        // room / weight ascending, the weights are positive
+        std::sort(begin, end, [](FlexSlot const & a, FlexSlot const & b) {
+            return a.room * b.weight < b.room * a.weight;
+        });
+
+        float weights = 0.f;
+        for(FlexSlot const * slot = begin; slot != end; ++slot)
+            weights += slot->weight;
+
+        for(FlexSlot * slot = begin; slot != end; ++slot)
+        {
+            if(slot->room * weights > space * slot->weight)
+            {
+                float const level = space / weights;
+                for(; slot != end; ++slot)
+                    slot->given = level * slot->weight;
+
+                return 0.f;
+            }
+
+            slot->given = slot->room;
+            space -= slot->room;
+            weights -= slot->weight;
+        }
+
+        return std::max(space, 0.f);
+    }
+}   // namespace
 
 void SerChain::distribute(WDict & wd, float pos, float space)
 {
-    if(chains.size() == 0)
+    if(number == 0)
         return;
 
-    float available = space - minSize();
-    if(available < 0.f)
+    if(space < minSize())
     {
         std::string msg;
-        msg += "Not enough space for " + std::to_string(chains.size()) + "-item in "
+        msg += "Not enough space for " + std::to_string(number) + "-item in "
                + (Horz(direction()) ? "horizontal" : "vertical") + " chain";
 
         std::cerr << msg << std::endl;
-        available = 0.f;
     }
 
-    float sf = sumStretch();
+    // grow from the basis by stretch up to the max, or shrink by shrink * basis down to the min. When all
+    // the stretched children are saturated the others get equal shares of the space left, children
+    // with no shrink keep their basis.
+    bool const grow  = space >= basisSize();
+    float      delta = grow ? space - basisSize() : basisSize() - space;
 
-    std::vector<float> sizes(chains.size());
-    std::fill(std::begin(sizes), std::end(sizes), 0.f);
+    thread_local std::vector<FlexSlot> slots;   // layouts of the windows run on the worker threads
+    slots.clear();
+    forEach([&](Chain * p) {
+        float const basis = p->basisSize();
+        float const room  = grow ? p->maxSize() - basis : basis - p->minSize();
 
-    bool do_again   = true;
-    int  num_chains = chains.size();
-    while(do_again && num_chains)
-    {
-        do_again = false;
-        for(int i = 0; i < static_cast<int>(chains.size()); i++)
+        Given(p) = basis;
+        if(room <= 0.f)
         {
-            float max_s = chains.at(i)->maxSize();
-            if(glm::epsilonEqual(sizes[i], max_s, std::numeric_limits<float>::epsilon()))
-                continue;
-
-            float min_s = chains.at(i)->minSize();
-            float siz   = min_s;
-            if(sf > 0.f)
-                siz += available * chains.at(i)->stretch() / sf;
-            else
-                siz += available / num_chains;
-
-            if(siz >= max_s)
-            {
-                sizes[i] = max_s;
-                available -= max_s - min_s;
-                sf -= chains.at(i)->stretch();
-                num_chains--;
-                do_again = true;
-                break;
-            }
-
-            sizes[i] = siz;
+            Given(p) += grow ? room : -room;   // a max below the min
+            delta -= room;
         }
-    }
+        else
+            slots.push_back({p, room, grow ? p->stretch() : p->shrink() * basis, 0.f});
+    });
 
-    int                n = chains.size();
-    std::vector<float> places(n + 1);
-    places[n]  = pos + space;
-    float fpos = pos;
-    for(int i = 0; i < static_cast<int>(chains.size()); i++)
+    auto unweighted = std::partition(std::begin(slots), std::end(slots),
+                                     [](FlexSlot const & slot) { return slot.weight > 0.f; });
+    delta           = FillSlots(slots.data(), slots.data() + (unweighted - std::begin(slots)), delta);
+    if(grow && delta > 0.f)
     {
-        places[i] = fpos;   // only give what we've got
-        fpos += sizes[i];
+        std::for_each(unweighted, std::end(slots), [](FlexSlot & slot) { slot.weight = 1.f; });
+        FillSlots(slots.data() + (unweighted - std::begin(slots)), slots.data() + slots.size(), delta);
     }
 
+    for(auto const & slot : slots)
+        Given(slot.chain) += grow ? slot.given : -slot.given;
+
     bool backwards = (direction() == Direction::RightToLeft || direction() == Direction::Down);
 
-    for(int i = 0; i < static_cast<int>(chains.size()); i++)
+    float fpos = pos;
+    for(Chain * ch = first; ch != nullptr; ch = Next(ch))
     {
-        float p = places[i];
-        float s = places[i + 1] - places[i];
+        // only give what we've got, the last one gets the rest of the space
+        float p = fpos;
+        float s = ch != last ? Given(ch) : pos + space - fpos;
+        fpos += Given(ch);
         if(backwards)
             p = 2.f * pos + space - p - s;
-        chains.at(i)->distribute(wd, p, s);
+        ch->place(wd, p, s);
     }
 }
 
-bool SerChain::removeWidget(Widget const * w)
+int32_t ChainOwner::addWidget(Widget * widget, Chain * perp_chain, Chain * ser_chain)
 {
-    for(int i = 0; i < static_cast<int>(chains.size()); i++)
-    {
-        if(chains.at(i)->removeWidget(w))
-            return true;
-    }
-    return false;
+    WidgetInfo wi;
+    wi.widget    = widget;
+    wi.chains[0] = perp_chain;
+    wi.chains[1] = ser_chain;
+    widgets.push_back(wi);
+    lookup.clear();   // sorted again on the next lookup
+
+    return static_cast<int32_t>(widgets.size()) - 1;
 }
 
-float SerChain::sumMin() const
+void ChainOwner::clear()
 {
-    auto fnc_sum = [](float a, Chain const * b) {
-        return a + b->minSize();
-    };
+    for(Chain * ch : chains)
+        ch->~Chain();
 
-    return std::accumulate(std::begin(chains), std::end(chains), 0.f, fnc_sum);
+    chains.clear();
+    widgets.clear();
+    lookup.clear();
+    arena.reset();
 }
 
-float SerChain::sumMax() const
+void MemPool::markWidgetDirty(Widget const * widget)
 {
-    auto fnc_sum = [](float a, Chain const * b) {
-        return a + b->maxSize();
-    };
+    auto & widgets = m_chains_pool.widgets;
+    auto & lookup  = m_chains_pool.lookup;
+    auto   less    = [&widgets](int32_t i, Widget const * w) { return std::less<>()(widgets[i].widget, w); };
+    if(lookup.size() != widgets.size())
+    {
+        lookup.resize(widgets.size());
+        std::iota(std::begin(lookup), std::end(lookup), 0);
+        std::sort(std::begin(lookup), std::end(lookup),
+                  [&](int32_t a, int32_t b) { return less(a, widgets[b].widget); });
+    }
 
-    return std::accumulate(std::begin(chains), std::end(chains), 0.f, fnc_sum);
+    auto it = std::lower_bound(std::begin(lookup), std::end(lookup), widget, less);
+    for(; it != std::end(lookup) && widgets[*it].widget == widget; ++it)
+    {
+        for(Chain * ch : widgets[*it].chains)
+            ch->markDirty();
+    }
 }
 
-float SerChain::sumStretch() const
+StringLayout * MemPool::createNewLayout(Direction d, float def_border)
 {
-    auto fnc_sum = [](float a, Chain const * b) {
-        return a + b->stretch();
-    };
-
-    return std::accumulate(std::begin(chains), std::end(chains), 0.f, fnc_sum);
+    m_box_pool.push_back(m_chains_pool.arena.create<StringLayout>(m_chains_pool, d, def_border));
+    return m_box_pool.back();
 }
 
-StringLayout * MemPool::createNewLayout(Direction d, float def_border)
+void MemPool::clear()
 {
-    auto new_box = std::make_unique<StringLayout>(m_chains_pool, d, def_border);
-    m_box_pool.push_back(std::move(new_box));
-    return m_box_pool.back().get();
+    for(StringLayout * layout : m_box_pool)
+        layout->~StringLayout();
+
+    m_box_pool.clear();
+    m_chains_pool.clear();
 }
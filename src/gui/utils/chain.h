@@ -3,10 +3,10 @@
 
 #include <memory>
 #include <vector>
-#include <map>
 #include <glm/glm.hpp>
 #include "../basic_types.h"
 #include "../widget.h"
+#include "arena.h"
 
 enum class Direction
 {
@@ -16,13 +16,17 @@ enum class Direction
     Up
 };
 
+class Chain;
+
 struct WidgetInfo
 {
     Rect2D   geom;
-    Widget * widget = nullptr;
+    Widget * widget    = nullptr;
+    Chain *  chains[2] = {};      // both axes, marked dirty when the widget is resized
+    bool     placed    = false;   // geom was set by this pass
 };
 
-using WDict = std::map<void *, WidgetInfo>;   // ptr value, widget info data
+using WDict = std::vector<WidgetInfo>;   // indexed by the widget index of the layout
 
 class Chain
 {
@@ -38,6 +42,7 @@ public:
         if(addChain(s))
         {
             s->sstretch = stretch;
+            s->parent   = this;
             return true;
         }
         else
@@ -47,36 +52,69 @@ public:
     Direction direction() const { return dir; }
     float     stretch() const { return sstretch; }
     void      setStretch(float s) { sstretch = s; }
+    float     shrink() const { return sshrink; }
+    void      setShrink(float s) { sshrink = s; }
 
+    // Flex sizing: a serial chain starts its children at the basis size, the extra space is given by
+    // stretch up to the max size and missing space is taken by shrink * basis down to the min size.
+    // The sizes are cached by recalc().
     virtual float maxSize() const = 0;
     virtual float minSize() const = 0;
+    virtual float basisSize() const { return minSize(); }
     virtual void  recalc() {}
 
     virtual void distribute(WDict &, float pos, float space) = 0;
 
     virtual bool removeWidget(Widget const *) { return false; }
 
+    // The chain tree is kept between the layout passes: the min/max sizes are computed again and the
+    // space is distributed again only in the dirty chains, or when a chain gets another pos or space.
+    bool isDirty() const { return dirty; }
+    void markDirty();   // a widget of the chain was resized, its parents are marked too
+    void updateSizes()
+    {
+        if(dirty)
+            recalc();
+    }
+    void place(WDict & wd, float pos, float space);
+
 protected:
     virtual bool addChain(Chain * s) = 0;
 
 private:
     Direction dir;
 
-    float sstretch;
-};
+    float   sstretch;
+    float   sshrink    = 1.f;
+    Chain * parent     = nullptr;
+    Chain * next       = nullptr;   // sibling in the parent chain, the children are an intrusive list
+    float   given      = 0.f;       // size given by the parent serial chain
+    bool    dirty      = true;
+    float   last_pos   = 0.f;
+    float   last_space = 0.f;
 
-using ChainPtr = std::unique_ptr<Chain>;
+    friend class GroupChain;
+};
 
+// The chains live in the arena of the layout, placed by value one after another. Their pointers are kept
+// only to call the destructors on clear(); the vectors keep their capacity, so after the first build of a
+// window the layout passes and the rebuilds of the same tree don't allocate.
 struct ChainOwner
 {
-    std::vector<ChainPtr> chains;
+    Arena                arena;
+    std::vector<Chain *> chains;
+    WDict                widgets;
+    std::vector<int32_t> lookup;   // widget indices sorted by the widget pointer, for markWidgetDirty()
 
     template<class T, class... Args>
     Chain * getChain(Args &&... args)
     {
-        chains.push_back(std::move(std::make_unique<T>(std::forward<Args>(args)...)));
-        return chains.back().get();
+        chains.push_back(arena.create<T>(std::forward<Args>(args)...));
+        return chains.back();
     }
+
+    int32_t addWidget(Widget * widget, Chain * perp_chain, Chain * ser_chain);
+    void    clear();
 };
 
 class StringLayout
@@ -112,12 +150,32 @@ private:
 class MemPool
 {
 public:
-    using StringLayoutPtr = std::unique_ptr<StringLayout>;
+    MemPool() = default;
+    MemPool(MemPool const &)             = delete;
+    MemPool & operator=(MemPool const &) = delete;
+    ~MemPool() { clear(); }
+
     StringLayout * createNewLayout(Direction d, float def_border);
 
+    void markWidgetDirty(Widget const * widget);   // its chains are solved again on the next pass
+    void clear();                                  // all layouts and chains, the memory is kept
+
 private:
-    ChainOwner                   m_chains_pool;
-    std::vector<StringLayoutPtr> m_box_pool;
+    ChainOwner                  m_chains_pool;
+    std::vector<StringLayout *> m_box_pool;   // in the arena of m_chains_pool
+};
+
+// chain tree of a window, kept by ChainsPacker between the layout passes until the widget tree changes
+struct WindowLayout
+{
+    MemPool        pool;
+    StringLayout * top_string = nullptr;   // nullptr: built again on the next pass
+
+    void clear()
+    {
+        pool.clear();
+        top_string = nullptr;
+    }
 };
 
 #endif
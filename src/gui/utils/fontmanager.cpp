@@ -1,4 +1,5 @@
 #include "fontmanager.h"
+#include <iostream>
 #include <sstream>
 #include <stdexcept>
 
@@ -10,20 +11,93 @@ TexFont & FontManager::addFont(FontDataDesc const & desc)
     if(auto search = m_fonts.find(hash_val); search != m_fonts.end())
         return *search->second;   // font already loaded
 
-    if(auto file = m_file_sys.getFile(desc.filename); file)
+    auto                face      = getFace(desc.filename);
+    auto constexpr      mode      = TexFont::RenderMode::NORMAL;
+    std::uint64_t const cache_key = GetCacheKey(*face, desc, mode);
+
+    if(auto cached = m_cached_fonts.find(cache_key); cached != m_cached_fonts.end())
     {
-        m_fonts[hash_val] = std::make_unique<TexFont>(
-            *this, reinterpret_cast<unsigned char const *>(file->getData()), file->getFileSize(),
-            desc.pt_size, desc.hinting, desc.kerning, desc.outline_thickness, desc.outline_type);
+        m_fonts[hash_val] =
+            std::make_unique<TexFont>(*this, face, cached->second, desc.pt_size, desc.hinting, desc.kerning,
+                                      desc.outline_thickness, desc.outline_type, mode);
+        m_cached_fonts.erase(cached);
     }
     else
+    {
+        m_fonts[hash_val] = std::make_unique<TexFont>(*this, face, desc.pt_size, desc.hinting, desc.kerning,
+                                                      desc.outline_thickness, desc.outline_type, mode);
+    }
+    m_fonts[hash_val]->setShaping(desc.shaping);
+    m_cache_keys[hash_val] = cache_key;
+
+    m_descs.emplace(desc.font_id, desc);
+    m_fonts[hash_val]->setFallbacks(resolveFallbacks(desc));
+
+    return *m_fonts[hash_val];
+}
+
+std::shared_ptr<FontFace> FontManager::getFace(std::string const & filename)
+{
+    // the font file is read and parsed once, all sizes of the font share it
+    if(auto face = m_faces[filename].lock(); face)
+        return face;
+
+    // fonts are mapped when possible, FreeType reads the pages it needs straight from the file
+    if(auto view = m_file_sys.mapFile(filename); view)
+    {
+        auto face         = std::make_shared<FontFace>(std::move(view));
+        m_faces[filename] = face;
+        return face;
+    }
+
+    auto file = m_file_sys.getFile(filename);
+    if(!file)
     {
         std::stringstream ss;
-        ss << "FontManager::addFont File: " << desc.filename << " - not found";
+        ss << "FontManager::addFont File: " << filename << " - not found";
         throw std::runtime_error(ss.str());
     }
 
-    return *m_fonts[hash_val];
+    // the face keeps the file data alive
+    auto face = std::make_shared<FontFace>(file->getStream().getBuffer());
+
+    m_faces[filename] = face;
+    return face;
+}
+
+void FontManager::setFallbackChain(std::string const & font_id, std::vector<std::string> chain)
+{
+    m_fallback_chains[font_id] = std::move(chain);
+}
+
+std::vector<TexFont *> FontManager::resolveFallbacks(FontDataDesc const & desc)
+{
+    std::vector<TexFont *> fallbacks;
+
+    auto const chain_it = m_fallback_chains.find(desc.font_id);
+    if(chain_it == m_fallback_chains.end())
+        return fallbacks;
+
+    for(auto const & fallback_id : chain_it->second)
+    {
+        auto const desc_it = m_descs.find(fallback_id);
+        if(fallback_id == desc.font_id || desc_it == m_descs.end())
+        {
+            std::stringstream ss;
+            ss << "FontManager::resolveFallbacks Font: " << desc.font_id
+               << " - fallback font: " << fallback_id << " is not loaded";
+            throw std::runtime_error(ss.str());
+        }
+
+        // fallback fonts are used at the size of the primary font
+        FontDataDesc fallback_desc = desc_it->second;
+        fallback_desc.pt_size      = desc.pt_size;
+        fallback_desc.shaping      = false;
+
+        fallbacks.push_back(&addFont(fallback_desc));
+    }
+
+    return fallbacks;
 }
 
 TexFont * FontManager::getFont(std::string name, uint32_t size)
@@ -41,11 +115,140 @@ TexFont * FontManager::getFont(std::string name, uint32_t size)
 
 void FontManager::resizeAtlas()
 {
-    AtlasTex new_atlas(m_atlas.getSize() * 2);
-    m_atlas = std::move(new_atlas);
+    AtlasTex new_atlas(m_atlas.getSize() * 2, m_atlas.getOptions());
+
+    // keep the texture object, the grown atlas is uploaded into it on the next draw
+    new_atlas.getAtlasTextureState()->m_render_id = m_atlas.getAtlasTextureState()->m_render_id;
+    m_atlas                                       = std::move(new_atlas);
 
     for(auto & fnt: m_fonts)
     {
         fnt.second->reloadGlyphs();
     }
+
+    // fallback glyphs are copied from the already reloaded fallback fonts
+    for(auto & fnt: m_fonts)
+    {
+        fnt.second->reloadFallbackGlyphs();
+    }
+}
+
+std::size_t FontManager::loadMissingGlyphs()
+{
+    std::size_t loaded = 0;
+    for(auto & fnt: m_fonts)
+    {
+        loaded += fnt.second->loadMissingGlyphs();
+    }
+
+    return loaded;
+}
+
+std::uint64_t FontManager::GetCacheKey(FontFace const & face, FontDataDesc const & desc,
+                                       TexFont::RenderMode mode)
+{
+    auto hash_combine = [](std::uint64_t seed, std::uint64_t value) {
+        return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    };
+
+    std::uint64_t key = face.getHash();
+    key               = hash_combine(key, std::hash<float>{}(desc.pt_size));
+    key               = hash_combine(key, desc.hinting);
+    key               = hash_combine(key, desc.kerning);
+    key               = hash_combine(key, std::hash<float>{}(desc.outline_thickness));
+    key               = hash_combine(key, static_cast<std::uint64_t>(desc.outline_type));
+    key               = hash_combine(key, static_cast<std::uint64_t>(mode));
+
+    return key;
+}
+
+bool FontManager::loadCache(std::string const & fname)
+{
+    if(!m_file_sys.isExist(fname))
+        return false;
+
+    auto file = m_file_sys.getFile(fname);
+    if(!file)
+        return false;
+
+    auto const &  stream  = file->getStream();
+    std::uint32_t magic   = 0;
+    std::uint32_t version = 0;
+    std::uint32_t count   = 0;
+
+    stream.read(magic);
+    stream.read(version);
+    if(magic != CacheMagic || version != CacheVersion)
+    {
+        std::stringstream ss;
+        ss << "FontManager::loadCache File: " << fname << " - unsupported cache file, ignored";
+        std::cout << ss.str() << std::endl;
+        return false;
+    }
+
+    AtlasTex atlas;
+    if(!atlas.readFromStream(stream))
+        return false;
+
+    std::map<std::uint64_t, InputMemoryStream> cached_fonts;
+
+    stream.read(count);
+    for(std::uint32_t i = 0; i < count && stream; ++i)
+    {
+        std::uint64_t key = 0, length = 0;
+        stream.read(key);
+        stream.read(length);
+
+        if(length > stream.getRemainingDataSize())
+            return false;
+
+        // views of the cache file data, no copy
+        cached_fonts.emplace(key, InputMemoryStream(stream.readBuffer(length)));
+    }
+
+    if(!stream)
+        return false;
+
+    // the glyphs of the cached fonts refer to the cached atlas
+    atlas.getAtlasTextureState()->m_render_id = m_atlas.getAtlasTextureState()->m_render_id;
+    m_atlas                                   = std::move(atlas);
+    m_cached_fonts                            = std::move(cached_fonts);
+    m_cache_dirty                             = false;
+
+    return true;
+}
+
+bool FontManager::saveCache(std::string const & fname)
+{
+    m_cached_fonts.clear();
+
+    if(!m_cache_dirty)
+        return true;
+
+    OutFile              file(fname);
+    OutputMemoryStream & stream = file.getStream();
+    std::uint32_t const  count  = static_cast<std::uint32_t>(m_fonts.size());
+
+    stream.write(CacheMagic);
+    stream.write(CacheVersion);
+    m_atlas.writeToStream(stream);
+    stream.write(count);
+
+    for(auto const & [hash_val, font] : m_fonts)
+    {
+        OutputMemoryStream font_stream;
+        font->writeCache(font_stream);
+
+        std::uint64_t const key    = m_cache_keys[hash_val];
+        std::uint64_t const length = font_stream.getLength();
+        stream.write(key);
+        stream.write(length);
+        stream.write(font_stream.getBufferPtr(), length);
+    }
+
+    if(!m_file_sys.writeFile(file))
+        return false;
+
+    m_cache_dirty = false;
+    return true;
 }
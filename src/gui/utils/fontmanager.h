@@ -7,6 +7,7 @@
 #include "../../fs/file_system.h"
 #include <map>
 #include <memory>
+#include <vector>
 
 class FontManager
 {
@@ -17,15 +18,43 @@ public:
     TexFont & addFont(FontDataDesc const & desc);
     TexFont * getFont(std::string name, uint32_t size);
 
-    AtlasTex & getAtlas() { return m_atlas; }
-    void       resizeAtlas();
+    // ordered list of font ids used for the codepoints missing in font_id, applied to the fonts added later
+    void setFallbackChain(std::string const & font_id, std::vector<std::string> chain);
+
+    AtlasTex &  getAtlas() { return m_atlas; }
+    void        resizeAtlas();
+    std::size_t loadMissingGlyphs();   // see TexFont::loadMissingGlyphs(), for all fonts
+
+    // Precompiled font cache: atlas pixels, glyphs and metrics of every font. Fonts added after
+    // loadCache() are restored from it without FreeType when the font bytes and parameters match.
+    // saveCache() writes the cache only if a glyph was rasterized since it was loaded.
+    static constexpr char const * CacheFileName = "font_cache.bin";
+
+    bool loadCache(std::string const & fname = CacheFileName);
+    bool saveCache(std::string const & fname = CacheFileName);
+    void invalidateCache() { m_cache_dirty = true; }
 
 private:
     using font_map = std::map<std::size_t, std::unique_ptr<TexFont>>;
 
-    FileSystem & m_file_sys;
-    AtlasTex     m_atlas;   // one tex atlas for all loaded fonts
-    font_map     m_fonts;
+    static constexpr std::uint32_t CacheMagic   = 0x43544658;   // "XFTC"
+    static constexpr std::uint32_t CacheVersion = 3;
+
+    std::shared_ptr<FontFace> getFace(std::string const & filename);
+    std::vector<TexFont *>    resolveFallbacks(FontDataDesc const & desc);
+
+    static std::uint64_t GetCacheKey(FontFace const & face, FontDataDesc const & desc,
+                                     TexFont::RenderMode mode);
+
+    FileSystem &                                    m_file_sys;
+    AtlasTex                                        m_atlas;   // one tex atlas for all loaded fonts
+    font_map                                        m_fonts;
+    std::map<std::string, std::weak_ptr<FontFace>>  m_faces;             // file path -> face shared by sizes
+    std::map<std::string, FontDataDesc>             m_descs;             // font_id -> description
+    std::map<std::string, std::vector<std::string>> m_fallback_chains;   // font_id -> fallback font ids
+    std::map<std::uint64_t, InputMemoryStream>      m_cached_fonts;      // cache key -> loaded font data
+    std::map<std::size_t, std::uint64_t>            m_cache_keys;        // font hash -> cache key
+    bool                                            m_cache_dirty = true;
 };
 
 #endif
@@ -0,0 +1,104 @@
+#include "rect_packer.h"
+#include <algorithm>
+#include <limits>
+
+static bool Contains(glm::ivec4 const & outer, glm::ivec4 const & inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.z <= outer.x + outer.z
+           && inner.y + inner.w <= outer.y + outer.w;
+}
+
+static bool Intersects(glm::ivec4 const & a, glm::ivec4 const & b)
+{
+    return a.x < b.x + b.z && b.x < a.x + a.z && a.y < b.y + b.w && b.y < a.y + a.w;
+}
+
+RectPacker::RectPacker(int32_t width, int32_t height)
+{
+    m_free_rects.emplace_back(0, 0, width, height);
+}
+
+glm::ivec4 RectPacker::insert(int32_t width, int32_t height)
+{
+    glm::ivec4 best(-1, -1, 0, 0);
+    int32_t    best_short_side = std::numeric_limits<int32_t>::max();
+    int32_t    best_long_side  = std::numeric_limits<int32_t>::max();
+
+    for(auto const & rect : m_free_rects)
+    {
+        if(rect.z < width || rect.w < height)
+            continue;
+
+        // the free rect that leaves the smallest leftover along its shorter side
+        int32_t const leftover_x = rect.z - width;
+        int32_t const leftover_y = rect.w - height;
+        int32_t const short_side = std::min(leftover_x, leftover_y);
+        int32_t const long_side  = std::max(leftover_x, leftover_y);
+
+        if(short_side < best_short_side || (short_side == best_short_side && long_side < best_long_side))
+        {
+            best            = glm::ivec4(rect.x, rect.y, width, height);
+            best_short_side = short_side;
+            best_long_side  = long_side;
+        }
+    }
+
+    if(best.x < 0)
+        return best;
+
+    splitFreeRects(best);
+    pruneFreeRects();
+    m_used_height = std::max(m_used_height, best.y + best.w);
+
+    return best;
+}
+
+void RectPacker::splitFreeRects(glm::ivec4 const & used)
+{
+    std::vector<glm::ivec4> new_rects;
+
+    for(auto it = m_free_rects.begin(); it != m_free_rects.end();)
+    {
+        glm::ivec4 const rect = *it;
+        if(!Intersects(rect, used))
+        {
+            ++it;
+            continue;
+        }
+
+        // the maximal parts of the free rect left, right, below and above the used one
+        if(used.x > rect.x)
+            new_rects.emplace_back(rect.x, rect.y, used.x - rect.x, rect.w);
+        if(used.x + used.z < rect.x + rect.z)
+            new_rects.emplace_back(used.x + used.z, rect.y, rect.x + rect.z - used.x - used.z, rect.w);
+        if(used.y > rect.y)
+            new_rects.emplace_back(rect.x, rect.y, rect.z, used.y - rect.y);
+        if(used.y + used.w < rect.y + rect.w)
+            new_rects.emplace_back(rect.x, used.y + used.w, rect.z, rect.y + rect.w - used.y - used.w);
+
+        it = m_free_rects.erase(it);
+    }
+
+    m_free_rects.insert(m_free_rects.end(), new_rects.begin(), new_rects.end());
+}
+
+void RectPacker::pruneFreeRects()
+{
+    for(size_t i = 0; i < m_free_rects.size(); ++i)
+    {
+        for(size_t j = i + 1; j < m_free_rects.size(); ++j)
+        {
+            if(Contains(m_free_rects[j], m_free_rects[i]))
+            {
+                m_free_rects.erase(m_free_rects.begin() + i);
+                --i;
+                break;
+            }
+            if(Contains(m_free_rects[i], m_free_rects[j]))
+            {
+                m_free_rects.erase(m_free_rects.begin() + j);
+                --j;
+            }
+        }
+    }
+}
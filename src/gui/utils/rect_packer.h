@@ -0,0 +1,26 @@
+#ifndef RECT_PACKER_H
+#define RECT_PACKER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// MaxRects bin packer with the best short side fit heuristic. The free space is a list of maximal,
+// possibly overlapping rectangles: slower than the skyline of AtlasTex, but it also fills the holes
+// below the skyline. Used to bake the UI atlas offline, see UIImageGroupManager::repackAtlas().
+class RectPacker
+{
+public:
+    RectPacker(int32_t width, int32_t height);
+
+    glm::ivec4 insert(int32_t width, int32_t height);   // x, y, width, height; x < 0 if it doesn't fit
+    int32_t    getUsedHeight() const { return m_used_height; }
+
+private:
+    void splitFreeRects(glm::ivec4 const & used);
+    void pruneFreeRects();   // removes the free rects contained in another one
+
+    std::vector<glm::ivec4> m_free_rects;
+    int32_t                 m_used_height = 0;
+};
+
+#endif   // RECT_PACKER_H
@@ -1,11 +1,14 @@
 #include "texfont.h"
 #include "fontmanager.h"
+#include "../../fs/mapped_file.h"
+#include "../../fs/memory_stream.h"
 #include "../../render/vertex_buffer.h"
 #include "glm/gtc/epsilon.hpp"
 #include "utf8_utils.h"
 
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include <ft2build.h>
 #include <cstring>
@@ -14,6 +17,7 @@
 #include FT_FREETYPE_H
 #include FT_STROKER_H
 #include FT_LCD_FILTER_H
+#include FT_SIZES_H
 
 // clang-format off
 #undef __FTERRORS_H__
@@ -37,72 +41,141 @@ auto convert = [](auto const & fixed, int fraction = 6) {
     return static_cast<float>(fixed) * delim;
 };
 
-static bool TexFontLoadFace(float size, FT_Library * library, FT_Face * face, TexFont::FontLocation location,
-                            std::string const & filename, std::vector<unsigned char> const & data)
+static void PrintFTError(FT_Error error, int32_t line)
 {
-    assert(library);
-    assert(size);
+    std::cerr << "FT_Error line " << line << ", code " << FT_Errors[error].code << ": "
+              << FT_Errors[error].message << std::endl;
+}
 
-    FT_Error  error;
-    FT_Matrix matrix = {static_cast<int>((1.0 / HRES) * 0x10000L), static_cast<int>((0.0) * 0x10000L),
-                        static_cast<int>((0.0) * 0x10000L), static_cast<int>((1.0) * 0x10000L)};
+FontFace::FontFace(std::string const & filename) : m_data(MappedFile::Map(filename))
+{
+    assert(!filename.empty());
 
-    /* Initialize library */
-    error = FT_Init_FreeType(library);
+    if(m_data.empty())
+        throw std::runtime_error("Error while loading font from file!!!");
 
-    if(error)
+    m_memory_base = reinterpret_cast<unsigned char const *>(m_data.data());
+    m_memory_size = m_data.size();
+}
+
+FontFace::FontFace(SharedBuffer data) : m_data(std::move(data))
+{
+    assert(!m_data.empty());
+
+    m_memory_base = reinterpret_cast<unsigned char const *>(m_data.data());
+    m_memory_size = m_data.size();
+}
+
+FontFace::FontFace(std::shared_ptr<MappedFile> view) : FontFace(SharedBuffer(std::move(view)))
+{}
+
+FontFace::~FontFace()
+{
+    if(m_face)
+        FT_Done_Face(m_face);
+    if(m_library)
+        FT_Done_FreeType(m_library);
+}
+
+FT_Face FontFace::getFace()
+{
+    if(!m_face)
+        init();
+
+    return m_face;
+}
+
+FT_Library FontFace::getLibrary()
+{
+    if(!m_face)
+        init();
+
+    return m_library;
+}
+
+// Key of the glyph cache computed without reading the whole file, only these pages of a mapped font are
+// loaded. The sfnt table directory holds the checksum of every table, the sampled blocks cover the other
+// formats.
+std::uint64_t FontFace::getHash() const
+{
+    if(m_hash != 0)
+        return m_hash;
+
+    constexpr size_t BlockSize  = 4096;
+    constexpr size_t NumSamples = 8;
+
+    auto hash_combine = [](std::uint64_t seed, std::uint64_t value) {
+        return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+    };
+    auto hash_block = [this](size_t offset, size_t size) -> std::uint64_t {
+        size = std::min(size, m_memory_size - offset);
+        return std::hash<std::string_view>{}(
+            std::string_view(reinterpret_cast<char const *>(m_memory_base) + offset, size));
+    };
+
+    std::uint64_t hash = m_memory_size;
+
+    // offset table: version, numTables (big endian), ..., then 16 bytes per table record
+    if(m_memory_size >= 12)
     {
-        std::cerr << "FT_Error " << FT_Errors[error].code << ": " << FT_Errors[error].message << std::endl;
-        return false;
+        size_t const num_tables = (static_cast<size_t>(m_memory_base[4]) << 8) | m_memory_base[5];
+        hash                    = hash_combine(hash, hash_block(0, 12 + num_tables * 16));
     }
 
-    /* Load face */
-    switch(location)
+    for(size_t i = 0; i < NumSamples && m_memory_size > BlockSize; ++i)
     {
-        case TexFont::FontLocation::FONT_FILE:
-            error = FT_New_Face(*library, filename.c_str(), 0, face);
-            break;
-
-        case TexFont::FontLocation::FONT_MEMORY:
-            error = FT_New_Memory_Face(*library, data.data(), static_cast<FT_Long>(data.size()), 0, face);
-            break;
+        size_t const offset = (m_memory_size - BlockSize) / (NumSamples - 1) * i;
+        hash                = hash_combine(hash, hash_block(offset, BlockSize));
     }
+    if(m_memory_size <= BlockSize)
+        hash = hash_combine(hash, hash_block(0, m_memory_size));
+
+    m_hash = hash != 0 ? hash : 1;
+    return m_hash;
+}
+
+void FontFace::init()
+{
+    FT_Error  error;
+    FT_Matrix matrix = {static_cast<int>((1.0 / HRES) * 0x10000L), static_cast<int>((0.0) * 0x10000L),
+                        static_cast<int>((0.0) * 0x10000L), static_cast<int>((1.0) * 0x10000L)};
+
+    /* Initialize library */
+    error = FT_Init_FreeType(&m_library);
 
     if(error)
     {
-        std::cerr << "FT_Error line " << __LINE__ << ", code " << FT_Errors[error].code << ": "
-                  << FT_Errors[error].message << std::endl;
-        FT_Done_FreeType(*library);
-        return false;
+        PrintFTError(error, __LINE__);
+        throw std::runtime_error("Error while initializing FreeType!!!");
     }
 
-    /* Select charmap */
-    error = FT_Select_Charmap(*face, FT_ENCODING_UNICODE);
+    /* Load face */
+    error = FT_New_Memory_Face(m_library, m_memory_base, static_cast<FT_Long>(m_memory_size), 0, &m_face);
 
     if(error)
     {
-        std::cerr << "FT_Error line " << __LINE__ << ", code " << FT_Errors[error].code << ": "
-                  << FT_Errors[error].message << std::endl;
-        FT_Done_Face(*face);
-        FT_Done_FreeType(*library);
-        return false;
+        PrintFTError(error, __LINE__);
+        FT_Done_FreeType(m_library);
+        m_face    = nullptr;
+        m_library = nullptr;
+        throw std::runtime_error("Error while loading font face!!!");
     }
 
-    /* Set char size */
-    error = FT_Set_Char_Size(*face, static_cast<int>(size * HRES), 0, DPI * HRES, DPI);
+    /* Select charmap */
+    error = FT_Select_Charmap(m_face, FT_ENCODING_UNICODE);
 
     if(error)
     {
-        std::cerr << "FT_Error line " << __LINE__ << ", code " << FT_Errors[error].code << ": "
-                  << FT_Errors[error].message << std::endl;
-        FT_Done_Face(*face);
-        FT_Done_FreeType(*library);
-        return false;
+        PrintFTError(error, __LINE__);
+        FT_Done_Face(m_face);
+        FT_Done_FreeType(m_library);
+        m_face    = nullptr;
+        m_library = nullptr;
+        throw std::runtime_error("Error while selecting unicode charmap!!!");
     }
 
-    /* Set transform matrix */
-    FT_Set_Transform(*face, &matrix, NULL);
-    return true;
+    /* Set transform matrix, the same for all sizes */
+    FT_Set_Transform(m_face, &matrix, NULL);
 }
 
 static void SetBuffer(std::vector<unsigned char> & buffer, int32_t width, int32_t height,
@@ -128,6 +201,20 @@ static void SetBuffer(std::vector<unsigned char> & buffer, int32_t width, int32_
 
 TexFont::TexFont(FontManager & owner, std::string const & filename, float pt_size, bool hinting, bool kerning,
                  float outline_thickness, Glyph::OutlineType outline_type, RenderMode mode) :
+    TexFont(owner, std::make_shared<FontFace>(filename), pt_size, hinting, kerning, outline_thickness,
+            outline_type, mode)
+{}
+
+TexFont::TexFont(FontManager & owner, unsigned char const * memory_base, size_t memory_size, float pt_size,
+                 bool hinting, bool kerning, float outline_thickness, Glyph::OutlineType outline_type,
+                 RenderMode mode) :
+    TexFont(owner,
+            std::make_shared<FontFace>(SharedBuffer::Copy(memory_base, memory_size)),
+            pt_size, hinting, kerning, outline_thickness, outline_type, mode)
+{}
+
+TexFont::TexFont(FontManager & owner, std::shared_ptr<FontFace> face, float pt_size, bool hinting,
+                 bool kerning, float outline_thickness, Glyph::OutlineType outline_type, RenderMode mode) :
     m_owner{owner},
     m_size{pt_size},
     m_hinting{hinting},
@@ -142,10 +229,9 @@ TexFont::TexFont(FontManager & owner, std::string const & filename, float pt_siz
     m_underline_position{0.0f},
     m_underline_thickness{0.0f},
     m_render_mode{mode},
-    m_location{FontLocation::FONT_FILE},
-    m_filename{filename}
+    m_face{std::move(face)}
 {
-    assert(!filename.empty());
+    assert(m_face);
     assert(pt_size > 0);
 
     // FT_LCD_FILTER_LIGHT   is (0x00, 0x55, 0x56, 0x55, 0x00)
@@ -157,12 +243,12 @@ TexFont::TexFont(FontManager & owner, std::string const & filename, float pt_siz
     m_lcd_weights[4] = 0x10;
 
     if(!initFont())
-        throw std::runtime_error("Error while loading font from file!!!");
+        throw std::runtime_error("Error while loading font!!!");
 }
 
-TexFont::TexFont(FontManager & owner, unsigned char const * memory_base, size_t memory_size, float pt_size,
-                 bool hinting, bool kerning, float outline_thickness, Glyph::OutlineType outline_type,
-                 RenderMode mode) :
+TexFont::TexFont(FontManager & owner, std::shared_ptr<FontFace> face, InputMemoryStream const & cache,
+                 float pt_size, bool hinting, bool kerning, float outline_thickness,
+                 Glyph::OutlineType outline_type, RenderMode mode) :
     m_owner{owner},
     m_size{pt_size},
     m_hinting{hinting},
@@ -177,38 +263,57 @@ TexFont::TexFont(FontManager & owner, unsigned char const * memory_base, size_t
     m_underline_position{0.0f},
     m_underline_thickness{0.0f},
     m_render_mode{mode},
-    m_location{FontLocation::FONT_MEMORY}
+    m_face{std::move(face)}
 {
+    assert(m_face);
     assert(pt_size > 0);
-    assert(memory_base);
-    assert(memory_size > 0);
 
-    // FT_LCD_FILTER_LIGHT   is (0x00, 0x55, 0x56, 0x55, 0x00)
-    // FT_LCD_FILTER_DEFAULT is (0x10, 0x40, 0x70, 0x40, 0x10)
     m_lcd_weights[0] = 0x10;
     m_lcd_weights[1] = 0x40;
     m_lcd_weights[2] = 0x70;
     m_lcd_weights[3] = 0x40;
     m_lcd_weights[4] = 0x10;
 
-    m_memory.resize(memory_size);
-    std::memcpy(m_memory.data(), memory_base, memory_size);
+    // the face and the FT_Size are created on the first glyph that is missing in the cache
+    if(!readCache(cache))
+        throw std::runtime_error("Error while reading font cache!!!");
+}
 
-    if(!initFont())
-        throw std::runtime_error("Error while loading font from memory!!!");
+TexFont::~TexFont()
+{
+    if(m_ft_size)
+        FT_Done_Size(m_ft_size);
 }
 
-bool TexFont::initFont()
+FT_Face TexFont::activateSize() const
 {
-    FT_Library      library;
-    FT_Face         face;
-    FT_Size_Metrics metrics;
+    FT_Face face = m_face->getFace();
 
-    if(!TexFontLoadFace(m_size, &library, &face, m_location, m_filename, m_memory))
+    if(!m_ft_size)
     {
-        return false;
+        /* Create and set char size, the face itself is shared with the other sizes */
+        FT_Error error = FT_New_Size(face, &m_ft_size);
+        if(!error)
+            error = FT_Activate_Size(m_ft_size);
+        if(!error)
+            error = FT_Set_Char_Size(face, static_cast<int>(m_size * HRES), 0, DPI * HRES, DPI);
+
+        if(error)
+        {
+            PrintFTError(error, __LINE__);
+            throw std::runtime_error("Error while setting font size!!!");
+        }
     }
 
+    FT_Activate_Size(m_ft_size);
+    return face;
+}
+
+bool TexFont::initFont()
+{
+    FT_Face         face = activateSize();
+    FT_Size_Metrics metrics;
+
     m_underline_position = face->underline_position / (HRESf * HRESf) * m_size;
     m_underline_position = roundf(m_underline_position);
     if(m_underline_position > -2.0f)
@@ -228,8 +333,8 @@ bool TexFont::initFont()
     m_descender = convert(metrics.descender);
     m_height    = convert(metrics.height);
     m_linegap   = m_ascender - m_descender - m_height;
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
+
+    buildCoverage(face);
 
     /* -1 is a special glyph */
     loadGlyph(-1);
@@ -237,6 +342,32 @@ bool TexFont::initFont()
     return true;
 }
 
+void TexFont::buildCoverage(FT_Face face)
+{
+    FT_UInt  glyph_index = 0;
+    FT_ULong charcode    = FT_Get_First_Char(face, &glyph_index);
+
+    m_coverage.clear();
+    while(glyph_index != 0)
+    {
+        std::size_t const word = charcode / 64;
+        if(word >= m_coverage.size())
+            m_coverage.resize(word + 1, 0);
+
+        m_coverage[word] |= std::uint64_t{1} << (charcode % 64);
+        charcode = FT_Get_Next_Char(face, charcode, &glyph_index);
+    }
+}
+
+bool TexFont::hasCodepoint(std::uint32_t const ucodepoint) const
+{
+    std::size_t const word = ucodepoint / 64;
+    if(word >= m_coverage.size())
+        return false;
+
+    return (m_coverage[word] >> (ucodepoint % 64)) & 1;
+}
+
 Glyph const & TexFont::getGlyph(std::uint32_t const ucodepoint) const
 {
     // Check if charcode has been already loaded
@@ -257,6 +388,25 @@ Glyph const & TexFont::getGlyph(std::uint32_t const ucodepoint) const
     return m_glyphs[0];
 }
 
+Glyph const & TexFont::getGlyphByIndex(std::uint32_t const glyph_index) const
+{
+    if(Glyph const * glyph = findGlyphByIndex(glyph_index); glyph != nullptr)
+        return *glyph;
+
+    return m_glyphs[0];
+}
+
+Glyph const * TexFont::findGlyphByIndex(std::uint32_t glyph_index) const
+{
+    if(auto search = m_index_lookup.find(glyph_index); search != m_index_lookup.end())
+        return &m_glyphs[search->second];
+
+    if(std::find(m_missing_indices.begin(), m_missing_indices.end(), glyph_index) == m_missing_indices.end())
+        m_missing_indices.push_back(glyph_index);
+
+    return nullptr;
+}
+
 std::int32_t TexFont::loadGlyph(char const * charcode)
 {
     std::uint32_t ucodepoint = 0;
@@ -272,19 +422,6 @@ std::int32_t TexFont::loadGlyph(char const * charcode)
 
 std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
 {
-    int32_t      x, y, w, h;
-    FT_Library   library;
-    FT_Error     error;
-    FT_Face      face;
-    FT_Glyph     ft_glyph = nullptr;
-    FT_GlyphSlot slot;
-    FT_Bitmap    ft_bitmap;
-
-    FT_UInt    glyph_index;
-    glm::ivec4 region;
-
-    float size = m_owner.getAtlas().getSize();
-
     // Check if charcode has been already loaded
     for(std::uint32_t i = 0; i < m_glyphs.size(); ++i)
     {
@@ -326,13 +463,70 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
         return m_glyphs.size() - 1;
     }
 
-    if(!TexFontLoadFace(m_size, &library, &face, m_location, m_filename, m_memory))
-        return 0;
+    if(!hasCodepoint(ucodepoint))
+    {
+        if(std::int32_t const index = loadFallbackGlyph(ucodepoint); index != 0)
+            return index;
+    }
+
+    return loadFaceGlyph(ucodepoint, 0);
+}
+
+std::int32_t TexFont::loadFallbackGlyph(std::uint32_t ucodepoint)
+{
+    for(auto * font : m_fallbacks)
+    {
+        if(!font->hasCodepoint(ucodepoint))
+            continue;
+
+        // the fallback font rasterizes into the shared atlas, only the glyph record is copied
+        std::int32_t const index = font->loadGlyph(ucodepoint);
+        if(index <= 0)
+            return index;
+
+        m_glyphs.push_back(font->m_glyphs[index]);
+        return m_glyphs.size() - 1;
+    }
+
+    return 0;
+}
+
+std::int32_t TexFont::loadGlyphByIndex(std::uint32_t glyph_index)
+{
+    if(auto search = m_index_lookup.find(glyph_index); search != m_index_lookup.end())
+        return static_cast<std::int32_t>(search->second);
+
+    return loadFaceGlyph(Glyph::IndexOnlyCharcode, glyph_index);
+}
+
+std::int32_t TexFont::loadFaceGlyph(std::uint32_t ucodepoint, std::uint32_t glyph_index)
+{
+    int32_t      x, y, w, h;
+    FT_Library   library = m_face->getLibrary();
+    FT_Error     error;
+    FT_Face      face     = activateSize();
+    FT_Glyph     ft_glyph = nullptr;
+    FT_GlyphSlot slot;
+    FT_Bitmap    ft_bitmap;
+    glm::ivec4   region;
+
+    float size = m_owner.getAtlas().getSize();
+
+    if(ucodepoint != Glyph::IndexOnlyCharcode)
+        glyph_index = FT_Get_Char_Index(face, ucodepoint);
+
+    // The glyph is already in the atlas (loaded by index), only the charcode is new
+    if(auto search = m_index_lookup.find(glyph_index); search != m_index_lookup.end())
+    {
+        Glyph glyph    = m_glyphs[search->second];
+        glyph.charcode = ucodepoint;
+        m_glyphs.push_back(std::move(glyph));
+        return m_glyphs.size() - 1;
+    }
 
     FT_Int32 flags         = 0;
     int32_t  ft_glyph_top  = 0;
     int32_t  ft_glyph_left = 0;
-    glyph_index            = FT_Get_Char_Index(face, ucodepoint);
 
     if(m_outline_type != Glyph::OutlineType::NONE)
     {
@@ -364,8 +558,6 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
     {
         std::cerr << "FT_Error line " << __LINE__ << ", code " << FT_Errors[error].code << ": "
                   << FT_Errors[error].message << std::endl;
-        FT_Done_Face(face);
-        FT_Done_FreeType(library);
         return 0;
     }
 
@@ -385,9 +577,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
         {
             std::cerr << "FT_Error code " << FT_Errors[error].code << ": " << FT_Errors[error].message
                       << std::endl;
-            FT_Done_Face(face);
             FT_Stroker_Done(stroker);
-            FT_Done_FreeType(library);
             return 0;
         }
         FT_Stroker_Set(stroker, static_cast<int>(m_outline_thickness * HRES), FT_STROKER_LINECAP_ROUND,
@@ -397,9 +587,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
         {
             std::cerr << "FT_Error code " << FT_Errors[error].code << ": " << FT_Errors[error].message
                       << std::endl;
-            FT_Done_Face(face);
             FT_Stroker_Done(stroker);
-            FT_Done_FreeType(library);
             return 0;
         }
 
@@ -419,9 +607,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
         {
             std::cerr << "FT_Error code " << FT_Errors[error].code << ": " << FT_Errors[error].message
                       << std::endl;
-            FT_Done_Face(face);
             FT_Stroker_Done(stroker);
-            FT_Done_FreeType(library);
             return 0;
         }
 
@@ -432,9 +618,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
             {
                 std::cerr << "FT_Error code " << FT_Errors[error].code << ": " << FT_Errors[error].message
                           << std::endl;
-                FT_Done_Face(face);
                 FT_Stroker_Done(stroker);
-                FT_Done_FreeType(library);
                 return 0;
             }
         }
@@ -444,9 +628,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
             if(error)
             {
                 fprintf(stderr, "FT_Error (0x%02x) : %s\n", FT_Errors[error].code, FT_Errors[error].message);
-                FT_Done_Face(face);
                 FT_Stroker_Done(stroker);
-                FT_Done_FreeType(library);
                 return 0;
             }
         }
@@ -466,6 +648,8 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
     if(region.x < 0)
     {
         std::cerr << "Texture atlas is full " << __LINE__ << std::endl;
+        if(ft_glyph)
+            FT_Done_Glyph(ft_glyph);
         return -1;
     }
 
@@ -487,6 +671,7 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
 
     Glyph glyph;
     glyph.charcode          = ucodepoint;
+    glyph.glyph_index       = glyph_index;
     glyph.width             = w;
     glyph.height            = h;
     glyph.outline_type      = m_outline_type;
@@ -505,13 +690,13 @@ std::int32_t TexFont::loadGlyph(std::uint32_t ucodepoint)
     glyph.advance_y = slot->advance.y / HRESf;
 
     m_glyphs.push_back(std::move(glyph));
+    m_index_lookup.emplace(glyph_index, m_glyphs.size() - 1);
+    m_owner.invalidateCache();
 
     if(m_outline_type != Glyph::OutlineType::NONE)
     {
         FT_Done_Glyph(ft_glyph);
     }
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
 
     return m_glyphs.size() - 1;
 }
@@ -520,7 +705,10 @@ size_t TexFont::cacheGlyphs(char const * charcodes)
 {
     assert(charcodes);
 
-    std::uint32_t missed = 0;
+    std::uint32_t     missed      = 0;
+    bool              reloaded    = false;   // the atlas was grown, the glyphs lost their kerning
+    std::size_t const first_new   = m_glyphs.size();
+    bool const        face_loaded = m_face->isLoaded();
 
     // Load each glyph
     for(std::uint32_t i = 0; i < std::strlen(charcodes); i += utf8_surrogate_len(charcodes + i))
@@ -533,6 +721,7 @@ size_t TexFont::cacheGlyphs(char const * charcodes)
         if(error == -1)   // atlas full
         {
             m_owner.resizeAtlas();
+            reloaded = true;
 
             // repeat load glyph
             if(!loadGlyph(charcodes + i))
@@ -540,36 +729,100 @@ size_t TexFont::cacheGlyphs(char const * charcodes)
         }
     }
 
-    if(m_kerning)
-        generateKerning();
+    // the kerning of the glyphs restored from the font cache is restored with them
+    bool const rasterized = reloaded || m_glyphs.size() > first_new;
+    if(m_kerning && rasterized)
+        generateKerning(reloaded ? 0 : first_new);
+
+    // glyphs that are all loaded already, e.g. by a warm start from the font cache, don't need FreeType
+    assert(rasterized || missed != 0 || m_face->isLoaded() == face_loaded);
 
     return missed;
 }
 
-void TexFont::generateKerning()
+ShapedRun const & TexFont::getShapedRun(char const * text) const
+{
+    if(auto search = m_shape_cache.find(text); search != m_shape_cache.end())
+        return search->second;
+
+    // dynamic text (counters, input) would grow the cache without limit
+    if(m_shape_cache.size() >= MaxShapeCacheSize)
+        m_shape_cache.clear();
+
+    ShapedRun run = TextShaper::Shape(activateSize(), text, m_kerning);
+
+    return m_shape_cache.emplace(text, std::move(run)).first->second;
+}
+
+void TexFont::cacheShapedText(char const * text)
+{
+    assert(text);
+
+    if(!m_shaping)
+        return;
+
+    for(auto const & sg : getShapedRun(text).glyphs)
+    {
+        if(loadGlyphByIndex(sg.glyph_index) == -1)   // atlas full
+        {
+            m_owner.resizeAtlas();
+            loadGlyphByIndex(sg.glyph_index);
+        }
+    }
+}
+
+std::size_t TexFont::loadMissingGlyphs()
 {
-    for(auto & glyph : m_glyphs)
+    // text measured before cacheShapedText() records glyphs loaded by it right after
+    m_missing_indices.erase(std::remove_if(m_missing_indices.begin(), m_missing_indices.end(),
+                                           [this](std::uint32_t glyph_index) {
+                                               return m_index_lookup.count(glyph_index) != 0;
+                                           }),
+                            m_missing_indices.end());
+    if(m_missing_indices.empty())
+        return 0;
+
+    std::stringstream ss;
+    ss << "TexFont::loadMissingGlyphs " << m_missing_indices.size()
+       << " glyphs of shaped text were not cached, call cacheShapedText() when the text is set";
+    std::cout << ss.str() << std::endl;
+
+    std::vector<std::uint32_t> indices;
+    indices.swap(m_missing_indices);
+    for(auto const glyph_index : indices)
     {
-        generateKerning(glyph);
+        if(loadGlyphByIndex(glyph_index) == -1)   // atlas full
+        {
+            m_owner.resizeAtlas();
+            loadGlyphByIndex(glyph_index);
+        }
     }
+
+    return indices.size();
 }
 
-void TexFont::generateKerning(Glyph & glyph)
+void TexFont::generateKerning(std::size_t first_new)
 {
-    FT_Library library;
-    FT_Face    face;
-    FT_UInt    glyph_index, prev_index;
-    FT_Vector  kerning;
+    // the old glyphs only get the pairs with a new glyph on the left
+    for(std::size_t i = 0; i < m_glyphs.size(); ++i)
+    {
+        generateKerning(m_glyphs[i], i < first_new ? first_new : 0);
+    }
+}
 
-    /* Load font */
-    if(!TexFontLoadFace(m_size, &library, &face, m_location, m_filename, m_memory))
-        return;
+void TexFont::generateKerning(Glyph & glyph, std::size_t first_prev)
+{
+    FT_Face   face = activateSize();
+    FT_UInt   glyph_index, prev_index;
+    FT_Vector kerning;
 
     glyph_index = FT_Get_Char_Index(face, glyph.charcode);
-    glyph.kerning.clear();
+    if(first_prev == 0)
+        glyph.kerning.clear();
 
-    for(auto & prev_glyph : m_glyphs)
+    for(std::size_t i = first_prev; i < m_glyphs.size(); ++i)
     {
+        Glyph const & prev_glyph = m_glyphs[i];
         prev_index = FT_Get_Char_Index(face, prev_glyph.charcode);
         FT_Get_Kerning(face, prev_index, glyph_index, FT_KERNING_UNFITTED, &kerning);
 
@@ -578,9 +831,6 @@ void TexFont::generateKerning(Glyph & glyph)
             glyph.kerning[prev_glyph.charcode] = kerning.x / (HRESf * HRESf);
         }
     }
-
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
 }
 
 float TexFont::glyphGetKerning(Glyph const & glyph, std::uint32_t const left_charcode) const
@@ -599,6 +849,17 @@ glm::vec2 TexFont::getTextSize(char const * text) const
     glm::vec2     size{0};
     Glyph const * prev_glyph = nullptr;
 
+    if(m_shaping)
+    {
+        ShapedRun const & run = getShapedRun(text);
+
+        size.x = run.width;
+        for(auto const & sg : run.glyphs)
+            size.y = glm::max(size.y, static_cast<float>(getGlyphByIndex(sg.glyph_index).offset_y));
+
+        return size;
+    }
+
     for(uint32_t i = 0; i < std::strlen(text); i += utf8_surrogate_len(text + i))
     {
         std::uint32_t ucodepoint = utf8_to_utf32(text + i);
@@ -619,21 +880,61 @@ glm::vec2 TexFont::getTextSize(char const * text) const
     return size;
 }
 
-void TexFont::addText(VertexBuffer & vb, char const * text, glm::vec2 & pos) const
+// glyph quad trimmed to the clip rect, the texture coordinates are cut in proportion
+static void AddClippedRectangle(VertexBuffer & vb, float x0, float y0, float x1, float y1, float s0, float t0,
+                                float s1, float t1, Rect2D const * clip)
 {
+    if(clip != nullptr)
+    {
+        if(x1 <= clip->left() || x0 >= clip->right() || y1 <= clip->bottom() || y0 >= clip->top())
+            return;
+
+        if(x0 < clip->left())
+        {
+            s0 += (s1 - s0) * (clip->left() - x0) / (x1 - x0);
+            x0 = clip->left();
+        }
+        if(x1 > clip->right())
+        {
+            s1 -= (s1 - s0) * (x1 - clip->right()) / (x1 - x0);
+            x1 = clip->right();
+        }
+        if(y0 < clip->bottom())
+        {
+            t0 += (t1 - t0) * (clip->bottom() - y0) / (y1 - y0);
+            y0 = clip->bottom();
+        }
+        if(y1 > clip->top())
+        {
+            t1 -= (t1 - t0) * (y1 - clip->top()) / (y1 - y0);
+            y1 = clip->top();
+        }
+    }
+
+    Add2DRectangle(vb, x0, y0, x1, y1, s0, t0, s1, t1);
+}
+
+void TexFont::addText(VertexBuffer & vb, char const * text, glm::vec2 & pos, Rect2D const * clip) const
+{
+    if(m_shaping)
+    {
+        addShapedText(vb, getShapedRun(text), pos, clip);
+        return;
+    }
+
     Glyph const * prev_glyph = nullptr;
     for(uint32_t i = 0; i < std::strlen(text); i += utf8_surrogate_len(text + i))
     {
         std::uint32_t ucodepoint = utf8_to_utf32(text + i);
-        addGlyph(vb, ucodepoint, prev_glyph, pos);
+        addGlyph(vb, ucodepoint, prev_glyph, pos, clip);
 
         Glyph const & glyph = getGlyph(ucodepoint);
         prev_glyph          = &glyph;
     }
 }
 
-void TexFont::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const * prev_glyph,
-                       glm::vec2 & pos) const
+void TexFont::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const * prev_glyph, glm::vec2 & pos,
+                       Rect2D const * clip) const
 {
     Glyph const & glyph = getGlyph(ucodepoint);
 
@@ -653,32 +954,192 @@ void TexFont::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const * pre
     float s1 = glyph.s1;
     float t1 = glyph.t1;
 
-    Add2DRectangle(vb, x0, y0, x1, y1, s0, t0, s1, t1);
+    AddClippedRectangle(vb, x0, y0, x1, y1, s0, t0, s1, t1, clip);
 
     pos.x += glyph.advance_x;
 }
 
+void TexFont::addShapedText(VertexBuffer & vb, ShapedRun const & run, glm::vec2 & pos,
+                            Rect2D const * clip) const
+{
+    for(auto const & sg : run.glyphs)
+    {
+        // a glyph that isn't loaded yet only advances the pen, see loadMissingGlyphs()
+        if(Glyph const * glyph = findGlyphByIndex(sg.glyph_index); glyph != nullptr)
+        {
+            float x0 = pos.x + sg.x_offset + glyph->offset_x;
+            float y1 = pos.y + sg.y_offset + glyph->offset_y;
+            float x1 = x0 + static_cast<int32_t>(glyph->width);
+            float y0 = y1 - static_cast<int32_t>(glyph->height);
+
+            AddClippedRectangle(vb, x0, y0, x1, y1, glyph->s0, glyph->t0, glyph->s1, glyph->t1, clip);
+        }
+
+        pos.x += sg.x_advance;
+        pos.y += sg.y_advance;
+    }
+}
+
 void TexFont::reloadGlyphs()
 {
-    std::vector<std::uint32_t> loaded_ucodepoints;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> loaded_glyphs;   // charcode, glyph index
 
-    // copy Unicode codepoints from already loaded glyphs
-    std::for_each(begin(m_glyphs), end(m_glyphs), [&loaded_ucodepoints](Glyph const & glyph) {
-        loaded_ucodepoints.push_back(glyph.charcode);
+    // copy Unicode codepoints and glyph indices from already loaded glyphs
+    std::for_each(begin(m_glyphs), end(m_glyphs), [&loaded_glyphs](Glyph const & glyph) {
+        loaded_glyphs.emplace_back(glyph.charcode, glyph.glyph_index);
     });
 
     // clear glyphs
     m_glyphs.resize(0);
+    m_index_lookup.clear();
+    m_fallback_reload.clear();
 
     // load glyphs to new atlas
-    for(auto const & ucodepoint : loaded_ucodepoints)
+    for(auto const & [ucodepoint, glyph_index] : loaded_glyphs)
     {
+        if(ucodepoint == Glyph::IndexOnlyCharcode)
+            loadGlyphByIndex(glyph_index);
+        else if(!m_fallbacks.empty() && ucodepoint != static_cast<std::uint32_t>(-1)
+                && !hasCodepoint(ucodepoint))
+            m_fallback_reload.push_back(ucodepoint);   // fallback font reloads it, copy after that
+        else
+            loadGlyph(ucodepoint);
+    }
+}
+
+void TexFont::reloadFallbackGlyphs()
+{
+    for(auto const ucodepoint : m_fallback_reload)
         loadGlyph(ucodepoint);
+
+    m_fallback_reload.clear();
+}
+
+void TexFont::writeCache(OutputMemoryStream & stream) const
+{
+    stream.write(m_height);
+    stream.write(m_linegap);
+    stream.write(m_ascender);
+    stream.write(m_descender);
+    stream.write(m_underline_position);
+    stream.write(m_underline_thickness);
+
+    std::uint64_t const coverage_size = m_coverage.size();
+    stream.write(coverage_size);
+    stream.write(reinterpret_cast<int8_t const *>(m_coverage.data()), coverage_size * sizeof(std::uint64_t));
+
+    std::uint32_t const num_glyphs = static_cast<std::uint32_t>(m_glyphs.size());
+    stream.write(num_glyphs);
+    for(auto const & glyph : m_glyphs)
+    {
+        std::uint64_t const width   = glyph.width;
+        std::uint64_t const height  = glyph.height;
+        std::uint32_t const outline = static_cast<std::uint32_t>(glyph.outline_type);
+
+        stream.write(glyph.charcode);
+        stream.write(glyph.glyph_index);
+        stream.write(width);
+        stream.write(height);
+        stream.write(glyph.offset_x);
+        stream.write(glyph.offset_y);
+        stream.write(glyph.advance_x);
+        stream.write(glyph.advance_y);
+        stream.write(glyph.s0);
+        stream.write(glyph.t0);
+        stream.write(glyph.s1);
+        stream.write(glyph.t1);
+        stream.write(outline);
+        stream.write(glyph.outline_thickness);
+
+        std::uint32_t const num_kerning = static_cast<std::uint32_t>(glyph.kerning.size());
+        stream.write(num_kerning);
+        for(auto const & [left_charcode, kerning] : glyph.kerning)
+        {
+            stream.write(left_charcode);
+            stream.write(kerning);
+        }
     }
 }
 
+bool TexFont::readCache(InputMemoryStream const & stream)
+{
+    stream.read(m_height);
+    stream.read(m_linegap);
+    stream.read(m_ascender);
+    stream.read(m_descender);
+    stream.read(m_underline_position);
+    stream.read(m_underline_thickness);
+
+    std::uint64_t coverage_size = 0;
+    stream.read(coverage_size);
+    if(coverage_size * sizeof(std::uint64_t) > stream.getRemainingDataSize())
+        return false;
+
+    m_coverage.resize(coverage_size);
+    stream.read(m_coverage.data(), coverage_size * sizeof(std::uint64_t));
+
+    std::uint32_t num_glyphs = 0;
+    stream.read(num_glyphs);
+
+    m_glyphs.clear();
+    m_glyphs.reserve(num_glyphs);
+    for(std::uint32_t i = 0; i < num_glyphs && stream; ++i)
+    {
+        Glyph         glyph;
+        std::uint64_t width = 0, height = 0;
+        std::uint32_t outline = 0, num_kerning = 0;
+
+        stream.read(glyph.charcode);
+        stream.read(glyph.glyph_index);
+        stream.read(width);
+        stream.read(height);
+        stream.read(glyph.offset_x);
+        stream.read(glyph.offset_y);
+        stream.read(glyph.advance_x);
+        stream.read(glyph.advance_y);
+        stream.read(glyph.s0);
+        stream.read(glyph.t0);
+        stream.read(glyph.s1);
+        stream.read(glyph.t1);
+        stream.read(outline);
+        stream.read(glyph.outline_thickness);
+
+        glyph.width        = width;
+        glyph.height       = height;
+        glyph.outline_type = static_cast<Glyph::OutlineType>(outline);
+
+        stream.read(num_kerning);
+        for(std::uint32_t k = 0; k < num_kerning && stream; ++k)
+        {
+            std::uint32_t left_charcode = 0;
+            float         kerning       = 0.0f;
+
+            stream.read(left_charcode);
+            stream.read(kerning);
+            glyph.kerning[left_charcode] = kerning;
+        }
+
+        // the -1 line glyph and the glyphs copied from fallback fonts are not glyphs of this face
+        if(glyph.charcode == Glyph::IndexOnlyCharcode || hasCodepoint(glyph.charcode))
+            m_index_lookup.emplace(glyph.glyph_index, m_glyphs.size());
+
+        m_glyphs.push_back(std::move(glyph));
+    }
+
+    return static_cast<bool>(stream) && !m_glyphs.empty();
+}
+
 void MarkupText::addText(VertexBuffer & vb, char const * text, glm::vec2 & pos) const
 {
+    if(m_font.isShaping())
+    {
+        // ligatures and RTL runs don't map to the codepoints, the line follows the advances of the run
+        ShapedRun const & run = m_font.getShapedRun(text);
+        addLine(vb, pos, run.width);
+        m_font.addShapedText(vb, run, pos);
+        return;
+    }
+
     Glyph const * prev_glyph = nullptr;
     for(uint32_t i = 0; i < std::strlen(text); i += utf8_surrogate_len(text + i))
     {
@@ -692,9 +1153,14 @@ void MarkupText::addText(VertexBuffer & vb, char const * text, glm::vec2 & pos)
 
 void MarkupText::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const * prev_glyph,
                           glm::vec2 & pos) const
+{
+    addLine(vb, pos, m_font.getGlyph(ucodepoint).advance_x);
+    m_font.addGlyph(vb, ucodepoint, prev_glyph, pos);
+}
+
+void MarkupText::addLine(VertexBuffer & vb, glm::vec2 const & pos, float width) const
 {
     Glyph const & line_glyph = m_font.getGlyph(static_cast<uint32_t>(-1));
-    Glyph const & glyph      = m_font.getGlyph(ucodepoint);
 
     float x0 = 0.0f, y0 = 0.0f, x1 = 0.0f, y1 = 0.0f, s0 = 0.0f, t0 = 0.0f, s1 = 0.0f, t1 = 0.0f;
 
@@ -702,7 +1168,7 @@ void MarkupText::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const *
     {
         x0 = pos.x;
         y0 = pos.y + m_font.m_underline_position;
-        x1 = x0 + glyph.advance_x;
+        x1 = x0 + width;
         y1 = y0 + m_font.m_underline_thickness;
         s0 = line_glyph.s0;
         t0 = line_glyph.t0;
@@ -713,7 +1179,7 @@ void MarkupText::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const *
     {
         x0 = pos.x;
         y0 = pos.y + m_font.m_ascender;
-        x1 = x0 + glyph.advance_x;
+        x1 = x0 + width;
         y1 = y0 + m_font.m_underline_thickness;
         s0 = line_glyph.s0;
         t0 = line_glyph.t0;
@@ -724,7 +1190,7 @@ void MarkupText::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const *
     {
         x0 = pos.x;
         y0 = pos.y + m_font.m_ascender * 0.33f;
-        x1 = x0 + glyph.advance_x;
+        x1 = x0 + width;
         y1 = y0 + m_font.m_underline_thickness;
         s0 = line_glyph.s0;
         t0 = line_glyph.t0;
@@ -733,5 +1199,4 @@ void MarkupText::addGlyph(VertexBuffer & vb, uint32_t ucodepoint, Glyph const *
     }
 
     Add2DRectangle(vb, x0, y0, x1, y1, s0, t0, s1, t1);
-    m_font.addGlyph(vb, ucodepoint, prev_glyph, pos);
 }
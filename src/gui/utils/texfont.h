@@ -2,9 +2,14 @@
 #define TEXFONT_H
 
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <glm/glm.hpp>
+#include "textshaper.h"
+#include "rect2d.h"
+#include "../../fs/shared_buffer.h"
 
 //  Glyph metrics:
 //  --------------
@@ -46,7 +51,11 @@ struct Glyph
         OUTER
     };
 
+    // charcode of the glyphs loaded by glyph index only (ligatures, contextual forms)
+    static constexpr std::uint32_t IndexOnlyCharcode = 0xFFFFFFFEu;
+
     std::uint32_t charcode     = -1;     // Wide character this glyph represents
+    std::uint32_t glyph_index  = 0;      // Glyph index in the font face
     size_t        width        = 0;      // Glyph's width in pixels
     size_t        height       = 0;      // Glyph's height in pixels.
     int32_t       offset_x     = 0;      // Glyph's left bearing expressed in integer pixels.
@@ -66,15 +75,44 @@ struct Glyph
 class FontManager;
 class VertexBuffer;
 
-class TexFont
+struct FT_LibraryRec_;
+struct FT_SizeRec_;
+class InputMemoryStream;
+class OutputMemoryStream;
+
+// FreeType face of one font file. The face is shared by all sizes of the font, every TexFont owns
+// an FT_Size object and activates it on the face before use. FreeType is initialized on first use,
+// fonts restored from the font cache may never need it.
+class FontFace
 {
 public:
-    enum class FontLocation
-    {
-        FONT_FILE,
-        FONT_MEMORY
-    };
+    FontFace(std::string const & filename);
+    FontFace(SharedBuffer data);                  // zero-copy face over loaded file data
+    FontFace(std::shared_ptr<MappedFile> view);   // zero-copy face over a memory-mapped file
+    ~FontFace();
+
+    FontFace(FontFace const &)             = delete;
+    FontFace & operator=(FontFace const &) = delete;
+
+    FT_FaceRec_ *    getFace();
+    FT_LibraryRec_ * getLibrary();
+    std::uint64_t    getHash() const;   // hash of the file size, sfnt table directory and sampled blocks
+    bool             isLoaded() const { return m_face != nullptr; }   // FreeType face created by getFace()
+
+private:
+    void init();
+
+    FT_LibraryRec_ *      m_library     = nullptr;
+    FT_FaceRec_ *         m_face        = nullptr;
+    unsigned char const * m_memory_base = nullptr;
+    size_t                m_memory_size = 0;
+    SharedBuffer          m_data;   // Font file bytes or the mapped font file, must outlive the face
+    mutable std::uint64_t m_hash = 0;
+};
 
+class TexFont
+{
+public:
     enum class RenderMode
     {
         LCD,
@@ -87,24 +125,60 @@ public:
     TexFont(FontManager & owner, unsigned char const * memory_base, size_t memory_size, float pt_size,
             bool hinting = true, bool kerning = true, float outline_thickness = 0.0f,
             Glyph::OutlineType outline_type = Glyph::OutlineType::NONE, RenderMode mode = RenderMode::NORMAL);
+    TexFont(FontManager & owner, std::shared_ptr<FontFace> face, float pt_size, bool hinting = true,
+            bool kerning = true, float outline_thickness = 0.0f,
+            Glyph::OutlineType outline_type = Glyph::OutlineType::NONE, RenderMode mode = RenderMode::NORMAL);
+    // restore the font from the font cache, see writeCache()
+    TexFont(FontManager & owner, std::shared_ptr<FontFace> face, InputMemoryStream const & cache,
+            float pt_size, bool hinting, bool kerning, float outline_thickness,
+            Glyph::OutlineType outline_type, RenderMode mode);
+    ~TexFont();
+
+    TexFont(TexFont const &)             = delete;
+    TexFont & operator=(TexFont const &) = delete;
 
     Glyph const & getGlyph(std::uint32_t const ucodepoint) const;
+    Glyph const & getGlyphByIndex(std::uint32_t const glyph_index) const;
     std::int32_t  loadGlyph(char const * charcode);
     std::int32_t  loadGlyph(std::uint32_t ucodepoint);
+    std::int32_t  loadGlyphByIndex(std::uint32_t glyph_index);
 
     size_t cacheGlyphs(char const * charcodes);
 
+    // Fallback chain: codepoints missing in the cmap of this font are taken from the first font of the
+    // chain that covers them. Coverage is resolved with the cmap bitmaps built at load time.
+    bool hasCodepoint(std::uint32_t const ucodepoint) const;
+    void setFallbacks(std::vector<TexFont *> fallbacks) { m_fallbacks = std::move(fallbacks); }
+    void reloadFallbackGlyphs();
+
+    // Optional shaping stage: text runs are turned into glyph ids with advances and offsets. Shaping
+    // results are cached per run, so static text is shaped only once.
+    void              setShaping(bool enable) { m_shaping = enable; }
+    bool              isShaping() const { return m_shaping; }
+    ShapedRun const & getShapedRun(char const * text) const;
+    void              cacheShapedText(char const * text);   // shape and load the glyphs of the run
+    // Glyphs of runs that were drawn or measured before cacheShapedText() are not drawn, their indices are
+    // recorded and loaded here. Returns the number of loaded glyphs, the text has to be filled again.
+    std::size_t loadMissingGlyphs();
+
     float glyphGetKerning(
         Glyph const &       glyph,
         std::uint32_t const left_charcode) const;   // charcode  codepoint of the peceding glyph
 
     glm::vec2 getTextSize(char const * text) const;
-    void      addText(VertexBuffer & vb, char const * text, glm::vec2 & pos) const;
-    void      addGlyph(VertexBuffer & vb, std::uint32_t ucodepoint, Glyph const * prev_glyph,
-                       glm::vec2 & pos) const;
+    // clip: the glyph quads are trimmed to it on the CPU, the ones outside it are not added
+    void      addText(VertexBuffer & vb, char const * text, glm::vec2 & pos,
+                      Rect2D const * clip = nullptr) const;
+    void      addGlyph(VertexBuffer & vb, std::uint32_t ucodepoint, Glyph const * prev_glyph, glm::vec2 & pos,
+                       Rect2D const * clip = nullptr) const;
+    void      addShapedText(VertexBuffer & vb, ShapedRun const & run, glm::vec2 & pos,
+                            Rect2D const * clip = nullptr) const;
 
     void reloadGlyphs();
 
+    // font metrics, coverage and glyphs; the atlas pixels are stored by the FontManager
+    void writeCache(OutputMemoryStream & stream) const;
+
     float      getHeight() const { return m_height; }
     float      getSize() const { return m_size; }
     float      getLineGap() const { return m_linegap; }
@@ -113,13 +187,29 @@ public:
     RenderMode getRenderMode() const { return m_render_mode; }
 
 private:
-    bool initFont();
-    void generateKerning();
-    void generateKerning(Glyph & glyph);
+    static constexpr std::size_t MaxShapeCacheSize = 1024;
+
+    bool          initFont();
+    FT_FaceRec_ * activateSize() const;   // select the size of this font on the shared face
+    void          buildCoverage(FT_FaceRec_ * face);
+    std::int32_t  loadFallbackGlyph(std::uint32_t ucodepoint);
+    std::int32_t  loadFaceGlyph(std::uint32_t ucodepoint, std::uint32_t glyph_index);
+    Glyph const * findGlyphByIndex(std::uint32_t glyph_index) const;   // nullptr and recorded if missing
+    void          generateKerning(std::size_t first_new = 0);   // glyphs from first_new against all glyphs
+    void          generateKerning(Glyph & glyph, std::size_t first_prev = 0);
+    bool          readCache(InputMemoryStream const & stream);
 
     FontManager & m_owner;
 
-    std::vector<Glyph> m_glyphs;
+    std::vector<Glyph>                                 m_glyphs;
+    std::unordered_map<std::uint32_t, std::size_t>     m_index_lookup;   // glyph index -> m_glyphs position
+    mutable std::unordered_map<std::string, ShapedRun> m_shape_cache;
+    mutable std::vector<std::uint32_t>                 m_missing_indices;   // see loadMissingGlyphs()
+    bool                                               m_shaping = false;
+
+    std::vector<std::uint64_t> m_coverage;          // cmap coverage bitmap, bit per codepoint
+    std::vector<TexFont *>     m_fallbacks;         // ordered fallback chain, same size fonts
+    std::vector<std::uint32_t> m_fallback_reload;   // fallback glyphs dropped by reloadGlyphs()
 
     float              m_size;                // Font size
     bool               m_hinting;             // Whether to use autohint when rendering font
@@ -139,10 +229,9 @@ private:
     float m_underline_position;    // The position of the underline line for this face.
     float m_underline_thickness;   // The thickness of the underline for this face.
 
-    RenderMode                 m_render_mode;
-    FontLocation               m_location;
-    std::string                m_filename;   // Font filename, for when location == TEXTURE_FONT_FILE
-    std::vector<unsigned char> m_memory;     // Font memory, for when location == TEXTURE_FONT_MEMORY
+    RenderMode                m_render_mode;
+    std::shared_ptr<FontFace> m_face;                // Face shared by all sizes of the font file
+    mutable FT_SizeRec_ *     m_ft_size = nullptr;   // Size object of this font on m_face, created lazily
 
     friend struct MarkupText;
 };
@@ -162,9 +251,11 @@ struct MarkupText
           m_line(line)
     {}
 
+    // a shaped run gets one line over its whole width
     void addText(VertexBuffer & vb, char const * text, glm::vec2 & pos) const;
     void addGlyph(VertexBuffer & vb, std::uint32_t ucodepoint, Glyph const * prev_glyph,
                   glm::vec2 & pos) const;
+    void addLine(VertexBuffer & vb, glm::vec2 const & pos, float width) const;
 
     TexFont & m_font;
     LineType  m_line;
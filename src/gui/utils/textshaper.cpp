@@ -0,0 +1,140 @@
+#include "textshaper.h"
+#include "utf8_utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_ADVANCES_H
+
+#ifdef USE_HARFBUZZ
+#    include <hb.h>
+#    include <hb-ft.h>
+#endif
+
+// TexFont sets the horizontal char size with HRES oversampling and scales it back with the face
+// transform, so horizontal metrics reported by FreeType/HarfBuzz are HRES times larger.
+constexpr float HRESf = 64.0f;
+
+namespace TextShaper
+{
+bool IsRTLCodepoint(std::uint32_t ucodepoint)
+{
+    return (ucodepoint >= 0x0590 && ucodepoint <= 0x08FF)      // Hebrew, Arabic, Syriac, Thaana, NKo ...
+           || (ucodepoint >= 0xFB1D && ucodepoint <= 0xFDFF)   // Hebrew and Arabic presentation forms A
+           || (ucodepoint >= 0xFE70 && ucodepoint <= 0xFEFF)   // Arabic presentation forms B
+           || (ucodepoint >= 0x10800 && ucodepoint <= 0x10FFF) || ucodepoint == 0x200F;   // RLM
+}
+
+static bool IsStrongLTRCodepoint(std::uint32_t ucodepoint)
+{
+    if(ucodepoint < 0x80)
+        return (ucodepoint >= 'A' && ucodepoint <= 'Z') || (ucodepoint >= 'a' && ucodepoint <= 'z');
+
+    // everything outside of the punctuation/symbol blocks is treated as a letter
+    return ucodepoint >= 0xC0 && !(ucodepoint >= 0x2000 && ucodepoint <= 0x2BFF)
+           && !IsRTLCodepoint(ucodepoint);
+}
+
+bool IsRTLText(char const * text)
+{
+    std::size_t const length = std::strlen(text);
+
+    for(std::size_t i = 0; i < length; i += std::max<std::size_t>(1, utf8_surrogate_len(text + i)))
+    {
+        std::uint32_t const ucodepoint = utf8_to_utf32(text + i);
+
+        if(IsRTLCodepoint(ucodepoint))
+            return true;
+        if(IsStrongLTRCodepoint(ucodepoint))
+            return false;
+    }
+
+    return false;
+}
+
+#ifdef USE_HARFBUZZ
+ShapedRun Shape(FT_FaceRec_ * face, char const * text, bool kerning)
+{
+    ShapedRun run;
+
+    hb_font_t *   hb_font = hb_ft_font_create_referenced(face);
+    hb_buffer_t * buffer  = hb_buffer_create();
+
+    hb_buffer_add_utf8(buffer, text, -1, 0, -1);
+    hb_buffer_guess_segment_properties(buffer);
+
+    hb_feature_t no_kerning;
+    hb_feature_from_string("-kern", -1, &no_kerning);
+    hb_shape(hb_font, buffer, kerning ? nullptr : &no_kerning, kerning ? 0 : 1);
+
+    unsigned int                glyph_count = 0;
+    hb_glyph_info_t const *     info        = hb_buffer_get_glyph_infos(buffer, &glyph_count);
+    hb_glyph_position_t const * pos         = hb_buffer_get_glyph_positions(buffer, &glyph_count);
+
+    run.rtl = hb_buffer_get_direction(buffer) == HB_DIRECTION_RTL;
+    run.glyphs.reserve(glyph_count);
+
+    for(unsigned int i = 0; i < glyph_count; ++i)
+    {
+        ShapedGlyph sg;
+        sg.glyph_index = info[i].codepoint;   // after hb_shape() codepoint holds the glyph index
+        sg.cluster     = info[i].cluster;
+        sg.x_advance   = pos[i].x_advance / (HRESf * HRESf);
+        sg.y_advance   = pos[i].y_advance / HRESf;
+        sg.x_offset    = pos[i].x_offset / (HRESf * HRESf);
+        sg.y_offset    = pos[i].y_offset / HRESf;
+
+        run.width += sg.x_advance;
+        run.glyphs.push_back(sg);
+    }
+
+    hb_buffer_destroy(buffer);
+    hb_font_destroy(hb_font);
+
+    return run;
+}
+#else
+ShapedRun Shape(FT_FaceRec_ * face, char const * text, bool kerning)
+{
+    ShapedRun         run;
+    std::size_t const length = std::strlen(text);
+
+    run.rtl = IsRTLText(text);
+
+    for(std::size_t i = 0; i < length; i += std::max<std::size_t>(1, utf8_surrogate_len(text + i)))
+    {
+        ShapedGlyph sg;
+        sg.glyph_index = FT_Get_Char_Index(face, utf8_to_utf32(text + i));
+        sg.cluster     = static_cast<std::uint32_t>(i);
+
+        FT_Fixed advance = 0;
+        if(FT_Get_Advance(face, sg.glyph_index, FT_LOAD_NO_HINTING, &advance) == 0)
+            sg.x_advance = advance / (65536.0f * HRESf);   // 16.16 value
+
+        // kerning is applied to the advance of the visually left glyph of the pair
+        if(kerning && FT_HAS_KERNING(face) && !run.glyphs.empty())
+        {
+            ShapedGlyph & prev  = run.glyphs.back();
+            ShapedGlyph & left  = run.rtl ? sg : prev;
+            ShapedGlyph & right = run.rtl ? prev : sg;
+
+            FT_Vector kern_vec;
+            if(FT_Get_Kerning(face, left.glyph_index, right.glyph_index, FT_KERNING_UNFITTED, &kern_vec) == 0)
+                left.x_advance += kern_vec.x / (HRESf * HRESf);
+        }
+
+        run.glyphs.push_back(sg);
+    }
+
+    if(run.rtl)
+        std::reverse(run.glyphs.begin(), run.glyphs.end());
+
+    for(auto const & sg : run.glyphs)
+        run.width += sg.x_advance;
+
+    return run;
+}
+#endif
+}   // namespace TextShaper
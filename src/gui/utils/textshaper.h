@@ -0,0 +1,40 @@
+#ifndef TEXTSHAPER_H
+#define TEXTSHAPER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FT_FaceRec_;
+
+// Result of shaping a run of text: glyph ids of the font (not codepoints) with pen advances and
+// offsets, already in visual (left-to-right drawing) order.
+struct ShapedGlyph
+{
+    std::uint32_t glyph_index = 0;      // Glyph index in the font face
+    std::uint32_t cluster     = 0;      // Byte offset of the source character in the UTF-8 run
+    float         x_advance   = 0.0f;   // Pen advance after drawing this glyph, includes kerning
+    float         y_advance   = 0.0f;
+    float         x_offset    = 0.0f;   // Glyph displacement from the pen position
+    float         y_offset    = 0.0f;
+};
+
+struct ShapedRun
+{
+    std::vector<ShapedGlyph> glyphs;
+    float                    width = 0.0f;   // Sum of the advances
+    bool                     rtl   = false;
+};
+
+namespace TextShaper
+{
+bool IsRTLCodepoint(std::uint32_t ucodepoint);
+bool IsRTLText(char const * text);   // direction of the first strong character
+
+// face must have the char size and transform of the TexFont already set.
+// With USE_HARFBUZZ the run is shaped with HarfBuzz (ligatures, GPOS, Arabic/Indic, bidi), otherwise
+// a simple FreeType shaper is used: cmap lookup, 'kern' table kerning and reordering of RTL runs.
+ShapedRun Shape(FT_FaceRec_ * face, char const * text, bool kerning);
+}   // namespace TextShaper
+
+#endif   // TEXTSHAPER_H
@@ -19,6 +19,8 @@ Widget::Widget(WidgetDesc const & desc, UIWindow & owner) : m_owner(owner)
     m_text_horizontal_align = desc.text_hor;
     m_type                  = desc.type;
     m_stretch               = desc.stretch;
+    m_basis                 = desc.basis;
+    m_shrink                = desc.shrink;
 
     UI & ui = m_owner.getOwner();
     if(auto ptr = ui.m_fonts.getFont(desc.font_name, desc.size); ptr != nullptr)
@@ -35,15 +37,41 @@ Widget::Widget(WidgetDesc const & desc, UIWindow & owner) : m_owner(owner)
 }
 
 void Widget::update(float time, bool check_cursor)
+{
+    subClassUpdateChildren(time, check_cursor);
+    subClassUpdate(time, check_cursor);
+}
+
+void Widget::subClassUpdateChildren(float time, bool check_cursor)
 {
     for(auto & ch : m_children)
         ch->update(time, check_cursor);
+}
 
-    subClassUpdate(time, check_cursor);
+RegionDataOfUITexture const * Widget::subClassFindRegion() const
+{
+    if(m_region_name.empty() || !m_owner.isImageGroupExist())
+        return nullptr;
+
+    return m_owner.getImageGroup().getImageRegion(m_region_name);
+}
+
+void Widget::refreshRegion()
+{
+    m_region_ptr = subClassFindRegion();
+
+    for(auto & ch : m_children)
+        ch->refreshRegion();
 }
 
-void Widget::fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const
+void Widget::fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                         Rect2D const & clip) const
 {
+    // the children are inside the widget, the whole subtree is culled
+    Rect2D const bounds = getBounds();
+    if(!clip.intersects(bounds))
+        return;
+
     if(m_region_ptr != nullptr && visible())
     {
         glm::vec2 pos = m_pos;
@@ -51,11 +79,18 @@ void Widget::fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers
     }
 
     // draw children
-    for(auto & ch : m_children)
-        ch->fillBuffers(background, text);
+    Rect2D const inner = Rect2D::Intersect(clip, bounds);
+    subClassFillChildren(background, text, inner);
 
     if(visible())
-        subClassFillTextBuffer(text);
+        subClassFillTextBuffer(text, inner);
+}
+
+void Widget::subClassFillChildren(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                                  Rect2D const & clip) const
+{
+    for(auto & ch : m_children)
+        ch->fillBuffers(background, text, clip);
 }
 
 void Widget::move(glm::vec2 const & new_origin)
@@ -70,6 +105,12 @@ void Widget::addWidget(std::unique_ptr<Widget> widget)
 {
     assert(m_type == ElementType::VerticalLayoutee || m_type == ElementType::HorizontalLayoutee);
 
+    adoptChild(std::move(widget));
+    m_owner.sizeUpdated();   // new chains
+}
+
+void Widget::adoptChild(std::unique_ptr<Widget> widget)
+{
     widget->m_parent = this;
     m_children.push_back(std::move(widget));
 }
@@ -79,6 +120,7 @@ void Widget::removeWidget(Widget * widget)
     auto it = std::remove_if(m_children.begin(), m_children.end(),
                              [widget](auto const & ptr) { return widget == ptr.get(); });
     m_children.erase(it, m_children.end());
+    m_owner.sizeUpdated();
     // std::erase_if(m_children, [widget](auto & ptr) { return widget == ptr.get();}) c++20
 }
 
@@ -113,7 +155,7 @@ Widget * Widget::getWidgetFromIDName(std::string const & id_name)
 
 void Widget::sizeUpdated()
 {
-    m_owner.sizeUpdated();
+    m_owner.widgetSizeUpdated(this);
 }
 
 float Widget::getHorizontalOffset(std::string const & line) const
@@ -16,16 +16,24 @@ struct WidgetDesc;
 class Widget
 {
 private:
-    virtual void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text) const {}
+    virtual void subClassFillTextBuffer(ColorMap::ColoredTextBuffers & text, Rect2D const & clip) const {}
     virtual void subClassUpdate(float time, bool check_cursor) {}
+    virtual RegionDataOfUITexture const * subClassFindRegion() const;
+    // all children by default, widgets placing their own children can clip or skip them
+    virtual void subClassFillChildren(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                                      Rect2D const & clip) const;
+    virtual void subClassUpdateChildren(float time, bool check_cursor);
 
 public:
     Widget(WidgetDesc const & desc, UIWindow & owner);
     virtual ~Widget() = default;
 
-    void fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text) const;
+    // clip: the screen area left by the parents, the subtrees outside it are skipped
+    void fillBuffers(VertexBuffer & background, ColorMap::ColoredTextBuffers & text,
+                     Rect2D const & clip) const;
     void update(float time, bool check_cursor);
     void move(glm::vec2 const & new_origin);
+    void refreshRegion();   // the atlas regions of the tree were changed by a hot reload
 
     // virtual & final - to prevent overriding in descendants
     virtual void addWidget(std::unique_ptr<Widget> widget) final;
@@ -48,10 +56,13 @@ public:
     glm::vec2   maximumSize() const { return m_max_size; }
     float       getStretch() const { return m_stretch; }
     void        setStretch(float stretch) { m_stretch = stretch; }
+    glm::vec2   getBasis() const { return m_basis; }   // 0 - the minimum size
+    float       getShrink() const { return m_shrink; }
     glm::vec2   getSize() const { return m_rect.m_size; }
     Rect2D      getRect() const { return m_rect; }
     void        setRect(Rect2D const & rect) { m_rect = rect; }
     void        setSize(float width, float height) { m_rect.m_size = {width, height}; }
+    Rect2D      getBounds() const { return {m_pos, m_rect.m_size}; }   // on the screen
     std::string getId() const { return m_id; }
     glm::vec2   pos() const { return m_pos; }
 
@@ -64,11 +75,13 @@ public:
 protected:
     float getHorizontalOffset(std::string const & line) const;
     float getVerticalOffset() const;
+    void  adoptChild(std::unique_ptr<Widget> widget);   // no layout pass, the widget places it itself
 
     UIWindow & m_owner;
 
     glm::vec2   m_min_size    = {};
     glm::vec2   m_max_size    = {};
+    glm::vec2   m_basis       = {};   // layout start size, grown by m_stretch or shrunk by m_shrink
     Rect2D      m_rect        = {};
     glm::vec2   m_pos         = {};                     // draw position
     glm::vec4   m_fields      = {1.f, 1.f, 1.f, 1.f};   // left, right, bottom, top
@@ -78,6 +91,7 @@ protected:
     bool        m_visible               = true;
     bool        m_focused               = false;
     float       m_stretch               = 0.f;
+    float       m_shrink                = 1.f;
     Align       m_horizontal            = Align::left;
     Align       m_vertical              = Align::top;
     Align       m_text_horizontal_align = Align::left;
@@ -1,6 +1,7 @@
 #include "renderer.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
+#include <algorithm>
 #include <array>
 #include <stdlib.h>
 #include <stdexcept>
@@ -80,6 +81,8 @@ static std::array<GLTextureFormatMapping, static_cast<uint32_t>(ImageState::Form
  {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, GL_UNSIGNED_BYTE}, // DXT1
  {GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, GL_UNSIGNED_BYTE}, // DXT3
  {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, GL_UNSIGNED_BYTE}, // DXT5
+ {GL_COMPRESSED_RGB8_ETC2, 0, GL_UNSIGNED_BYTE}, // ETC2_RGB8
+ {GL_COMPRESSED_RGBA8_ETC2_EAC, 0, GL_UNSIGNED_BYTE}, // ETC2_RGBA8
  {GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT}       // DEPTH
         }
 };
@@ -87,7 +90,8 @@ static std::array<GLTextureFormatMapping, static_cast<uint32_t>(ImageState::Form
 constexpr static bool IsCompressedTextureFormat(ImageState::Format fmt)
 {
     return (fmt == ImageState::Format::DXT1) || (fmt == ImageState::Format::DXT3)
-           || (fmt == ImageState::Format::DXT5);
+           || (fmt == ImageState::Format::DXT5) || (fmt == ImageState::Format::ETC2_RGB8)
+           || (fmt == ImageState::Format::ETC2_RGBA8);
 }
 
 constexpr static glm::vec4 GetMtrxRow(glm::mat4 const & mtx, int32_t row_num = 0)
@@ -457,7 +461,32 @@ void RendererBase::uploadTextureData(ImageState & tex, tex::ImageData const & te
                                     ? tex_type
                                     : (GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<uint32_t>(face));
 
-        if(compressed)
+        if(tex_data.mip_levels > 1)
+        {
+            // mip levels stored one after another, precompressed or RGBA computed on the CPU
+            assert(compressed || tex.m_format == ImageState::Format::R8G8B8A8);
+
+            uint32_t offset = 0;
+            for(uint32_t level = 0; level < tex_data.mip_levels; ++level)
+            {
+                uint32_t const width  = std::max(tex.m_width >> level, 1u);
+                uint32_t const height = std::max(tex.m_height >> level, 1u);
+                GLint const    mip    = static_cast<GLint>(level);
+                uint32_t const size   = compressed
+                                            ? tex::GetCompressedSize(tex_data.compression, width, height)
+                                            : width * height * 4;
+
+                if(compressed)
+                    glCompressedTexImage2D(target, mip, internal_format, width, height, 0,
+                                           static_cast<GLsizei>(size), data + offset);
+                else
+                    glTexImage2D(target, mip, internal_format, static_cast<int32_t>(width),
+                                 static_cast<int32_t>(height), 0, input_format, input_type, data + offset);
+                offset += size;
+            }
+            glTexParameteri(tex_type, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(tex_data.mip_levels - 1));
+        }
+        else if(compressed)
             glCompressedTexImage2D(target, 0, internal_format, tex.m_width, tex.m_height, 0, data_size, data);
         else
             glTexImage2D(target, 0, internal_format, static_cast<int32_t>(tex.m_width),
@@ -473,7 +502,7 @@ void RendererBase::uploadTextureData(ImageState & tex, tex::ImageData const & te
                          input_format, input_type, data);
     }
 
-    if(tex.m_gen_mips
+    if(tex.m_gen_mips && tex_data.mip_levels == 1
        && (tex.m_type != ImageState::Type::TEXTURE_CUBE || face == ImageState::CubeFace::NEG_Z))
     {
         // Note: for cube maps mips are only generated when the side with the highest index is uploaded
@@ -487,6 +516,36 @@ void RendererBase::uploadTextureData(ImageState & tex, tex::ImageData const & te
     tex.m_committed = true;
 }
 
+void RendererBase::uploadTextureRegion(ImageState & tex, glm::ivec4 rect, uint8_t const * data,
+                                       uint32_t row_length, uint32_t level) const
+{
+    assert(tex.m_render_id != 0 && tex.m_committed && tex.m_type == ImageState::Type::TEXTURE_2D);
+    assert(data != nullptr && !IsCompressedTextureFormat(tex.m_format));
+    assert(rect.x >= 0 && rect.y >= 0
+           && rect.x + rect.z <= static_cast<int32_t>(std::max(tex.m_width >> level, 1u))
+           && rect.y + rect.w <= static_cast<int32_t>(std::max(tex.m_height >> level, 1u)));
+
+    uint32_t const input_format = g_texture_gl_formats[static_cast<uint32_t>(tex.m_format)].gl_input_format;
+    uint32_t const input_type = g_texture_gl_formats[static_cast<uint32_t>(tex.m_format)].gl_input_data_type;
+
+    glBindTexture(GL_TEXTURE_2D, tex.m_render_id);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(row_length));
+
+    glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), rect.x, rect.y, rect.z, rect.w, input_format,
+                    input_type, data);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if(tex.m_gen_mips && level == 0)
+    {
+        glEnable(GL_TEXTURE_2D);
+        glGenerateMipmapEXT(GL_TEXTURE_2D);
+        glDisable(GL_TEXTURE_2D);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void RendererBase::destroyTexture(ImageState & tex) const
 {
     assert(tex.m_render_id != 0);
@@ -1059,6 +1118,17 @@ void RendererBase::disableClipPlane(uint32_t plane_num) const
     glDisable(plane_id);
 }
 
+void RendererBase::enableScissor(glm::ivec4 const & rect) const
+{
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect.x, rect.y, std::max(rect.z, 0), std::max(rect.w, 0));
+}
+
+void RendererBase::disableScissor() const
+{
+    glDisable(GL_SCISSOR_TEST);
+}
+
 void RendererBase::setDrawColor(glm::vec4 const & color) const
 {
     glColor4fv(glm::value_ptr(color));
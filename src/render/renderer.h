@@ -44,6 +44,10 @@ public:
     void          createTexture(ImageState & tex) const;
     void          uploadTextureData(ImageState & tex, tex::ImageData const & tex_data,
                                     ImageState::CubeFace face = ImageState::CubeFace::POS_X) const;
+    // updates rect (x, y, width, height) of a mip level of a committed 2D texture, rows of data are
+    // row_length pixels apart
+    void          uploadTextureRegion(ImageState & tex, glm::ivec4 rect, uint8_t const * data,
+                                      uint32_t row_length, uint32_t level = 0) const;
     void          destroyTexture(ImageState & tex) const;
     bool          get2DTextureData(ImageState const & tex, tex::ImageData & tex_data,
                                    ImageState::CubeFace face = ImageState::CubeFace::POS_X) const;
@@ -73,6 +77,8 @@ public:
 
     void enableClipPlane(uint32_t plane_num, glm::vec4 const & plane) const;
     void disableClipPlane(uint32_t plane_num) const;
+    void enableScissor(glm::ivec4 const & rect) const;   // x, y, width, height in window pixels
+    void disableScissor() const;
 
     void setDrawColor(glm::vec4 const & color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)) const;
 
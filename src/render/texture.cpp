@@ -3,10 +3,26 @@
 #include "../fs/file.h"
 #include <glm/gtc/matrix_transform.hpp>
 
+static ImageState::Format GetImageFormat(tex::ImageData const & image)
+{
+    switch(image.compression)
+    {
+        case tex::ImageData::Compression::cp_dxt1: return ImageState::Format::DXT1;
+        case tex::ImageData::Compression::cp_dxt3: return ImageState::Format::DXT3;
+        case tex::ImageData::Compression::cp_dxt5: return ImageState::Format::DXT5;
+        case tex::ImageData::Compression::cp_etc2_rgb: return ImageState::Format::ETC2_RGB8;
+        case tex::ImageData::Compression::cp_etc2_rgba: return ImageState::Format::ETC2_RGBA8;
+        default: break;
+    }
+
+    return image.type == tex::ImageData::PixelType::pt_rgb ? ImageState::Format::R8G8B8
+                                                            : ImageState::Format::R8G8B8A8;
+}
+
 bool ImageState::loadImageDataFromFile(std::string const & fname, RendererBase const & render)
 {
     tex::ImageData image;
-    if(!tex::ReadTGA(fname, image))
+    if(!tex::ReadImage(fname, image))
         return false;
 
     loadImageData(image, render);
@@ -17,7 +33,7 @@ bool ImageState::loadImageDataFromFile(std::string const & fname, RendererBase c
 bool ImageState::loadImageDataFromFile(BaseFile const & file, RendererBase const & render)
 {
     tex::ImageData image;
-    if(!tex::ReadTGA(file, image))
+    if(!tex::ReadImage(file, image))
         return false;
 
     loadImageData(image, render);
@@ -29,7 +45,7 @@ void ImageState::loadImageData(tex::ImageData const & image, RendererBase const
 {
     m_committed = false;
     m_type      = Type::TEXTURE_2D;
-    m_format    = image.type == tex::ImageData::PixelType::pt_rgb ? Format::R8G8B8 : Format::R8G8B8A8;
+    m_format    = GetImageFormat(image);
     m_width     = image.width;
     m_height    = image.height;
     m_depth     = 1;
@@ -49,10 +65,10 @@ bool ImageState::loadCubeMapFromFiles(std::array<char const *, 6> const & fnames
     tex::ImageData image;
     for(std::size_t i = 0; i < fnames.size(); ++i)
     {
-        if(!tex::ReadTGA(fnames[i], image))
+        if(!tex::ReadImage(fnames[i], image))
             return false;
 
-        m_format = image.type == tex::ImageData::PixelType::pt_rgb ? Format::R8G8B8 : Format::R8G8B8A8;
+        m_format = GetImageFormat(image);
         m_width  = image.width;
         m_height = image.height;
 
@@ -40,6 +40,8 @@ struct ImageState
         DXT1,
         DXT3,
         DXT5,
+        ETC2_RGB8,
+        ETC2_RGBA8,
         DEPTH,
         QUANTITY
     };
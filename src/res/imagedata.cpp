@@ -1,7 +1,14 @@
 #include "imagedata.h"
 #include "../fs/file.h"
+#include "../fs/file_stream.h"
+#include "pixel_ops.h"
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <limits>
 #include <vector>
 
 #pragma pack(push, 1)
@@ -55,14 +62,160 @@ struct TGAHEADER
     uint8_t  imagedescriptor;
 };
 
+struct DDSPIXELFORMAT
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourcc;
+    uint32_t rgb_bit_count;
+    uint32_t r_bit_mask;
+    uint32_t g_bit_mask;
+    uint32_t b_bit_mask;
+    uint32_t a_bit_mask;
+};
+
+struct DDSHEADER
+{
+    uint32_t       magic;   // "DDS "
+    uint32_t       size;
+    uint32_t       flags;
+    uint32_t       height;
+    uint32_t       width;
+    uint32_t       pitch_or_linear_size;
+    uint32_t       depth;
+    uint32_t       mip_map_count;
+    uint32_t       reserved1[11];
+    DDSPIXELFORMAT ddspf;
+    uint32_t       caps;
+    uint32_t       caps2;
+    uint32_t       caps3;
+    uint32_t       caps4;
+    uint32_t       reserved2;
+};
+
+struct DDSHEADERDXT10   // follows DDSHEADER when the fourcc is "DX10"
+{
+    uint32_t dxgi_format;
+    uint32_t resource_dimension;
+    uint32_t misc_flag;
+    uint32_t array_size;
+    uint32_t misc_flags2;
+};
+
+struct KTXHEADER   // KTX 1.1
+{
+    uint8_t  identifier[12];
+    uint32_t endianness;
+    uint32_t gl_type;
+    uint32_t gl_type_size;
+    uint32_t gl_format;
+    uint32_t gl_internal_format;
+    uint32_t gl_base_internal_format;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t number_of_array_elements;
+    uint32_t number_of_faces;
+    uint32_t number_of_mipmap_levels;
+    uint32_t bytes_of_key_value_data;
+};
+
 #pragma pack(pop)
 
 namespace tex
 {
+// Stores the rows of a file in the destination in the order they are decoded: BGR(A) -> RGB(A) unless the
+// file is in RGB order, the row order and direction of the file are resolved here, RGB rows are expanded
+// when the destination is RGBA
+class RowSink
+{
+public:
+    RowSink(ImageDestination const & dst, uint32_t width, uint32_t height, uint32_t bytes_per_pixel,
+            bool flip_rows, bool flip_columns, bool bgr = true)
+        : m_dst(dst),
+          m_width(width),
+          m_height(height),
+          m_bytes_per_pixel(bytes_per_pixel),
+          m_flip_rows(flip_rows),
+          m_flip_columns(flip_columns),
+          m_bgr(bgr)
+    {
+        if(!isDirect() && bgr)
+            m_scratch.resize(width * bytes_per_pixel);
+    }
+
+    bool isValid() const
+    {
+        return m_dst.data != nullptr
+               && (m_dst.bytes_per_pixel == m_bytes_per_pixel || m_dst.bytes_per_pixel == 4);
+    }
+    bool isDirect() const { return m_dst.bytes_per_pixel == m_bytes_per_pixel; }   // no format conversion
+
+    uint8_t * getRow(uint32_t file_row) const
+    {
+        uint32_t const y = m_flip_rows ? m_height - 1 - file_row : file_row;
+        return m_dst.data + static_cast<ptrdiff_t>(y) * m_dst.stride;
+    }
+
+    // src may be getRow(file_row) of a direct sink
+    void storeRow(uint32_t file_row, uint8_t const * src)
+    {
+        uint8_t * row = getRow(file_row);
+
+        if(isDirect())
+        {
+            if(m_bgr)
+                PixelOps::SwapRB(src, row, m_width, m_bytes_per_pixel);
+            else if(src != row)
+                std::memcpy(row, src, m_width * m_bytes_per_pixel);
+        }
+        else
+        {
+            if(m_bgr)
+            {
+                PixelOps::SwapRB(src, m_scratch.data(), m_width, m_bytes_per_pixel);
+                src = m_scratch.data();
+            }
+
+            if(m_dst.coverage_alpha)
+                PixelOps::CoverageToRGBA(src, row, m_width);
+            else
+                PixelOps::RGBToRGBA(src, row, m_width);
+        }
+
+        if(m_flip_columns)
+            PixelOps::FlipHorizontal(row, m_width, 1, m_dst.bytes_per_pixel);
+    }
+
+private:
+    ImageDestination     m_dst;
+    uint32_t             m_width;
+    uint32_t             m_height;
+    uint32_t             m_bytes_per_pixel;
+    bool                 m_flip_rows;
+    bool                 m_flip_columns;
+    bool                 m_bgr;
+    std::vector<uint8_t> m_scratch;
+};
+
 //==============================================================================
 //         Read BMP section
 //==============================================================================
-bool ReadBMPData(uint8_t * buffer, size_t file_size, ImageData & image);
+// pixel layout of a BMP file
+struct BMPLayout
+{
+    uint32_t        width           = 0;
+    uint32_t        height          = 0;
+    uint32_t        bytes_per_pixel = 0;
+    uint32_t        line_length     = 0;       // rows are aligned to 4 bytes
+    bool            alpha_first     = false;   // bitfield images: ABGR
+    bool            flip            = false;
+    uint8_t const * pixels          = nullptr;
+};
+
+bool ParseBMPHeader(uint8_t const * buffer, size_t file_size, BMPLayout & layout);
+bool ReadBMPPixels(BMPLayout const & layout, ImageDestination const & dst);
+bool ReadBMPData(uint8_t const * buffer, size_t file_size, ImageData & image);
 
 bool ReadBMP(std::string const & file_name, ImageData & image)
 {
@@ -110,47 +263,48 @@ bool ReadBMP(BaseFile const & file, ImageData & image)
     if(file.empty())
         return false;
 
-    auto * buffer      = const_cast<uint8_t *>(reinterpret_cast<uint8_t const *>(file.getData()));
+    auto * buffer      = reinterpret_cast<uint8_t const *>(file.getData());
     size_t file_length = file.getFileSize();
 
     return ReadBMPData(buffer, file_length, image);
 }
 
-bool ReadBMPData(uint8_t * buffer, size_t file_size, ImageData & image)
+bool ParseBMPHeader(uint8_t const * buffer, size_t file_size, BMPLayout & layout)
 {
     bool compressed = false;
-    bool flip       = false;
 
-    auto *             p_ptr    = buffer;
-    BITMAPFILEHEADER * p_header = reinterpret_cast<BITMAPFILEHEADER *>(p_ptr);
+    if(file_size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFO12))
+        return false;
+
+    auto const *             p_ptr    = buffer;
+    BITMAPFILEHEADER const * p_header = reinterpret_cast<BITMAPFILEHEADER const *>(p_ptr);
     p_ptr += sizeof(BITMAPFILEHEADER);
     if(p_header->bf_size != file_size || p_header->bf_type != 0x4D42)   // little-endian
         return false;
 
-    if(reinterpret_cast<uint32_t *>(p_ptr)[0] == 12)
+    if(reinterpret_cast<uint32_t const *>(p_ptr)[0] == 12)
     {
-        BITMAPINFO12 * p_info = reinterpret_cast<BITMAPINFO12 *>(p_ptr);
+        BITMAPINFO12 const * p_info = reinterpret_cast<BITMAPINFO12 const *>(p_ptr);
 
         if(p_info->bi_bit_count != 24 && p_info->bi_bit_count != 32)
             return false;
 
-        if(p_info->bi_bit_count == 24)
-            image.type = ImageData::PixelType::pt_rgb;
-        else
-            image.type = ImageData::PixelType::pt_rgba;
-
-        image.width = p_info->bi_width;
+        layout.bytes_per_pixel = p_info->bi_bit_count / 8;
+        layout.width           = p_info->bi_width;
 
         // flip для BITMAPINFO12
         if(static_cast<int16_t>(p_info->bi_height) < 0)
-            flip = false;
+            layout.flip = false;
         else
-            flip = true;
-        image.height = static_cast<uint32_t>(std::abs(static_cast<int16_t>(p_info->bi_height)));
+            layout.flip = true;
+        layout.height = static_cast<uint32_t>(std::abs(static_cast<int16_t>(p_info->bi_height)));
     }
     else
     {
-        BITMAPINFO * p_info = reinterpret_cast<BITMAPINFO *>(p_ptr);
+        if(file_size < sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFO))
+            return false;
+
+        BITMAPINFO const * p_info = reinterpret_cast<BITMAPINFO const *>(p_ptr);
 
         if(p_info->bi_bit_count != 24 && p_info->bi_bit_count != 32)
             return false;
@@ -165,89 +319,76 @@ bool ReadBMPData(uint8_t * buffer, size_t file_size, ImageData & image)
             compressed = true;
         }
 
-        if(p_info->bi_bit_count == 24)
-            image.type = ImageData::PixelType::pt_rgb;
-        else
-            image.type = ImageData::PixelType::pt_rgba;
-
-        image.width = static_cast<uint32_t>(p_info->bi_width);
+        layout.bytes_per_pixel = p_info->bi_bit_count / 8;
+        layout.width           = static_cast<uint32_t>(p_info->bi_width);
 
         if(p_info->bi_height < 0)
-            flip = false;
+            layout.flip = false;
         else
-            flip = true;
-        image.height = static_cast<uint32_t>(std::abs(p_info->bi_height));
+            layout.flip = true;
+        layout.height = static_cast<uint32_t>(std::abs(p_info->bi_height));
     }
 
-    // read data:
-    p_ptr                    = buffer + p_header->bf_off_bits;
-    uint32_t line_length     = 0;
-    uint32_t bytes_per_pixel = (image.type == ImageData::PixelType::pt_rgb ? 3 : 4);
-    image.data_size          = image.width * image.height * bytes_per_pixel;
-    auto     data            = std::make_unique<uint8_t[]>(image.data_size);
-    uint8_t  red, green, blue, alpha{255};
-    uint32_t w_ind(0), h_ind(0);
-
-    line_length = ((image.width * bytes_per_pixel + 3) / 4) * 4;
+    layout.alpha_first = compressed && layout.bytes_per_pixel == 4;
+    layout.line_length = ((layout.width * layout.bytes_per_pixel + 3) / 4) * 4;
+    layout.pixels      = buffer + p_header->bf_off_bits;
 
-    for(uint32_t i = 0; i < image.height; ++i)
-    {
-        w_ind = 0;
-        for(uint32_t j = 0; j < line_length; j += bytes_per_pixel)
-        {
-            if(w_ind >= image.width)
-                break;
+    return p_header->bf_off_bits + static_cast<size_t>(layout.line_length) * layout.height <= file_size;
+}
 
-            if(compressed)
-            {
-                uint32_t count = 0;
-                if(image.type == ImageData::PixelType::pt_rgba)
-                {
-                    alpha = p_ptr[i * line_length + j + count];
-                    count++;
-                }
-                blue = p_ptr[i * line_length + j + count];
-                count++;
-                green = p_ptr[i * line_length + j + count];
-                count++;
-                red = p_ptr[i * line_length + j + count];
-            }
-            else
-            {
-                blue  = p_ptr[i * line_length + j + 0];
-                green = p_ptr[i * line_length + j + 1];
-                red   = p_ptr[i * line_length + j + 2];
-                if(image.type == ImageData::PixelType::pt_rgba)   // !!!Not supported - the high byte in each
-                                                                  // DWORD is not used
-                    // https://msdn.microsoft.com/en-us/library/windows/desktop/dd183376(v=vs.85).aspx
-                    alpha = p_ptr[i * line_length + j + 3];
-            }
+bool ReadBMPPixels(BMPLayout const & layout, ImageDestination const & dst)
+{
+    RowSink sink(dst, layout.width, layout.height, layout.bytes_per_pixel, layout.flip, false);
+    if(!sink.isValid())
+        return false;
 
-            data[h_ind * image.width * bytes_per_pixel + w_ind * bytes_per_pixel + 0] = red;
-            data[h_ind * image.width * bytes_per_pixel + w_ind * bytes_per_pixel + 1] = green;
-            data[h_ind * image.width * bytes_per_pixel + w_ind * bytes_per_pixel + 2] = blue;
-            if(image.type == ImageData::PixelType::pt_rgba)
-                data[h_ind * image.width * bytes_per_pixel + w_ind * bytes_per_pixel + 3] = alpha;
-            w_ind++;
-        }
-        h_ind++;
-    }
+    std::vector<uint8_t> row(layout.alpha_first ? layout.width * 4 : 0);
 
-    // flip image if necessary
-    if(flip)
+    // bottom-up files are flipped while the rows are converted
+    for(uint32_t i = 0; i < layout.height; ++i)
     {
-        auto temp_buf = std::make_unique<uint8_t[]>(image.width * image.height * bytes_per_pixel);
+        uint8_t const * src = layout.pixels + i * layout.line_length;
 
-        for(uint32_t i = 0; i < image.height; i++)
+        if(!layout.alpha_first)
         {
-            std::memcpy(temp_buf.get() + i * image.width * bytes_per_pixel,
-                        data.get() + (image.height - 1 - i) * image.width * bytes_per_pixel,
-                        image.width * bytes_per_pixel);
+            sink.storeRow(i, src);
+            continue;
         }
 
-        data = std::move(temp_buf);
+        // ABGR -> BGRA
+        for(uint32_t j = 0; j < layout.width * 4; j += 4)
+        {
+            row[j + 0] = src[j + 1];
+            row[j + 1] = src[j + 2];
+            row[j + 2] = src[j + 3];
+            row[j + 3] = src[j + 0];
+        }
+        sink.storeRow(i, row.data());
     }
 
+    return true;
+}
+
+bool ReadBMPData(uint8_t const * buffer, size_t file_size, ImageData & image)
+{
+    BMPLayout layout;
+    if(!ParseBMPHeader(buffer, file_size, layout))
+        return false;
+
+    image.width     = layout.width;
+    image.height    = layout.height;
+    image.type = layout.bytes_per_pixel == 3 ? ImageData::PixelType::pt_rgb : ImageData::PixelType::pt_rgba;
+    image.data_size = image.width * image.height * layout.bytes_per_pixel;
+
+    auto data = std::make_unique<uint8_t[]>(image.data_size);
+
+    ImageDestination dst;
+    dst.data            = data.get();
+    dst.stride          = image.width * layout.bytes_per_pixel;
+    dst.bytes_per_pixel = layout.bytes_per_pixel;
+    if(!ReadBMPPixels(layout, dst))
+        return false;
+
     image.data = std::move(data);
 
     return true;
@@ -301,40 +442,78 @@ bool WriteTGA(std::string file_name, ImageData const & image)
     return true;
 }
 
-bool ReadRawTGAData(ImageData & image, uint8_t * buffer);
-bool ReadUncompressedTGA(ImageData & image, uint8_t * data);
-bool ReadCompressedTGA(ImageData & image, uint8_t * data);
-
-bool ReadTGA(std::string const & file_name, ImageData & image)
+// sequential reader over a file already loaded in memory, same interface as InputFileStream
+struct BufferReader
 {
-    std::ifstream        ifile(file_name, std::ios::binary);
-    std::vector<uint8_t> file;
+    uint8_t const * data = nullptr;
+    size_t          size = 0;
+    size_t          pos  = 0;
 
-    if(ifile.is_open())
+    bool read(void * out_data, size_t byte_count)
     {
-        ifile.seekg(0, std::ios_base::end);
-        auto length = ifile.tellg();
-        ifile.seekg(0, std::ios_base::beg);
-
-        file.resize(static_cast<size_t>(length));
-
-        ifile.read(reinterpret_cast<char *>(file.data()), length);
+        if(pos + byte_count > size)
+            return false;
 
-        auto success = !ifile.fail() && length == ifile.gcount();
-        ifile.close();
+        std::memcpy(out_data, data + pos, byte_count);
+        pos += byte_count;
+        return true;
+    }
 
-        if(!success)
-            return false;
+    bool skip(size_t byte_count)
+    {
+        pos += byte_count;
+        return pos <= size;
     }
-    else
+};
+
+static bool ReadWholeFile(std::string const & file_name, std::vector<uint8_t> & file)
+{
+    std::ifstream ifile(file_name, std::ios::binary);
+    if(!ifile.is_open())
         return false;
 
-    if(file.size() == 0)
+    ifile.seekg(0, std::ios_base::end);
+    auto length = ifile.tellg();
+    ifile.seekg(0, std::ios_base::beg);
+
+    file.resize(static_cast<size_t>(length));
+
+    ifile.read(reinterpret_cast<char *>(file.data()), length);
+
+    return !ifile.fail() && length == ifile.gcount();
+}
+
+// pixel layout of a TGA file
+struct TGALayout
+{
+    uint32_t width           = 0;
+    uint32_t height          = 0;
+    uint32_t bytes_per_pixel = 0;
+    bool     compressed      = false;   // run-length encoded
+    bool     flip_horizontal = false;
+    bool     flip_vertical   = false;
+};
+
+template<typename Stream>
+bool ReadTGAHeader(Stream & stream, TGALayout & layout);
+template<typename Stream>
+bool ReadTGAPixels(Stream & stream, TGALayout const & layout, ImageDestination const & dst);
+template<typename Stream>
+bool ReadTGAData(Stream & stream, ImageData & image);
+template<typename Stream>
+bool ReadUncompressedTGA(Stream & stream, TGALayout const & layout, RowSink & sink);
+template<typename Stream>
+bool ReadCompressedTGA(Stream & stream, TGALayout const & layout, RowSink & sink);
+
+bool ReadTGA(std::string const & file_name, ImageData & image)
+{
+    std::vector<uint8_t> file;
+    if(!ReadWholeFile(file_name, file) || file.empty())
         return false;
 
-    auto * buffer = file.data();
+    BufferReader reader{file.data(), file.size()};
 
-    return ReadRawTGAData(image, buffer);
+    return ReadTGAData(reader, image);
 }
 
 bool ReadTGA(BaseFile const & file, ImageData & image)
@@ -342,17 +521,27 @@ bool ReadTGA(BaseFile const & file, ImageData & image)
     if(file.empty())
         return false;
 
-    auto * buffer = const_cast<uint8_t *>(reinterpret_cast<uint8_t const *>(file.getData()));
+    BufferReader reader{reinterpret_cast<uint8_t const *>(file.getData()), file.getFileSize()};
+
+    return ReadTGAData(reader, image);
+}
+
+bool ReadTGA(InputFileStream & stream, ImageData & image)
+{
+    if(stream.getSize() == 0)
+        return false;
 
-    return ReadRawTGAData(image, buffer);
+    return ReadTGAData(stream, image);
 }
 
-bool ReadRawTGAData(ImageData & image, uint8_t * buffer)
+template<typename Stream>
+bool ReadTGAHeader(Stream & stream, TGALayout & layout)
 {
-    uint8_t *   data     = buffer;
-    TGAHEADER * p_header = reinterpret_cast<TGAHEADER *>(data);
+    TGAHEADER header;
+    if(!stream.read(&header, sizeof(TGAHEADER)))
+        return false;
 
-    data += sizeof(TGAHEADER);
+    TGAHEADER const * p_header = &header;
     if((p_header->width == 0) || (p_header->height == 0)
        || ((p_header->bitsperpixel != 24)
            && (p_header->bitsperpixel != 32)))   // Make sure all information is valid
@@ -360,151 +549,864 @@ bool ReadRawTGAData(ImageData & image, uint8_t * buffer)
         return false;
     }
 
-    image.width  = p_header->width;
-    image.height = p_header->height;
-    image.type = p_header->bitsperpixel == 24 ? ImageData::PixelType::pt_rgb : ImageData::PixelType::pt_rgba;
-    bool flip_horizontal = (p_header->imagedescriptor & 0x10);
-    bool flip_vertical   = (p_header->imagedescriptor & 0x20);
+    if(p_header->datatypecode != 2 && p_header->datatypecode != 10)
+        return false;
+
+    // image id field
+    if(p_header->idlength != 0 && !stream.skip(p_header->idlength))
+        return false;
+
+    layout.width           = p_header->width;
+    layout.height          = p_header->height;
+    layout.bytes_per_pixel = p_header->bitsperpixel / 8;
+    layout.compressed      = p_header->datatypecode == 10;
+    layout.flip_horizontal = (p_header->imagedescriptor & 0x10);
+    layout.flip_vertical   = (p_header->imagedescriptor & 0x20);
+
+    return true;
+}
+
+template<typename Stream>
+bool ReadTGAPixels(Stream & stream, TGALayout const & layout, ImageDestination const & dst)
+{
+    RowSink sink(dst, layout.width, layout.height, layout.bytes_per_pixel, layout.flip_vertical,
+                 layout.flip_horizontal);
+    if(!sink.isValid())
+        return false;
+
+    if(layout.compressed)
+        return ReadCompressedTGA(stream, layout, sink);
+
+    return ReadUncompressedTGA(stream, layout, sink);
+}
+
+template<typename Stream>
+bool ReadTGAData(Stream & stream, ImageData & image)
+{
+    TGALayout layout;
+    if(!ReadTGAHeader(stream, layout))
+        return false;
+
+    image.width     = layout.width;
+    image.height    = layout.height;
+    image.type = layout.bytes_per_pixel == 3 ? ImageData::PixelType::pt_rgb : ImageData::PixelType::pt_rgba;
+    image.data_size = image.width * image.height * layout.bytes_per_pixel;
 
-    uint32_t bytes_per_pixel = p_header->bitsperpixel / 8;
-    image.data_size          = image.width * image.height * bytes_per_pixel;
+    auto data = std::make_unique<uint8_t[]>(image.data_size);
 
-    if(p_header->datatypecode == 2)
+    ImageDestination dst;
+    dst.data            = data.get();
+    dst.stride          = image.width * layout.bytes_per_pixel;
+    dst.bytes_per_pixel = layout.bytes_per_pixel;
+    if(!ReadTGAPixels(stream, layout, dst))
+        return false;
+
+    image.data = std::move(data);
+
+    return true;
+}
+
+template<typename Stream>
+bool ReadUncompressedTGA(Stream & stream, TGALayout const & layout, RowSink & sink)
+{
+    uint32_t const       row_size = layout.width * layout.bytes_per_pixel;
+    std::vector<uint8_t> row(sink.isDirect() ? 0 : row_size);
+
+    // rows of the same format are read straight into the destination and converted in place
+    for(uint32_t i = 0; i < layout.height; ++i)
     {
-        if(!ReadUncompressedTGA(image, data))
+        uint8_t * target = sink.isDirect() ? sink.getRow(i) : row.data();
+        if(!stream.read(target, row_size))
             return false;
+
+        sink.storeRow(i, target);
     }
-    else if(p_header->datatypecode == 10)
+
+    return true;
+}
+
+template<typename Stream>
+bool ReadCompressedTGA(Stream & stream, TGALayout const & layout, RowSink & sink)
+{
+    uint32_t const       bytes_per_pixel = layout.bytes_per_pixel;
+    uint32_t const       pixel_count     = layout.height * layout.width;
+    uint32_t             current_pixel   = 0;
+    uint32_t             row_pixel       = 0;
+    uint32_t             row_index       = 0;
+    std::vector<uint8_t> row(layout.width * bytes_per_pixel);
+    uint8_t              packet[128 * 4];
+
+    do
     {
-        if(!ReadCompressedTGA(image, data))
+        uint8_t chunk = 0;
+        if(!stream.read(&chunk, 1))
             return false;
-    }
 
-    if(flip_vertical)
-    {
-        auto flipped_image = std::make_unique<uint8_t[]>(image.data_size);
+        if(chunk >= 128)
+        {
+            // run-length packet: one pixel repeated
+            chunk -= 127;
+            if(current_pixel + chunk > pixel_count || !stream.read(packet, bytes_per_pixel))
+                return false;
 
-        for(uint32_t i = 0; i < image.height; i++)
+            for(uint16_t counter = 1; counter < chunk; counter++)
+                std::memcpy(packet + counter * bytes_per_pixel, packet, bytes_per_pixel);
+        }
+        else
         {
-            std::memcpy(flipped_image.get() + i * image.width * bytes_per_pixel,
-                        image.data.get() + (image.height - 1 - i) * image.width * bytes_per_pixel,
-                        image.width * bytes_per_pixel);
+            // raw packet
+            chunk++;
+            if(current_pixel + chunk > pixel_count || !stream.read(packet, chunk * bytes_per_pixel))
+                return false;
         }
 
-        image.data = std::move(flipped_image);
+        // packets may cross the row ends
+        uint8_t const * src = packet;
+        for(uint32_t left = chunk; left > 0;)
+        {
+            uint32_t const count = std::min(left, layout.width - row_pixel);
+            std::memcpy(row.data() + row_pixel * bytes_per_pixel, src, count * bytes_per_pixel);
+            src += count * bytes_per_pixel;
+            left -= count;
+            row_pixel += count;
+
+            if(row_pixel == layout.width)
+            {
+                sink.storeRow(row_index++, row.data());
+                row_pixel = 0;
+            }
+        }
+        current_pixel += chunk;
+    } while(current_pixel < pixel_count);
+
+    return true;
+}
+
+//==============================================================================
+//         PNG section
+//==============================================================================
+// pixel layout of a PNG file from its IHDR, PLTE and tRNS chunks
+struct PNGLayout
+{
+    uint32_t                     width           = 0;
+    uint32_t                     height          = 0;
+    uint32_t                     bytes_per_pixel = 0;   // of the decoded image, 3 or 4
+    uint32_t                     bit_depth       = 0;
+    uint32_t                     color_type      = 0;
+    uint32_t                     idat_size       = 0;   // first IDAT chunk, its header is already read
+    std::array<uint8_t, 256 * 4> palette         = {};   // RGBA
+};
+
+static constexpr uint8_t PNGSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+// PNG IHDR allows 2^31 - 1, DDS and KTX 2^32 - 1: larger images are rejected before anything is allocated
+static constexpr uint32_t MaxImageDimension = 16384;
+
+static uint32_t ReadBigEndian32(uint8_t const * data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+           | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+template<typename Stream>
+static bool ReadPNGChunkHeader(Stream & stream, uint32_t & size, char (&type)[4])
+{
+    uint8_t header[8];
+    if(!stream.read(header, sizeof(header)))
+        return false;
+
+    size = ReadBigEndian32(header);
+    std::memcpy(type, header + 4, 4);
+
+    return size <= 0x7FFFFFFFu;
+}
+
+static uint32_t GetPNGChannels(uint32_t color_type)
+{
+    switch(color_type)
+    {
+        case 0: return 1;   // gray
+        case 2: return 3;   // RGB
+        case 3: return 1;   // palette
+        case 4: return 2;   // gray, alpha
+        case 6: return 4;   // RGBA
+        default: return 0;
     }
+}
 
-    if(flip_horizontal)
+template<typename Stream>
+bool ReadPNGHeader(Stream & stream, PNGLayout & layout)
+{
+    uint8_t signature[8];
+    if(!stream.read(signature, sizeof(signature)) || std::memcmp(signature, PNGSignature, sizeof(signature)))
+        return false;
+
+    uint32_t size = 0;
+    char     type[4];
+    uint8_t  ihdr[13];
+    if(!ReadPNGChunkHeader(stream, size, type) || std::memcmp(type, "IHDR", 4) || size != sizeof(ihdr)
+       || !stream.read(ihdr, sizeof(ihdr)) || !stream.skip(4))
+        return false;
+
+    layout.width      = ReadBigEndian32(ihdr);
+    layout.height     = ReadBigEndian32(ihdr + 4);
+    layout.bit_depth  = ihdr[8];
+    layout.color_type = ihdr[9];
+
+    uint32_t const channels = GetPNGChannels(layout.color_type);
+    bool const     low_depth = layout.bit_depth == 1 || layout.bit_depth == 2 || layout.bit_depth == 4;
+    bool const     valid_depth = layout.bit_depth == 8 || layout.bit_depth == 16
+                             || (low_depth && (layout.color_type == 0 || layout.color_type == 3));
+    // compression and filter methods 0, Adam7 interlaced files are not supported
+    if(layout.width == 0 || layout.height == 0 || layout.width > MaxImageDimension
+       || layout.height > MaxImageDimension || channels == 0 || !valid_depth || ihdr[10] != 0 || ihdr[11] != 0
+       || ihdr[12] != 0 || (layout.color_type == 3 && layout.bit_depth == 16))
+        return false;
+
+    bool has_palette = false;
+    bool has_alpha   = layout.color_type == 4 || layout.color_type == 6;
+
+    // the chunks before the image data
+    while(ReadPNGChunkHeader(stream, size, type))
     {
-        auto flipped_image = std::make_unique<uint8_t[]>(image.data_size);
+        if(!std::memcmp(type, "IDAT", 4))
+        {
+            if(layout.color_type == 3 && !has_palette)
+                return false;
+
+            layout.idat_size       = size;
+            layout.bytes_per_pixel = has_alpha ? 4 : 3;
+            return true;
+        }
 
-        for(uint32_t i = 0; i < image.height; i++)
+        if(!std::memcmp(type, "IEND", 4))
+            return false;
+
+        if(!std::memcmp(type, "PLTE", 4))
         {
-            for(uint32_t j = 0; j < image.width; j++)
+            uint8_t rgb[256 * 3];
+            if(size % 3 != 0 || size > sizeof(rgb) || !stream.read(rgb, size))
+                return false;
+
+            for(uint32_t i = 0; i < size / 3; ++i)
             {
-                flipped_image[image.width * bytes_per_pixel * i + j * bytes_per_pixel + 0] =
-                    image.data[image.width * bytes_per_pixel * i + (image.width - j - 1) * bytes_per_pixel
-                               + 0];
-                flipped_image[image.width * bytes_per_pixel * i + j * bytes_per_pixel + 1] =
-                    image.data[image.width * bytes_per_pixel * i + (image.width - j - 1) * bytes_per_pixel
-                               + 1];
-                flipped_image[image.width * bytes_per_pixel * i + j * bytes_per_pixel + 2] =
-                    image.data[image.width * bytes_per_pixel * i + (image.width - j - 1) * bytes_per_pixel
-                               + 2];
-                if(image.type == ImageData::PixelType::pt_rgba)
-                    flipped_image[image.width * bytes_per_pixel * i + j * bytes_per_pixel + 3] =
-                        image.data[image.width * bytes_per_pixel * i + (image.width - j - 1) * bytes_per_pixel
-                                   + 3];
+                std::memcpy(&layout.palette[i * 4], rgb + i * 3, 3);
+                layout.palette[i * 4 + 3] = 255;
             }
+            has_palette = true;
+        }
+        else if(!std::memcmp(type, "tRNS", 4) && layout.color_type == 3)
+        {
+            // palette alpha, the color keys of gray and RGB images are ignored
+            uint8_t alpha[256];
+            if(size > sizeof(alpha) || !stream.read(alpha, size))
+                return false;
+
+            for(uint32_t i = 0; i < size; ++i)
+                layout.palette[i * 4 + 3] = alpha[i];
+            has_alpha = true;
+        }
+        else if(!stream.skip(size))
+        {
+            return false;
         }
 
-        image.data = std::move(flipped_image);
+        if(!stream.skip(4))   // crc
+            return false;
     }
 
-    return true;
+    return false;
 }
 
-bool ReadUncompressedTGA(ImageData & image, uint8_t * data)
+static bool UnfilterPNGRow(uint8_t * row, uint8_t const * prev, size_t size, size_t bytes_per_pixel)
 {
-    uint32_t bytes_per_pixel = image.type == ImageData::PixelType::pt_rgb ? 3 : 4;
-    auto     img             = std::make_unique<uint8_t[]>(image.data_size);
+    // the first byte of the rows is the filter type
+    uint8_t const filter = row[0];
+    ++row;
+    ++prev;
+
+    switch(filter)
+    {
+        case 0:
+            break;
+        case 1:   // sub
+            for(size_t i = bytes_per_pixel; i < size; ++i)
+                row[i] = static_cast<uint8_t>(row[i] + row[i - bytes_per_pixel]);
+            break;
+        case 2:   // up
+            for(size_t i = 0; i < size; ++i)
+                row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+            break;
+        case 3:   // average
+            for(size_t i = 0; i < size; ++i)
+            {
+                uint32_t const left = i >= bytes_per_pixel ? row[i - bytes_per_pixel] : 0;
+                row[i]              = static_cast<uint8_t>(row[i] + ((left + prev[i]) >> 1));
+            }
+            break;
+        case 4:   // paeth
+            for(size_t i = 0; i < size; ++i)
+            {
+                int32_t const a  = i >= bytes_per_pixel ? row[i - bytes_per_pixel] : 0;
+                int32_t const b  = prev[i];
+                int32_t const c  = i >= bytes_per_pixel ? prev[i - bytes_per_pixel] : 0;
+                int32_t const p  = a + b - c;
+                int32_t const pa = std::abs(p - a);
+                int32_t const pb = std::abs(p - b);
+                int32_t const pc = std::abs(p - c);
+
+                int32_t const predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+                row[i]                  = static_cast<uint8_t>(row[i] + predictor);
+            }
+            break;
+        default:
+            return false;
+    }
 
-    for(uint32_t i = 0; i < image.width * image.height; ++i)
+    return true;
+}
+
+// unfiltered row -> 8-bit RGB(A)
+static void ExpandPNGRow(uint8_t const * src, uint8_t * dst, PNGLayout const & layout)
+{
+    uint32_t const depth    = layout.bit_depth;
+    uint32_t const channels = GetPNGChannels(layout.color_type);
+    uint32_t const max      = (1u << std::min(depth, 8u)) - 1;
+
+    // n-th sample of the row
+    auto sample = [src, depth, max](size_t n) -> uint32_t {
+        if(depth == 8)
+            return src[n];
+        if(depth == 16)
+            return src[n * 2];   // high byte
+
+        size_t const bit = n * depth;
+        return (src[bit / 8] >> (8 - depth - bit % 8)) & max;
+    };
+    // gray levels of low bit depths are scaled to 0-255
+    uint32_t const scale = layout.color_type == 3 || depth >= 8 ? 1 : 255 / max;
+
+    for(uint32_t x = 0; x < layout.width; ++x, dst += layout.bytes_per_pixel)
     {
-        uint8_t red, green, blue, alpha;
+        size_t const n = x * channels;
+        if(layout.color_type == 3)
+        {
+            std::memcpy(dst, &layout.palette[sample(n) * 4], layout.bytes_per_pixel);
+            continue;
+        }
 
-        red   = data[i * bytes_per_pixel + 2];
-        green = data[i * bytes_per_pixel + 1];
-        blue  = data[i * bytes_per_pixel + 0];
-        if(image.type == ImageData::PixelType::pt_rgba)
-            alpha = data[i * bytes_per_pixel + 3];
+        if(channels <= 2)
+        {
+            uint8_t const gray = static_cast<uint8_t>(sample(n) * scale);
+            dst[0] = dst[1] = dst[2] = gray;
+        }
+        else
+        {
+            dst[0] = static_cast<uint8_t>(sample(n + 0));
+            dst[1] = static_cast<uint8_t>(sample(n + 1));
+            dst[2] = static_cast<uint8_t>(sample(n + 2));
+        }
 
-        img[i * bytes_per_pixel + 0] = red;
-        img[i * bytes_per_pixel + 1] = green;
-        img[i * bytes_per_pixel + 2] = blue;
-        if(image.type == ImageData::PixelType::pt_rgba)
-            img[i * bytes_per_pixel + 3] = alpha;
+        if(layout.bytes_per_pixel == 4)
+            dst[3] = static_cast<uint8_t>(sample(n + channels - 1));
     }
+}
 
-    image.data = std::move(img);
+struct InflateStream
+{
+    InflateStream() { valid = inflateInit(&stream) == Z_OK; }
+    ~InflateStream()
+    {
+        if(valid)
+            inflateEnd(&stream);
+    }
 
-    return true;
-}
+    InflateStream(InflateStream const &)             = delete;
+    InflateStream & operator=(InflateStream const &) = delete;
 
-bool ReadCompressedTGA(ImageData & image, uint8_t * data)
+    z_stream stream = {};
+    bool     valid  = false;
+};
+
+// The IDAT data is inflated row by row while the chunks are read, the stream is never held in memory
+template<typename Stream>
+bool ReadPNGPixels(Stream & stream, PNGLayout const & layout, ImageDestination const & dst)
 {
-    uint32_t bytes_per_pixel = image.type == ImageData::PixelType::pt_rgb ? 3 : 4;
-    auto     img             = std::make_unique<uint8_t[]>(image.data_size);
-    uint32_t pixel_count     = image.height * image.width;
-    uint32_t current_pixel   = 0;
-    uint32_t current_byte    = 0;
+    // PNG rows are stored top-down
+    RowSink sink(dst, layout.width, layout.height, layout.bytes_per_pixel, true, false, false);
+    if(!sink.isValid())
+        return false;
 
-    do
+    uint32_t const bits_per_pixel  = GetPNGChannels(layout.color_type) * layout.bit_depth;
+    size_t const   filter_bytes    = std::max(bits_per_pixel / 8, 1u);
+    size_t const   row_size        = (static_cast<size_t>(layout.width) * bits_per_pixel + 7) / 8;
+    bool const     needs_expansion = layout.bit_depth != 8 || layout.color_type == 0 || layout.color_type == 3
+                                 || layout.color_type == 4;
+
+    std::vector<uint8_t> rows((row_size + 1) * 2, 0);   // previous and current row with the filter byte
+    std::vector<uint8_t> expanded(needs_expansion ? layout.width * layout.bytes_per_pixel : 0);
+    uint8_t *            prev = rows.data();
+    uint8_t *            cur  = rows.data() + row_size + 1;
+
+    InflateStream inflater;
+    if(!inflater.valid)
+        return false;
+
+    z_stream & zs = inflater.stream;
+    uint8_t    input[16 * 1024];
+    uint32_t   idat_left = layout.idat_size;
+
+    for(uint32_t y = 0; y < layout.height; ++y)
     {
-        uint8_t chunk = data[0];
-        data++;
+        zs.next_out  = cur;
+        zs.avail_out = static_cast<uInt>(row_size + 1);
 
-        if(chunk >= 128)
+        while(zs.avail_out > 0)
         {
-            chunk -= 127;
-            for(uint16_t counter = 0; counter < chunk; counter++)
+            if(zs.avail_in == 0)
             {
-                if(current_pixel >= pixel_count)
-                    return false;
+                // next IDAT chunk, the data may be split into any number of them
+                while(idat_left == 0)
+                {
+                    char type[4];
+                    if(!stream.skip(4) || !ReadPNGChunkHeader(stream, idat_left, type)
+                       || std::memcmp(type, "IDAT", 4))
+                        return false;
+                }
 
-                img[current_byte + 0] = data[2];
-                img[current_byte + 1] = data[1];
-                img[current_byte + 2] = data[0];
-                if(image.type == ImageData::PixelType::pt_rgba)
-                    img[current_byte + 3] = data[3];
+                uint32_t const size = std::min<uint32_t>(idat_left, sizeof(input));
+                if(!stream.read(input, size))
+                    return false;
 
-                current_byte += bytes_per_pixel;
-                current_pixel++;
+                idat_left -= size;
+                zs.next_in  = input;
+                zs.avail_in = size;
             }
-            data += bytes_per_pixel;
+
+            int const result = inflate(&zs, Z_NO_FLUSH);
+            if(result != Z_OK && !(result == Z_STREAM_END && zs.avail_out == 0))
+                return false;
+        }
+
+        if(!UnfilterPNGRow(cur, prev, row_size, filter_bytes))
+            return false;
+
+        if(needs_expansion)
+        {
+            ExpandPNGRow(cur + 1, expanded.data(), layout);
+            sink.storeRow(y, expanded.data());
         }
         else
         {
-            chunk++;
-            for(uint16_t counter = 0; counter < chunk; counter++)
-            {
-                if(current_pixel >= pixel_count)
-                    return false;
+            sink.storeRow(y, cur + 1);
+        }
 
-                img[current_byte + 0] = data[2];
-                img[current_byte + 1] = data[1];
-                img[current_byte + 2] = data[0];
-                if(image.type == ImageData::PixelType::pt_rgba)
-                    img[current_byte + 3] = data[3];
+        std::swap(prev, cur);
+    }
 
-                current_byte += bytes_per_pixel;
-                current_pixel++;
-                data += bytes_per_pixel;
-            }
+    return true;
+}
+
+template<typename Stream>
+bool ReadPNGData(Stream & stream, ImageData & image)
+{
+    PNGLayout layout;
+    if(!ReadPNGHeader(stream, layout))
+        return false;
+
+    // computed in size_t, the size has to fit ImageData::data_size
+    size_t const stride    = static_cast<size_t>(layout.width) * layout.bytes_per_pixel;
+    size_t const data_size = stride * layout.height;
+    if(data_size > std::numeric_limits<uint32_t>::max())
+        return false;
+
+    image.width     = layout.width;
+    image.height    = layout.height;
+    image.type = layout.bytes_per_pixel == 3 ? ImageData::PixelType::pt_rgb : ImageData::PixelType::pt_rgba;
+    image.data_size = static_cast<uint32_t>(data_size);
+
+    auto data = std::make_unique<uint8_t[]>(data_size);
+
+    ImageDestination dst;
+    dst.data            = data.get();
+    dst.stride          = static_cast<ptrdiff_t>(stride);
+    dst.bytes_per_pixel = layout.bytes_per_pixel;
+    if(!ReadPNGPixels(stream, layout, dst))
+        return false;
+
+    image.data = std::move(data);
+
+    return true;
+}
+
+bool ReadPNG(std::string const & file_name, ImageData & image)
+{
+    std::vector<uint8_t> file;
+    if(!ReadWholeFile(file_name, file))
+        return false;
+
+    BufferReader reader{file.data(), file.size()};
+
+    return ReadPNGData(reader, image);
+}
+
+bool ReadPNG(BaseFile const & file, ImageData & image)
+{
+    if(file.empty())
+        return false;
+
+    BufferReader reader{reinterpret_cast<uint8_t const *>(file.getData()), file.getFileSize()};
+
+    return ReadPNGData(reader, image);
+}
+
+bool ReadPNG(InputFileStream & stream, ImageData & image)
+{
+    if(stream.getSize() == 0)
+        return false;
+
+    return ReadPNGData(stream, image);
+}
+
+//==============================================================================
+//         DDS and KTX section
+//==============================================================================
+uint32_t GetCompressedSize(ImageData::Compression compression, uint32_t width, uint32_t height)
+{
+    uint32_t block_size = 16;
+    switch(compression)
+    {
+        case ImageData::Compression::cp_none:
+            return 0;
+        case ImageData::Compression::cp_dxt1:
+        case ImageData::Compression::cp_etc2_rgb:
+            block_size = 8;
+            break;
+        default:
+            break;
+    }
+
+    // 4x4 pixel blocks
+    return std::max((width + 3) / 4, 1u) * std::max((height + 3) / 4, 1u) * block_size;
+}
+
+static uint32_t FourCC(char const (&code)[5])
+{
+    return static_cast<uint32_t>(static_cast<uint8_t>(code[0]))
+           | (static_cast<uint32_t>(static_cast<uint8_t>(code[1])) << 8)
+           | (static_cast<uint32_t>(static_cast<uint8_t>(code[2])) << 16)
+           | (static_cast<uint32_t>(static_cast<uint8_t>(code[3])) << 24);
+}
+
+// sets the size of the image and copies mip_levels levels of blocks
+static bool ReadCompressedLevels(uint8_t const * blocks, size_t size, ImageData & image)
+{
+    size_t total = 0;
+    for(uint32_t level = 0; level < image.mip_levels; ++level)
+    {
+        total += GetCompressedSize(image.compression, std::max(image.width >> level, 1u),
+                                   std::max(image.height >> level, 1u));
+    }
+
+    if(total > size || total > std::numeric_limits<uint32_t>::max())
+        return false;
+
+    image.type      = ImageData::PixelType::pt_compressed;
+    image.depth     = 1;
+    image.data_size = static_cast<uint32_t>(total);
+    image.data      = std::make_unique<uint8_t[]>(total);
+    std::memcpy(image.data.get(), blocks, total);
+
+    return true;
+}
+
+static bool ReadDDSData(uint8_t const * data, size_t size, ImageData & image)
+{
+    constexpr uint32_t ddpf_fourcc      = 0x4;
+    constexpr uint32_t ddsd_mipmapcount = 0x20000;
+    constexpr uint32_t ddscaps2_cubemap = 0x200;
+    constexpr uint32_t ddscaps2_volume  = 0x200000;
+    constexpr uint32_t max_mip_levels   = 16;
+
+    if(size < sizeof(DDSHEADER))
+        return false;
+
+    DDSHEADER header;
+    std::memcpy(&header, data, sizeof(header));
+    if(header.magic != FourCC("DDS ") || header.size != sizeof(DDSHEADER) - 4
+       || !(header.ddspf.flags & ddpf_fourcc) || (header.caps2 & (ddscaps2_cubemap | ddscaps2_volume)))
+        return false;
+
+    size_t offset = sizeof(DDSHEADER);
+    auto   format = ImageData::Compression::cp_none;
+    if(header.ddspf.fourcc == FourCC("DXT1"))
+        format = ImageData::Compression::cp_dxt1;
+    else if(header.ddspf.fourcc == FourCC("DXT3"))
+        format = ImageData::Compression::cp_dxt3;
+    else if(header.ddspf.fourcc == FourCC("DXT5"))
+        format = ImageData::Compression::cp_dxt5;
+    else if(header.ddspf.fourcc == FourCC("DX10"))
+    {
+        DDSHEADERDXT10 dx10;
+        if(size < offset + sizeof(dx10))
+            return false;
+
+        std::memcpy(&dx10, data + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+
+        // DXGI_FORMAT_BC1/2/3_UNORM(_SRGB), 2D textures only
+        if(dx10.resource_dimension != 3 || dx10.array_size > 1)
+            return false;
+        if(dx10.dxgi_format == 71 || dx10.dxgi_format == 72)
+            format = ImageData::Compression::cp_dxt1;
+        else if(dx10.dxgi_format == 74 || dx10.dxgi_format == 75)
+            format = ImageData::Compression::cp_dxt3;
+        else if(dx10.dxgi_format == 77 || dx10.dxgi_format == 78)
+            format = ImageData::Compression::cp_dxt5;
+    }
+
+    // GetCompressedSize() is computed in uint32_t
+    if(format == ImageData::Compression::cp_none || header.width == 0 || header.height == 0
+       || header.width > MaxImageDimension || header.height > MaxImageDimension)
+        return false;
+
+    image.width       = header.width;
+    image.height      = header.height;
+    image.compression = format;
+    image.mip_levels  = (header.flags & ddsd_mipmapcount) ? std::max(header.mip_map_count, 1u) : 1;
+    image.mip_levels  = std::min(image.mip_levels, max_mip_levels);
+
+    return ReadCompressedLevels(data + offset, size - offset, image);
+}
+
+static bool ReadKTXData(uint8_t const * data, size_t size, ImageData & image)
+{
+    static constexpr uint8_t identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31,
+                                               0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    constexpr uint32_t       max_mip_levels = 16;
+
+    if(size < sizeof(KTXHEADER))
+        return false;
+
+    KTXHEADER header;
+    std::memcpy(&header, data, sizeof(header));
+    // compressed 2D textures written on a little-endian machine
+    if(std::memcmp(header.identifier, identifier, sizeof(identifier)) || header.endianness != 0x04030201
+       || header.gl_type != 0 || header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth > 1
+       || header.number_of_array_elements > 1 || header.number_of_faces != 1
+       || header.pixel_width > MaxImageDimension || header.pixel_height > MaxImageDimension)
+        return false;
+
+    auto format = ImageData::Compression::cp_none;
+    switch(header.gl_internal_format)
+    {
+        case 0x83F0:   // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        case 0x83F1:   // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+            format = ImageData::Compression::cp_dxt1;
+            break;
+        case 0x83F2:   // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+            format = ImageData::Compression::cp_dxt3;
+            break;
+        case 0x83F3:   // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+            format = ImageData::Compression::cp_dxt5;
+            break;
+        case 0x8D64:   // GL_ETC1_RGB8_OES, a subset of ETC2
+        case 0x9274:   // GL_COMPRESSED_RGB8_ETC2
+            format = ImageData::Compression::cp_etc2_rgb;
+            break;
+        case 0x9278:   // GL_COMPRESSED_RGBA8_ETC2_EAC
+            format = ImageData::Compression::cp_etc2_rgba;
+            break;
+        default:
+            return false;
+    }
+
+    image.width       = header.pixel_width;
+    image.height      = header.pixel_height;
+    image.compression = format;
+    image.mip_levels  = std::min(std::max(header.number_of_mipmap_levels, 1u), max_mip_levels);
+
+    // every level is preceded by its size, the block sizes keep the levels 4 byte aligned
+    size_t offset = sizeof(KTXHEADER) + header.bytes_of_key_value_data;
+    if(offset > size)
+        return false;
+
+    std::vector<uint8_t> blocks;
+    for(uint32_t level = 0; level < image.mip_levels; ++level)
+    {
+        size_t const level_size = GetCompressedSize(format, std::max(image.width >> level, 1u),
+                                                    std::max(image.height >> level, 1u));
+        if(offset + 4 + level_size > size)
+            return false;
+
+        uint32_t image_size = 0;
+        std::memcpy(&image_size, data + offset, 4);
+        if(image_size != level_size)
+            return false;
+
+        blocks.insert(blocks.end(), data + offset + 4, data + offset + 4 + level_size);
+        offset += 4 + level_size;
+    }
+
+    return ReadCompressedLevels(blocks.data(), blocks.size(), image);
+}
+
+bool ReadDDS(BaseFile const & file, ImageData & image)
+{
+    if(file.empty())
+        return false;
+
+    return ReadDDSData(reinterpret_cast<uint8_t const *>(file.getData()), file.getFileSize(), image);
+}
+
+bool ReadKTX(BaseFile const & file, ImageData & image)
+{
+    if(file.empty())
+        return false;
+
+    return ReadKTXData(reinterpret_cast<uint8_t const *>(file.getData()), file.getFileSize(), image);
+}
+
+//==============================================================================
+//         Any format
+//==============================================================================
+enum class FileFormat
+{
+    TGA,
+    BMP,
+    PNG,
+    DDS,
+    KTX
+};
+
+static FileFormat DetectFormat(uint8_t const * data, size_t size)
+{
+    if(size >= sizeof(PNGSignature) && !std::memcmp(data, PNGSignature, sizeof(PNGSignature)))
+        return FileFormat::PNG;
+    if(size >= 4 && !std::memcmp(data, "DDS ", 4))
+        return FileFormat::DDS;
+    if(size >= 4 && !std::memcmp(data, "\xABKTX", 4))
+        return FileFormat::KTX;
+    if(size >= 2 && data[0] == 'B' && data[1] == 'M')
+        return FileFormat::BMP;
+
+    return FileFormat::TGA;   // no signature
+}
+
+static bool ReadImageData(uint8_t const * data, size_t size, ImageData & image)
+{
+    BufferReader reader{data, size};
+
+    switch(DetectFormat(data, size))
+    {
+        case FileFormat::TGA: return ReadTGAData(reader, image);
+        case FileFormat::BMP: return ReadBMPData(data, size, image);
+        case FileFormat::PNG: return ReadPNGData(reader, image);
+        case FileFormat::DDS: return ReadDDSData(data, size, image);
+        case FileFormat::KTX: return ReadKTXData(data, size, image);
+    }
+
+    return false;
+}
+
+bool ReadImage(std::string const & file_name, ImageData & image)
+{
+    std::vector<uint8_t> file;
+    if(!ReadWholeFile(file_name, file) || file.empty())
+        return false;
+
+    return ReadImageData(file.data(), file.size(), image);
+}
+
+bool ReadImage(BaseFile const & file, ImageData & image)
+{
+    if(file.empty())
+        return false;
+
+    return ReadImageData(reinterpret_cast<uint8_t const *>(file.getData()), file.getFileSize(), image);
+}
+
+bool ReadImageHeader(BaseFile const & file, ImageHeader & header)
+{
+    if(file.empty())
+        return false;
+
+    auto const * data            = reinterpret_cast<uint8_t const *>(file.getData());
+    size_t const size            = file.getFileSize();
+    uint32_t     bytes_per_pixel = 0;
+    BufferReader reader{data, size};
+
+    switch(DetectFormat(data, size))
+    {
+        case FileFormat::TGA:
+        {
+            TGALayout layout;
+            if(!ReadTGAHeader(reader, layout))
+                return false;
+
+            header.width    = layout.width;
+            header.height   = layout.height;
+            bytes_per_pixel = layout.bytes_per_pixel;
+            break;
         }
-    } while(current_pixel < pixel_count);
+        case FileFormat::BMP:
+        {
+            BMPLayout layout;
+            if(!ParseBMPHeader(data, size, layout))
+                return false;
+
+            header.width    = layout.width;
+            header.height   = layout.height;
+            bytes_per_pixel = layout.bytes_per_pixel;
+            break;
+        }
+        case FileFormat::PNG:
+        {
+            PNGLayout layout;
+            if(!ReadPNGHeader(reader, layout))
+                return false;
+
+            header.width    = layout.width;
+            header.height   = layout.height;
+            bytes_per_pixel = layout.bytes_per_pixel;
+            break;
+        }
+        default:   // compressed blocks can't be decoded to a destination
+            return false;
+    }
+
+    header.type = bytes_per_pixel == 3 ? ImageData::PixelType::pt_rgb : ImageData::PixelType::pt_rgba;
 
-    image.data = std::move(img);
     return true;
 }
+
+bool ReadImage(BaseFile const & file, ImageDestination const & dst)
+{
+    if(file.empty())
+        return false;
+
+    auto const * data = reinterpret_cast<uint8_t const *>(file.getData());
+    size_t const size = file.getFileSize();
+    BufferReader reader{data, size};
+
+    switch(DetectFormat(data, size))
+    {
+        case FileFormat::TGA:
+        {
+            TGALayout layout;
+            return ReadTGAHeader(reader, layout) && ReadTGAPixels(reader, layout, dst);
+        }
+        case FileFormat::BMP:
+        {
+            BMPLayout layout;
+            return ParseBMPHeader(data, size, layout) && ReadBMPPixels(layout, dst);
+        }
+        case FileFormat::PNG:
+        {
+            PNGLayout layout;
+            return ReadPNGHeader(reader, layout) && ReadPNGPixels(reader, layout, dst);
+        }
+        default:
+            return false;
+    }
+}
 }   // namespace tex
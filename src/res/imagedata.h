@@ -1,17 +1,19 @@
 #ifndef IMAGEDATA_H
 #define IMAGEDATA_H
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
 
 class BaseFile;
+class InputFileStream;
 
 namespace tex
 {
 struct ImageData
 {
-    // origin is the lower-left corner
+    // origin is the lower-left corner, compressed images keep the row order of the file
     enum class PixelType
     {
         pt_rgb,
@@ -21,19 +23,72 @@ struct ImageData
         pt_none
     };
 
-    uint32_t                   width     = 0;
-    uint32_t                   height    = 0;
-    uint32_t                   depth     = 1;
-    uint32_t                   data_size = 0;
-    PixelType                  type      = PixelType::pt_none;
+    // block format of pt_compressed images
+    enum class Compression
+    {
+        cp_none,
+        cp_dxt1,
+        cp_dxt3,
+        cp_dxt5,
+        cp_etc2_rgb,   // also ETC1 data
+        cp_etc2_rgba
+    };
+
+    uint32_t                   width       = 0;
+    uint32_t                   height      = 0;
+    uint32_t                   depth       = 1;
+    uint32_t                   data_size   = 0;
+    uint32_t                   mip_levels  = 1;   // stored one after another, largest first
+    PixelType                  type        = PixelType::pt_none;
+    Compression                compression = Compression::cp_none;
     std::unique_ptr<uint8_t[]> data;
 };
 
+// bytes of one mip level of a block compressed image
+uint32_t GetCompressedSize(ImageData::Compression compression, uint32_t width, uint32_t height);
+
+struct ImageHeader
+{
+    uint32_t             width  = 0;
+    uint32_t             height = 0;
+    ImageData::PixelType type   = ImageData::PixelType::pt_none;
+};
+
+// Caller-supplied memory for the decoded pixels, e.g. a packed atlas region. Row y (lower-left origin, like
+// ImageData) starts at data + y * stride, the stride is in bytes and may be negative. The pixels are RGB or
+// RGBA; RGB files are expanded to RGBA with opaque or coverage alpha (the average of the channels).
+struct ImageDestination
+{
+    uint8_t * data            = nullptr;
+    ptrdiff_t stride          = 0;
+    uint32_t  bytes_per_pixel = 4;
+    bool      coverage_alpha  = false;
+};
+
+// Decode-to-destination for TGA, BMP and PNG files in memory, the format is taken from the file contents. The
+// header is read first to size the destination, the pixels are then decoded without an ImageData copy.
+bool ReadImageHeader(BaseFile const & file, ImageHeader & header);
+bool ReadImage(BaseFile const & file, ImageDestination const & dst);
+
 bool ReadBMP(std::string const & file_name, ImageData & image);
 bool ReadBMP(BaseFile const & file, ImageData & image);
 
 bool ReadTGA(std::string const & file_name, ImageData & image);
 bool ReadTGA(BaseFile const & file, ImageData & image);
+bool ReadTGA(InputFileStream & stream, ImageData & image);   // decoded while the file is read
+
+bool ReadPNG(std::string const & file_name, ImageData & image);
+bool ReadPNG(BaseFile const & file, ImageData & image);
+bool ReadPNG(InputFileStream & stream, ImageData & image);   // decoded while the file is read
+
+// Precompressed textures (DXT/BC1-3, ETC1/2) with their mip levels, the blocks are loaded as they are for
+// glCompressedTexImage2D. 2D textures only.
+bool ReadDDS(BaseFile const & file, ImageData & image);
+bool ReadKTX(BaseFile const & file, ImageData & image);
+
+// any of the formats above, taken from the file contents
+bool ReadImage(std::string const & file_name, ImageData & image);
+bool ReadImage(BaseFile const & file, ImageData & image);
 
 bool WriteTGA(std::string file_name, ImageData const & image);
 }   // namespace tex
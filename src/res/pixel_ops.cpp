@@ -0,0 +1,523 @@
+#include "pixel_ops.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define PIXEL_OPS_X86
+#    include <immintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#        define TARGET_AVX2
+#    else
+#        define TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#endif
+
+namespace PixelOps
+{
+static Isa DetectIsa()
+{
+#if defined(PIXEL_OPS_X86) && defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, 0);
+    if(regs[0] < 7)
+        return Isa::SSE2;
+
+    __cpuid(regs, 1);
+    bool const os_saves_ymm = (regs[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(regs, 7, 0);
+    bool const avx2 = (regs[1] & (1 << 5)) != 0;
+
+    return avx2 && os_saves_ymm ? Isa::AVX2 : Isa::SSE2;
+#elif defined(PIXEL_OPS_X86)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? Isa::AVX2 : Isa::SSE2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+static Isa DetectedIsa()
+{
+    static Isa const isa = DetectIsa();
+    return isa;
+}
+
+static std::atomic<Isa> & CurrentIsa()
+{
+    static std::atomic<Isa> isa{DetectedIsa()};
+    return isa;
+}
+
+Isa GetIsa()
+{
+    return CurrentIsa().load(std::memory_order_relaxed);
+}
+
+void SetIsa(Isa isa)
+{
+    if(static_cast<int>(isa) > static_cast<int>(DetectedIsa()))
+        isa = DetectedIsa();
+
+    CurrentIsa().store(isa, std::memory_order_relaxed);
+}
+
+//==============================================================================
+//         Scalar kernels, also used for the tails of the SIMD loops
+//==============================================================================
+static void SwapRBScalar(uint8_t const * src, uint8_t * dst, size_t pixel_count, uint32_t bytes_per_pixel)
+{
+    for(size_t i = 0; i < pixel_count; ++i, src += bytes_per_pixel, dst += bytes_per_pixel)
+    {
+        uint8_t const red  = src[2];
+        uint8_t const blue = src[0];
+
+        dst[0] = red;
+        dst[1] = src[1];
+        dst[2] = blue;
+        if(bytes_per_pixel == 4)
+            dst[3] = src[3];
+    }
+}
+
+// (r + g + b) / 3 without a division, exact for all sums of three 8-bit channels
+inline uint8_t CoverageAlpha(uint32_t sum)
+{
+    return static_cast<uint8_t>((sum * 21846u) >> 16);
+}
+
+template<bool Coverage>
+static void ExpandScalar(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+    for(size_t i = 0; i < pixel_count; ++i, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = Coverage ? CoverageAlpha(src[0] + src[1] + src[2]) : 255;
+    }
+}
+
+// x * a / 255 rounded to nearest, exact for all 8-bit x and a
+inline uint8_t MulDiv255(uint32_t x, uint32_t a)
+{
+    uint32_t const t = x * a + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+static void PremultiplyScalar(uint8_t * data, size_t pixel_count)
+{
+    for(size_t i = 0; i < pixel_count; ++i, data += 4)
+    {
+        uint32_t const alpha = data[3];
+
+        data[0] = MulDiv255(data[0], alpha);
+        data[1] = MulDiv255(data[1], alpha);
+        data[2] = MulDiv255(data[2], alpha);
+    }
+}
+
+static void DownsampleScalar(uint8_t const * row0, uint8_t const * row1, uint8_t * dst, size_t first,
+                             size_t width)
+{
+    // dst pixels [first, width) from the pixel pairs of both rows
+    for(size_t i = first; i < width; ++i)
+    {
+        for(size_t c = 0; c < 4; ++c)
+        {
+            uint32_t const top    = row0[i * 8 + c] + row0[i * 8 + 4 + c];
+            uint32_t const bottom = row1[i * 8 + c] + row1[i * 8 + 4 + c];
+            dst[i * 4 + c]        = static_cast<uint8_t>((top + bottom + 2) >> 2);
+        }
+    }
+}
+
+static void FlipHorizontalScalar(uint8_t * row, size_t left, size_t right, uint32_t bytes_per_pixel)
+{
+    // pixels [left, right) of the row
+    for(; left + 1 < right; ++left, --right)
+    {
+        for(uint32_t c = 0; c < bytes_per_pixel; ++c)
+            std::swap(row[left * bytes_per_pixel + c], row[(right - 1) * bytes_per_pixel + c]);
+    }
+}
+
+#ifdef PIXEL_OPS_X86
+//==============================================================================
+//         SSE2
+//==============================================================================
+static void SwapRB4SSE2(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+    __m128i const ag_mask = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+
+    size_t i = 0;
+    for(; i + 4 <= pixel_count; i += 4)
+    {
+        __m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 4));
+        __m128i const ag     = _mm_and_si128(pixels, ag_mask);
+        __m128i const rb     = _mm_andnot_si128(ag_mask, pixels);
+        __m128i const br     = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_or_si128(ag, br));
+    }
+
+    SwapRBScalar(src + i * 4, dst + i * 4, pixel_count - i, 4);
+}
+
+static void FlipRow4SSE2(uint8_t * row, size_t width)
+{
+    size_t left = 0, right = width;
+    for(; right - left >= 8; left += 4, right -= 4)
+    {
+        auto * left_ptr  = reinterpret_cast<__m128i *>(row + left * 4);
+        auto * right_ptr = reinterpret_cast<__m128i *>(row + (right - 4) * 4);
+
+        __m128i const left_pixels  = _mm_loadu_si128(left_ptr);
+        __m128i const right_pixels = _mm_loadu_si128(right_ptr);
+        _mm_storeu_si128(left_ptr, _mm_shuffle_epi32(right_pixels, 0x1B));
+        _mm_storeu_si128(right_ptr, _mm_shuffle_epi32(left_pixels, 0x1B));
+    }
+
+    FlipHorizontalScalar(row, left, right, 4);
+}
+
+// two RGBA pixels widened to 16-bit lanes
+static __m128i Premultiply2SSE2(__m128i channels)
+{
+    __m128i const rgb_mask  = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    __m128i const alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);   // alpha stays as it is
+    __m128i const round     = _mm_set1_epi16(128);
+
+    // the alpha of each pixel in all its lanes, (t + (t >> 8)) >> 8 divides by 255
+    __m128i const alpha  = _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, 0xFF), 0xFF);
+    __m128i const factor = _mm_or_si128(_mm_and_si128(alpha, rgb_mask), alpha_one);
+    __m128i const t      = _mm_add_epi16(_mm_mullo_epi16(channels, factor), round);
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void Premultiply4SSE2(uint8_t * data, size_t pixel_count)
+{
+    __m128i const zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 4 <= pixel_count; i += 4)
+    {
+        auto *        ptr    = reinterpret_cast<__m128i *>(data + i * 4);
+        __m128i const pixels = _mm_loadu_si128(ptr);
+        __m128i const low    = Premultiply2SSE2(_mm_unpacklo_epi8(pixels, zero));
+        __m128i const high   = Premultiply2SSE2(_mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128(ptr, _mm_packus_epi16(low, high));
+    }
+
+    PremultiplyScalar(data + i * 4, pixel_count - i);
+}
+
+// the even or the odd pixels of 8 pixels
+template<int Odd>
+static __m128i SelectPixelsSSE2(__m128i a, __m128i b)
+{
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+                                           _MM_SHUFFLE(2 + Odd, Odd, 2 + Odd, Odd)));
+}
+
+static void DownsampleSSE2(uint8_t const * row0, uint8_t const * row1, uint8_t * dst, size_t width)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const two  = _mm_set1_epi16(2);
+
+    size_t i = 0;
+    for(; i + 4 <= width; i += 4)
+    {
+        __m128i const a0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row0 + i * 8));
+        __m128i const a1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row0 + i * 8 + 16));
+        __m128i const b0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row1 + i * 8));
+        __m128i const b1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(row1 + i * 8 + 16));
+
+        __m128i const even_a = SelectPixelsSSE2<0>(a0, a1), odd_a = SelectPixelsSSE2<1>(a0, a1);
+        __m128i const even_b = SelectPixelsSSE2<0>(b0, b1), odd_b = SelectPixelsSSE2<1>(b0, b1);
+
+        __m128i const low  = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpacklo_epi8(even_a, zero), _mm_unpacklo_epi8(odd_a, zero)),
+            _mm_add_epi16(_mm_unpacklo_epi8(even_b, zero), _mm_unpacklo_epi8(odd_b, zero)));
+        __m128i const high = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpackhi_epi8(even_a, zero), _mm_unpackhi_epi8(odd_a, zero)),
+            _mm_add_epi16(_mm_unpackhi_epi8(even_b, zero), _mm_unpackhi_epi8(odd_b, zero)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+                         _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(low, two), 2),
+                                          _mm_srli_epi16(_mm_add_epi16(high, two), 2)));
+    }
+
+    DownsampleScalar(row0, row1, dst, i, width);
+}
+
+//==============================================================================
+//         AVX2, the 3 byte pixel kernels use the 128-bit byte shuffle
+//==============================================================================
+TARGET_AVX2 static void SwapRB4AVX2(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+    __m256i const ag_mask = _mm256_set1_epi32(static_cast<int>(0xFF00FF00u));
+
+    size_t i = 0;
+    for(; i + 8 <= pixel_count; i += 8)
+    {
+        __m256i const pixels = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + i * 4));
+        __m256i const ag     = _mm256_and_si256(pixels, ag_mask);
+        __m256i const rb     = _mm256_andnot_si256(ag_mask, pixels);
+        __m256i const br     = _mm256_or_si256(_mm256_slli_epi32(rb, 16), _mm256_srli_epi32(rb, 16));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_or_si256(ag, br));
+    }
+
+    SwapRBScalar(src + i * 4, dst + i * 4, pixel_count - i, 4);
+}
+
+TARGET_AVX2 static void SwapRB3AVX2(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+    // 5 pixels of a 16 byte block, the last byte is stored back unchanged
+    __m128i const shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+
+    size_t i = 0;
+    for(; i * 3 + 16 <= pixel_count * 3; i += 5)
+    {
+        __m128i const pixels = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 3), _mm_shuffle_epi8(pixels, shuffle));
+    }
+
+    SwapRBScalar(src + i * 3, dst + i * 3, pixel_count - i, 3);
+}
+
+template<bool Coverage>
+TARGET_AVX2 static void ExpandAVX2(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+    // 4 RGB pixels of each 128-bit lane -> RGB0
+    __m256i const shuffle    = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,   //
+                                                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i const alpha_mask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    __m256i const rgb_weight = _mm256_set1_epi32(0x00010101);
+    __m256i const ones       = _mm256_set1_epi16(1);
+    __m256i const inv_three  = _mm256_set1_epi32(21846);
+
+    size_t i = 0;
+    for(; i * 3 + 28 <= pixel_count * 3; i += 8)
+    {
+        __m128i const low  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 3));
+        __m128i const high = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i * 3 + 12));
+        __m256i const rgb0 =
+            _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), shuffle);
+
+        __m256i alpha = alpha_mask;
+        if constexpr(Coverage)
+        {
+            // r + g + b of each pixel, alpha = (sum * 21846) >> 16 moved to the top byte
+            __m256i const sum = _mm256_madd_epi16(_mm256_maddubs_epi16(rgb0, rgb_weight), ones);
+            alpha = _mm256_and_si256(_mm256_slli_epi32(_mm256_mullo_epi32(sum, inv_three), 8), alpha_mask);
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_or_si256(rgb0, alpha));
+    }
+
+    ExpandScalar<Coverage>(src + i * 3, dst + i * 4, pixel_count - i);
+}
+
+TARGET_AVX2 static __m256i Premultiply4AVX2(__m256i channels)
+{
+    __m256i const rgb_mask  = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+    __m256i const alpha_one = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+    __m256i const round     = _mm256_set1_epi16(128);
+
+    __m256i const alpha  = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(channels, 0xFF), 0xFF);
+    __m256i const factor = _mm256_or_si256(_mm256_and_si256(alpha, rgb_mask), alpha_one);
+    __m256i const t      = _mm256_add_epi16(_mm256_mullo_epi16(channels, factor), round);
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 static void Premultiply8AVX2(uint8_t * data, size_t pixel_count)
+{
+    __m256i const zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 8 <= pixel_count; i += 8)
+    {
+        // unpack and pack work inside the 128-bit lanes, so the pixel order is kept
+        auto *        ptr    = reinterpret_cast<__m256i *>(data + i * 4);
+        __m256i const pixels = _mm256_loadu_si256(ptr);
+        __m256i const low    = Premultiply4AVX2(_mm256_unpacklo_epi8(pixels, zero));
+        __m256i const high   = Premultiply4AVX2(_mm256_unpackhi_epi8(pixels, zero));
+        _mm256_storeu_si256(ptr, _mm256_packus_epi16(low, high));
+    }
+
+    PremultiplyScalar(data + i * 4, pixel_count - i);
+}
+
+// shuffle_ps works inside the 128-bit lanes: the even pixels of 16 are 0 2 8 10 | 4 6 12 14
+template<int Odd>
+TARGET_AVX2 static __m256i SelectPixelsAVX2(__m256i a, __m256i b)
+{
+    return _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b),
+                                                 _MM_SHUFFLE(2 + Odd, Odd, 2 + Odd, Odd)));
+}
+
+TARGET_AVX2 static void DownsampleAVX2(uint8_t const * row0, uint8_t const * row1, uint8_t * dst,
+                                       size_t width)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const two  = _mm256_set1_epi16(2);
+
+    size_t i = 0;
+    for(; i + 8 <= width; i += 8)
+    {
+        __m256i const a0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(row0 + i * 8));
+        __m256i const a1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(row0 + i * 8 + 32));
+        __m256i const b0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(row1 + i * 8));
+        __m256i const b1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(row1 + i * 8 + 32));
+
+        __m256i const even_a = SelectPixelsAVX2<0>(a0, a1), odd_a = SelectPixelsAVX2<1>(a0, a1);
+        __m256i const even_b = SelectPixelsAVX2<0>(b0, b1), odd_b = SelectPixelsAVX2<1>(b0, b1);
+
+        __m256i const low  = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_unpacklo_epi8(even_a, zero), _mm256_unpacklo_epi8(odd_a, zero)),
+            _mm256_add_epi16(_mm256_unpacklo_epi8(even_b, zero), _mm256_unpacklo_epi8(odd_b, zero)));
+        __m256i const high = _mm256_add_epi16(
+            _mm256_add_epi16(_mm256_unpackhi_epi8(even_a, zero), _mm256_unpackhi_epi8(odd_a, zero)),
+            _mm256_add_epi16(_mm256_unpackhi_epi8(even_b, zero), _mm256_unpackhi_epi8(odd_b, zero)));
+
+        // dst pixels 0 1 4 5 | 2 3 6 7 -> 0 .. 7
+        __m256i const packed = _mm256_packus_epi16(_mm256_srli_epi16(_mm256_add_epi16(low, two), 2),
+                                                   _mm256_srli_epi16(_mm256_add_epi16(high, two), 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+                            _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    DownsampleScalar(row0, row1, dst, i, width);
+}
+#endif
+
+//==============================================================================
+//         Dispatch
+//==============================================================================
+void SwapRB(uint8_t const * src, uint8_t * dst, size_t pixel_count, uint32_t bytes_per_pixel)
+{
+    assert(bytes_per_pixel == 3 || bytes_per_pixel == 4);
+
+#ifdef PIXEL_OPS_X86
+    Isa const isa = GetIsa();
+    if(isa == Isa::AVX2)
+        return bytes_per_pixel == 4 ? SwapRB4AVX2(src, dst, pixel_count) : SwapRB3AVX2(src, dst, pixel_count);
+    if(isa == Isa::SSE2 && bytes_per_pixel == 4)
+        return SwapRB4SSE2(src, dst, pixel_count);
+#endif
+
+    SwapRBScalar(src, dst, pixel_count, bytes_per_pixel);
+}
+
+void RGBToRGBA(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+#ifdef PIXEL_OPS_X86
+    if(GetIsa() == Isa::AVX2)
+        return ExpandAVX2<false>(src, dst, pixel_count);
+#endif
+
+    ExpandScalar<false>(src, dst, pixel_count);
+}
+
+void CoverageToRGBA(uint8_t const * src, uint8_t * dst, size_t pixel_count)
+{
+#ifdef PIXEL_OPS_X86
+    if(GetIsa() == Isa::AVX2)
+        return ExpandAVX2<true>(src, dst, pixel_count);
+#endif
+
+    ExpandScalar<true>(src, dst, pixel_count);
+}
+
+void FlipVertical(uint8_t * data, size_t row_size, size_t rows)
+{
+    // rows are swapped through a small buffer, memcpy is already vectorized
+    uint8_t buffer[4096];
+
+    for(size_t top = 0, bottom = rows; top + 1 < bottom; ++top, --bottom)
+    {
+        uint8_t * top_row    = data + top * row_size;
+        uint8_t * bottom_row = data + (bottom - 1) * row_size;
+
+        for(size_t offset = 0; offset < row_size; offset += sizeof(buffer))
+        {
+            size_t const size = std::min(sizeof(buffer), row_size - offset);
+            std::memcpy(buffer, top_row + offset, size);
+            std::memcpy(top_row + offset, bottom_row + offset, size);
+            std::memcpy(bottom_row + offset, buffer, size);
+        }
+    }
+}
+
+void FlipHorizontal(uint8_t * data, size_t width, size_t rows, uint32_t bytes_per_pixel)
+{
+    size_t const row_size = width * bytes_per_pixel;
+
+    for(size_t y = 0; y < rows; ++y)
+    {
+        uint8_t * row = data + y * row_size;
+#ifdef PIXEL_OPS_X86
+        if(bytes_per_pixel == 4 && GetIsa() != Isa::Scalar)
+        {
+            FlipRow4SSE2(row, width);
+            continue;
+        }
+#endif
+        FlipHorizontalScalar(row, 0, width, bytes_per_pixel);
+    }
+}
+
+void BlitToRGBA(uint8_t const * src, size_t src_stride, uint32_t src_bytes_per_pixel, uint8_t * dst,
+                ptrdiff_t dst_stride, size_t width, size_t rows)
+{
+    assert(src_bytes_per_pixel == 3 || src_bytes_per_pixel == 4);
+
+    for(size_t y = 0; y < rows; ++y, src += src_stride, dst += dst_stride)
+    {
+        if(src_bytes_per_pixel == 4)
+            std::memcpy(dst, src, width * 4);
+        else
+            CoverageToRGBA(src, dst, width);
+    }
+}
+
+void PremultiplyAlpha(uint8_t * data, size_t pixel_count)
+{
+#ifdef PIXEL_OPS_X86
+    Isa const isa = GetIsa();
+    if(isa == Isa::AVX2)
+        return Premultiply8AVX2(data, pixel_count);
+    if(isa == Isa::SSE2)
+        return Premultiply4SSE2(data, pixel_count);
+#endif
+
+    PremultiplyScalar(data, pixel_count);
+}
+
+void DownsampleBox(uint8_t const * src, size_t src_stride, uint8_t * dst, size_t dst_stride, size_t width,
+                   size_t rows)
+{
+#ifdef PIXEL_OPS_X86
+    Isa const isa = GetIsa();
+#endif
+
+    for(size_t y = 0; y < rows; ++y, src += src_stride * 2, dst += dst_stride)
+    {
+#ifdef PIXEL_OPS_X86
+        if(isa == Isa::AVX2)
+        {
+            DownsampleAVX2(src, src + src_stride, dst, width);
+            continue;
+        }
+        if(isa == Isa::SSE2)
+        {
+            DownsampleSSE2(src, src + src_stride, dst, width);
+            continue;
+        }
+#endif
+        DownsampleScalar(src, src + src_stride, dst, 0, width);
+    }
+}
+}   // namespace PixelOps
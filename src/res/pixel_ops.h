@@ -0,0 +1,46 @@
+#ifndef PIXELOPS_H
+#define PIXELOPS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Pixel conversion kernels for the image decoders and the texture atlases. The SIMD variant is chosen
+// at runtime from the CPU features: AVX2, SSE2 (always available on x86-64) or plain C++.
+// Pixels are tightly packed 8-bit channels, src and dst of the conversions may be the same buffer only
+// where noted.
+namespace PixelOps
+{
+enum class Isa
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+Isa  GetIsa();
+void SetIsa(Isa isa);   // forces a lower level (tests, benchmarks), limited to the detected one
+
+// BGR(A) <-> RGB(A), in place when src == dst
+void SwapRB(uint8_t const * src, uint8_t * dst, size_t pixel_count, uint32_t bytes_per_pixel);
+// RGB -> RGBA with opaque alpha
+void RGBToRGBA(uint8_t const * src, uint8_t * dst, size_t pixel_count);
+// RGB coverage (glyphs, grayscale masks) -> RGBA, alpha is the average of the channels
+void CoverageToRGBA(uint8_t const * src, uint8_t * dst, size_t pixel_count);
+
+void FlipVertical(uint8_t * data, size_t row_size, size_t rows);   // in place, row_size in bytes
+void FlipHorizontal(uint8_t * data, size_t width, size_t rows, uint32_t bytes_per_pixel);   // in place
+
+// Copies a region of RGB or RGBA pixels into an RGBA image, RGB is converted with CoverageToRGBA().
+// Strides are in bytes, a negative dst_stride writes the rows bottom-up.
+void BlitToRGBA(uint8_t const * src, size_t src_stride, uint32_t src_bytes_per_pixel, uint8_t * dst,
+                ptrdiff_t dst_stride, size_t width, size_t rows);
+
+// RGBA straight alpha -> premultiplied alpha, in place, the channels are rounded to nearest
+void PremultiplyAlpha(uint8_t * data, size_t pixel_count);
+// 2x2 box filter of RGBA pixels for mip levels: width x rows dst pixels from 2 * width x 2 * rows src
+// pixels. Strides are in bytes.
+void DownsampleBox(uint8_t const * src, size_t src_stride, uint8_t * dst, size_t dst_stride, size_t width,
+                   size_t rows);
+}   // namespace PixelOps
+
+#endif   // PIXELOPS_H
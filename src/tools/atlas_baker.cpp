@@ -0,0 +1,62 @@
+// Offline atlas baker: packs the UI image groups of ui_res.json into one tight atlas and rasterizes the
+// glyph sets of its fonts, so UI::init() restores both atlases with one read each instead of packing.
+//
+// usage: atlas_baker [data_dir]   (default ./data, like the app)
+//
+// Writes UIImageGroupManager::BakedAtlasFileName and FontManager::CacheFileName into data_dir.
+
+#include <iostream>
+#include <sstream>
+
+#include "../fs/file_system.h"
+#include "../gui/ui.h"
+#include "../gui/uiconfigloader.h"
+#include "../gui/uiimagemanager.h"
+#include "../gui/utils/fontmanager.h"
+
+int main(int argc, char * argv[])
+{
+    try
+    {
+        FileSystem fsys{argc > 1 ? argv[1] : "./data"};
+
+        auto file = fsys.getFile(UI::UIResFileName);
+        if(!file)
+        {
+            std::cout << "ERROR: " << UI::UIResFileName << " not found" << std::endl;
+            return 1;
+        }
+
+        UIImageGroupManager images;
+        UIImageManagerDesc::ParseUIRes(images, *file, fsys);
+        images.repackAtlas();
+        if(!images.saveBaked(fsys, UIImageGroupManager::GetBakeKey(*file)))
+        {
+            std::cout << "ERROR: unable to write " << UIImageGroupManager::BakedAtlasFileName << std::endl;
+            return 1;
+        }
+
+        // glyphs loaded on demand at runtime keep going into the same atlas, so the font atlas stays with
+        // the skyline packer of AtlasTex
+        FontManager fonts(fsys);
+        FontDataDesc::ParseFontsRes(fonts, *file);
+        fonts.invalidateCache();
+        if(!fonts.saveCache())
+        {
+            std::cout << "ERROR: unable to write " << FontManager::CacheFileName << std::endl;
+            return 1;
+        }
+
+        std::stringstream ss;
+        ss << "UI atlas: " << images.getAtlas().getSize() << "px, font atlas: " << fonts.getAtlas().getSize()
+           << "px";
+        std::cout << ss.str() << std::endl;
+    }
+    catch(std::exception const & e)
+    {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
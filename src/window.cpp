@@ -15,6 +15,7 @@ namespace
 {
 constexpr char const * const base_tex_fname   = "base.tga";
 constexpr char const * const data_folder      = "./data";
+constexpr size_t             file_cache_size  = 32 * 1024 * 1024;
 Window *                     g_cur_window_ptr = nullptr;
 }   // namespace
 
@@ -31,6 +32,7 @@ Window::Window(int width, int height, char const * title) :
 
     g_cur_window_ptr = this;
 
+    m_fs.setCacheBudget(file_cache_size);
     m_ui_ptr = std::make_unique<UI>(m_fs);
 
     m_light.m_type     = Light::LightType::Point;
@@ -194,9 +196,9 @@ void Window::initScene()
     // m_ui_ptr->getUIImageAtlas().writeAtlasToTGA("ui_atlas.tga");
 
     // load example window
-    if(auto file = m_fs.getFile("ui/jsons/vert_win.json"); file)
+    if(auto stream = m_fs.openStream("ui/jsons/vert_win.json"); stream)
     {
-        m_win = m_ui_ptr->loadWindow(*file);
+        m_win = m_ui_ptr->loadWindow(*stream);
     }
     else
         throw std::runtime_error{"Failed to parse sample UI window"};
@@ -213,6 +215,8 @@ void Window::initScene()
 
     m_win->show();
     m_win->move({10.f, 10.f});
+
+    m_fs.watchChanges(true);
 }
 
 void Window::resize(int width, int height)
@@ -337,6 +341,13 @@ void Window::run()
         }
         num_frames++;
 
+        // completions of the async loads
+        m_fs.processCompleted();
+
+        // hot reload of the edited assets
+        if(auto changed = m_fs.pollChanges(); !changed.empty())
+            m_ui_ptr->reloadChangedFiles(changed);
+
         m_ui_ptr->update(glfwGetTime());
 
         draw();